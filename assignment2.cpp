@@ -1,7 +1,11 @@
 #include "assignment2.hpp"
+#include "game_loop.hpp"
 #include "interpolation.hpp"
 #include "node.hpp"
 #include "parametric_shapes.hpp"
+#include "program_reflection.hpp"
+#include "stream_buffer.hpp"
+#include "uniform_buffers.hpp"
 
 #include "config.hpp"
 #include "external/glad/glad.h"
@@ -25,8 +29,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cmath>
 #include <cstdlib>
 #include <stdexcept>
+#include <vector>
 
 enum class polygon_mode_t : unsigned int {
 	fill = 0u,
@@ -103,18 +109,19 @@ eda221::Assignment2::run()
 		return;
 	}
 
+	// Camera and light are shared by all draws, through the FrameBlock.
 	auto const light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-	auto const set_uniforms = [&light_position](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-	};
+	// Per-draw and per-frame data is rewritten each frame, into a ring of
+	// buffers the GPU reads from while the next frames are prepared.
+	auto& frame_stream = eda221::getStreamBuffer();
 
 	auto sphere1 = Node();
 	sphere1.set_geometry(shape);
-	sphere1.set_program(fallback_shader, set_uniforms);
+	sphere1.set_program(fallback_shader);
 
 	auto sphere2 = Node();
 	sphere2.set_geometry(shape);
-	sphere2.set_program(fallback_shader, set_uniforms);
+	sphere2.set_program(fallback_shader);
 
 	//! \todo Create a tesselated sphere and a tesselated torus
 	//auto const shapeSphere = parametric_shapes::createSphere(20u, 20u, 2.0f);
@@ -122,7 +129,7 @@ eda221::Assignment2::run()
 	//	return;
 	//auto sphere = Node();
 	//sphere.set_geometry(shapeSphere);
-	//sphere.set_program(fallback_shader, set_uniforms);
+	//sphere.set_program(fallback_shader);
 
 
 
@@ -152,9 +159,37 @@ eda221::Assignment2::run()
 	//for (int i = 0; i < 4; i++) {
 	//	cp[i] = glm::vec3((rand()%100)/100, (rand() % 100) / 100, (rand() % 100) / 100);
 	//}
-	float path_pos = 0.0f;
 	float pos_velocity = 0.005f;
 
+	// The spheres follow the path in fixed steps, at the rate the path
+	// was tuned for, and are drawn in between the last two steps. Press T
+	// to run the steps on their own thread.
+	struct path_state {
+		float path_pos;
+		glm::vec3 lin_position;
+		glm::vec3 cr_position;
+	};
+	double const path_step = 1.0 / 60.0;
+	// The Catmull-Rom path is sampled once, at every position the spheres
+	// stop at: path_pos moves by pos_velocity segments per step.
+	auto const cr_samples_per_segment = static_cast<size_t>(std::lround(1.0f / pos_velocity));
+	std::vector<glm::vec3> cr_path(N * cr_samples_per_segment);
+	interpolation::evalSpline(interpolation::buildCatmullRom(cp, N, true), cr_path.data(), cr_path.size());
+	eda221::game_loop<path_state, float> path_loop(path_state{ 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) }, path_step,
+		[&cp, N, &cr_path, cr_samples_per_segment](path_state& state, float const& velocity, double) {
+			int i = floor(state.path_pos);
+
+			glm::vec3 newPointLin = interpolation::evalLERP(cp[i%N], cp[(i + 1) % N], state.path_pos - i);
+
+			auto const sample = static_cast<size_t>(std::lround(state.path_pos * cr_samples_per_segment));
+			glm::vec3 newPointCR = cr_path[sample % cr_path.size()];
+
+			state.lin_position += newPointLin;
+			state.cr_position += newPointCR;
+			state.path_pos = (state.path_pos + velocity);
+		});
+	path_loop.set_input(pos_velocity);
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
 	double nowTime, lastTime = GetTimeSeconds();
@@ -168,6 +203,7 @@ eda221::Assignment2::run()
 			fpsSamples = 0;
 		}
 		fpsSamples++;
+		frame_stream.begin_frame();
 
 		glfwPollEvents();
 		inputHandler->Advance();
@@ -177,20 +213,20 @@ eda221::Assignment2::run()
 		
 
 		if (inputHandler->GetKeycodeState(GLFW_KEY_1) & JUST_PRESSED) {
-			sphere1.set_program(fallback_shader, set_uniforms);
-			sphere2.set_program(fallback_shader, set_uniforms);
+			sphere1.set_program(fallback_shader);
+			sphere2.set_program(fallback_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_2) & JUST_PRESSED) {
-			sphere1.set_program(diffuse_shader, set_uniforms);
-			sphere2.set_program(diffuse_shader, set_uniforms);
+			sphere1.set_program(diffuse_shader);
+			sphere2.set_program(diffuse_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_3) & JUST_PRESSED) {
-			sphere1.set_program(normal_shader, set_uniforms);
-			sphere2.set_program(normal_shader, set_uniforms);
+			sphere1.set_program(normal_shader);
+			sphere2.set_program(normal_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_4) & JUST_PRESSED) {
-			sphere1.set_program(texcoord_shader, set_uniforms);
-			sphere2.set_program(texcoord_shader, set_uniforms);
+			sphere1.set_program(texcoord_shader);
+			sphere2.set_program(texcoord_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_Z) & JUST_PRESSED) {
 			polygon_mode = get_next_mode(polygon_mode);
@@ -207,19 +243,25 @@ eda221::Assignment2::run()
 			break;
 		}
 
+		if (inputHandler->GetKeycodeState(GLFW_KEY_T) & JUST_PRESSED) {
+			if (path_loop.is_threaded()) {
+				path_loop.stop_thread();
+			} else {
+				path_loop.start_thread();
+			}
+			LogInfo("Path simulated on the %s thread", path_loop.is_threaded() ? "simulation" : "render");
+		}
+
 		sphere1.rotate_y(0.00f);
 
 
 		//! \todo Interpolate the movement of a shape between various
 		//!        control points
-		int i = floor(path_pos);
-
-		glm::vec3 newPointLin = interpolation::evalLERP(cp[i%N], cp[(i + 1) % N], path_pos - i);
-
-		glm::vec3 newPointCR = interpolation::evalCatmullRom(cp[(N+i-1)%N], cp[(i) % N], cp[(i + 1) % N], cp[(i + 2) % 4], 0.5, path_pos - i); 
-		
-		sphere1.translate(newPointLin);
-		sphere2.translate(newPointCR);
+		path_loop.advance(ddeltatime);
+		auto const& previous = path_loop.get_previous();
+		auto const& current = path_loop.get_current();
+		sphere1.set_translation(interpolation::evalLERP(previous.lin_position, current.lin_position, path_loop.get_alpha()));
+		sphere2.set_translation(interpolation::evalLERP(previous.cr_position, current.cr_position, path_loop.get_alpha()));
 
 		auto const window_size = window->GetDimensions();
 		glViewport(0, 0, window_size.x, window_size.y);
@@ -227,18 +269,22 @@ eda221::Assignment2::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		sphere1.render(mCamera.GetWorldToClipMatrix(), sphere1.get_transform());
-		sphere2.render(mCamera.GetWorldToClipMatrix(), sphere2.get_transform());
+		eda221::setFrameBlock({ mCamera.GetWorldToClipMatrix(), mCamera.mWorld.GetTranslation(),
+		                        static_cast<float>(nowTime), light_position, 0.0f });
+		sphere1.render(mCamera.GetWorldToClipMatrix());
+		sphere2.render(mCamera.GetWorldToClipMatrix());
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		Log::View::Render();
 		ImGui::Render();
 
+		frame_stream.end_frame();
 		window->Swap();
 		lastTime = nowTime;
-		path_pos = (path_pos + pos_velocity);
 	}
 
+	path_loop.stop_thread();
+
 	glDeleteProgram(texcoord_shader);
 	normal_shader = 0u;
 	glDeleteProgram(normal_shader);
@@ -247,6 +293,7 @@ eda221::Assignment2::run()
 	diffuse_shader = 0u;
 	glDeleteProgram(fallback_shader);
 	diffuse_shader = 0u;
+	eda221::releaseStreamBuffer();
 }
 
 int main()
@@ -2,6 +2,11 @@
 #include "interpolation.hpp"
 #include "node.hpp"
 #include "parametric_shapes.hpp"
+#include "profiler.hpp"
+#include "program_reflection.hpp"
+#include "stream_buffer.hpp"
+#include "texture_loader.hpp"
+#include "uniform_buffers.hpp"
 
 #include "config.hpp"
 #include "external/glad/glad.h"
@@ -146,34 +151,33 @@ eda221::Assignment3::run()
 	};
 	reload_shaders();
 
+	// Camera and light are shared by all draws, through the FrameBlock;
+	// the Phong parameters live in a material, only uploaded when edited.
 	auto light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
-	auto const set_uniforms = [&light_position](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-	};
-
 	auto camera_position = mCamera.mWorld.GetTranslation();
+	// Per-draw and per-frame data is rewritten each frame, into a ring of
+	// buffers the GPU reads from while the next frames are prepared.
+	auto& frame_stream = eda221::getStreamBuffer();
+
 	auto ambient = glm::vec3(0.2f, 0.2f, 0.2f);
 	auto diffuse = glm::vec3(0.7f, 0.2f, 0.4f);
 	auto specular = glm::vec3(1.0f, 1.0f, 1.0f);
 	auto shininess = 1.0f;
-	auto const phong_set_uniforms = [&light_position, &camera_position, &ambient, &diffuse, &specular, &shininess](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
-		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
-		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
-		glUniform1f(glGetUniformLocation(program, "shininess"), shininess);
-	};
+	eda221::material phong_material({ ambient, shininess, diffuse, 0.0f, specular, 0.0f });
+	// Images are decoded in the background; textures show a placeholder
+	// colour until `texture_loader.poll()` uploads them.
+	eda221::texture_loader texture_loader;
 	std::string const& cubename = "forbidden/";
-	auto cubetex = loadTextureCubeMap(cubename + "posx.png", cubename + "negx.png", cubename + "posy.png", cubename + "negy.png", cubename + "posz.png", cubename + "negz.png");
+	auto cubetex = texture_loader.load_texture_cube_map(cubename + "posx.png", cubename + "negx.png", cubename + "posy.png", cubename + "negy.png", cubename + "posz.png", cubename + "negz.png");
 	auto polygon_mode = polygon_mode_t::fill;
 	auto circle_ring = Node();
 	circle_ring.set_geometry(sphere_shape);
-	circle_ring.set_program(phong_shader, phong_set_uniforms);
-	
+	circle_ring.set_program(phong_shader);
+	circle_ring.set_material(&phong_material);
+
 	auto sky = Node();
 	sky.set_geometry(skybox_shape);
-	sky.set_program(skybox_shader, phong_set_uniforms);
+	sky.set_program(skybox_shader);
 	sky.add_texture("cubeMapName", cubetex, GL_TEXTURE_CUBE_MAP);
 	glEnable(GL_DEPTH_TEST);
 	circle_ring.set_translation(glm::vec3(10.0f,0.0f,0.0f));
@@ -181,11 +185,12 @@ eda221::Assignment3::run()
 	//glEnable(GL_CULL_FACE);
 	//glCullFace(GL_FRONT);
 	//glCullFace(GL_BACK);
-	auto quadTex = loadTexture2D("earth_diffuse.png");
-	auto quadBump = loadTexture2D("earth_bump.png");
+	auto quadTex = texture_loader.load_texture_2D("earth_diffuse.png");
+	auto quadBump = texture_loader.load_texture_2D("earth_bump.png", glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
 	auto bTest = Node();
 	bTest.set_geometry(sphere_shape);
-	bTest.set_program(bump_shader,phong_set_uniforms);
+	bTest.set_program(bump_shader);
+	bTest.set_material(&phong_material);
 	bTest.add_texture("thisTex",quadTex);
 	bTest.add_texture("myBumpMap",quadBump);
 
@@ -194,6 +199,9 @@ eda221::Assignment3::run()
 	double nowTime, lastTime = GetTimeMilliseconds();
 	double fpsNextTick = lastTime + 1000.0;
 
+	// CPU and GPU time of each part of the frame, see the Profiler window.
+	eda221::profiler profiler;
+
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeMilliseconds();
 		ddeltatime = nowTime - lastTime;
@@ -202,27 +210,34 @@ eda221::Assignment3::run()
 			fpsSamples = 0;
 		}
 		fpsSamples++;
+		profiler.begin_frame();
+		frame_stream.begin_frame();
+		eda221::program_reflection::reset_name_lookups_nb();
 
 		glfwPollEvents();
+		{
+			eda221::profile_scope texture_uploads_scope(profiler, "texture uploads");
+			texture_loader.poll();
+		}
 		inputHandler->Advance();
 		mCamera.Update(ddeltatime, *inputHandler);
 
 		ImGui_ImplGlfwGL3_NewFrame();
 
 		if (inputHandler->GetKeycodeState(GLFW_KEY_1) & JUST_PRESSED) {
-			circle_ring.set_program(fallback_shader, set_uniforms);
+			circle_ring.set_program(fallback_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_2) & JUST_PRESSED) {
-			circle_ring.set_program(diffuse_shader, set_uniforms);
+			circle_ring.set_program(diffuse_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_3) & JUST_PRESSED) {
-			circle_ring.set_program(normal_shader, set_uniforms);
+			circle_ring.set_program(normal_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_4) & JUST_PRESSED) {
-			circle_ring.set_program(texcoord_shader, set_uniforms);
+			circle_ring.set_program(texcoord_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_5) & JUST_PRESSED) {
-			circle_ring.set_program(phong_shader, phong_set_uniforms);
+			circle_ring.set_program(phong_shader);
 		}
 		if (inputHandler->GetKeycodeState(GLFW_KEY_Z) & JUST_PRESSED) {
 			polygon_mode = get_next_mode(polygon_mode);
@@ -250,31 +265,54 @@ eda221::Assignment3::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		circle_ring.render(mCamera.GetWorldToClipMatrix(), circle_ring.get_transform());
-		sky.render(mCamera.GetWorldToClipMatrix(), sky.get_transform());
-		bTest.render(mCamera.GetWorldToClipMatrix(), sky.get_transform());
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-		Log::View::Render();
-
-		bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
-		if (opened) {
-			ImGui::ColorEdit3("Ambient", glm::value_ptr(ambient));
-			ImGui::ColorEdit3("Diffuse", glm::value_ptr(diffuse));
-			ImGui::ColorEdit3("Specular", glm::value_ptr(specular));
-			ImGui::SliderFloat("Shininess", &shininess, 0.0f, 1000.0f);
-			ImGui::SliderFloat3("Light Position", glm::value_ptr(light_position), -20.0f, 20.0f);
-			//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+		{
+			eda221::profile_scope render_scope(profiler, "render");
+			eda221::setFrameBlock({ mCamera.GetWorldToClipMatrix(), camera_position,
+			                        static_cast<float>(nowTime) / 1000.0f, light_position, 0.0f });
+			phong_material.set({ ambient, shininess, diffuse, 0.0f, specular, 0.0f });
+
+			{
+				eda221::profile_scope circle_ring_scope(profiler, "circle ring");
+				circle_ring.render(mCamera.GetWorldToClipMatrix());
+			}
+			{
+				eda221::profile_scope skybox_scope(profiler, "skybox");
+				sky.render(mCamera.GetWorldToClipMatrix());
+			}
+			{
+				eda221::profile_scope bump_sphere_scope(profiler, "bump sphere");
+				bTest.render(mCamera.GetWorldToClipMatrix());
+			}
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		}
-		ImGui::End();
 
-		ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
-		if (opened)
-			ImGui::Text("%.3f ms, %.1f fps", ddeltatime, 1000 / (ddeltatime));
-		ImGui::End();
-
-		ImGui::Render();
+		{
+			eda221::profile_scope imgui_scope(profiler, "ImGui");
+			Log::View::Render();
+
+			bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
+			if (opened) {
+				ImGui::ColorEdit3("Ambient", glm::value_ptr(ambient));
+				ImGui::ColorEdit3("Diffuse", glm::value_ptr(diffuse));
+				ImGui::ColorEdit3("Specular", glm::value_ptr(specular));
+				ImGui::SliderFloat("Shininess", &shininess, 0.0f, 1000.0f);
+				ImGui::SliderFloat3("Light Position", glm::value_ptr(light_position), -20.0f, 20.0f);
+				//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+			}
+			ImGui::End();
+
+			ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
+			if (opened)
+				ImGui::Text("%.3f ms, %.1f fps\n%u uniform name lookups", ddeltatime, 1000 / (ddeltatime),
+				            static_cast<unsigned int>(eda221::program_reflection::get_name_lookups_nb()));
+			ImGui::End();
+
+			profiler.show_window();
+			ImGui::Render();
+		}
 
+		profiler.end_frame();
+		frame_stream.end_frame();
 		window->Swap();
 		lastTime = nowTime;
 	}
@@ -293,6 +331,7 @@ eda221::Assignment3::run()
 	skybox_shader = 0u;
 	glDeleteProgram(bump_shader);
 	bump_shader = 0u;
+	eda221::releaseStreamBuffer();
 }
 
 int main()
@@ -1,7 +1,15 @@
 #include "assignment4.hpp"
+#include "gpu_timer.hpp"
 #include "interpolation.hpp"
 #include "node.hpp"
+#include "ocean.hpp"
 #include "parametric_shapes.hpp"
+#include "profiler.hpp"
+#include "program_reflection.hpp"
+#include "stream_buffer.hpp"
+#include "texture_loader.hpp"
+#include "uniform_buffers.hpp"
+#include "wave_system.hpp"
 
 #include "config.hpp"
 #include "external/glad/glad.h"
@@ -66,9 +74,13 @@ eda221::Assignment4::~Assignment4()
 }
 void eda221::Assignment4::run()
 {
-	// Load the sphere geometry
-	auto quad_shape = parametric_shapes::createQuad(100u,100u,100u,100u);
-	//auto quad_shape = parametric_shapes::createSphere(100u, 100u, 5.0f);
+	// The water is a clipmap following the camera, generated by its
+	// vertex shader, so its levels can be changed at runtime.
+	auto water_layout = parametric_shapes::clipmap_layout{ 12u, 5u, 0.25f };
+	auto water_ring_width = static_cast<int>(water_layout.ring_width);
+	auto water_levels_nb = static_cast<int>(water_layout.levels_nb);
+	auto const water_bounds = glm::vec4(0.0f, 0.0f, 100.0f, 100.0f);
+	auto quad_shape = parametric_shapes::createClipmap(water_layout);
 	if (quad_shape.vao == 0u) {
 		LogError("Failed to retrive quad mesh");
 		return;
@@ -91,6 +103,15 @@ void eda221::Assignment4::run()
 		LogError("Failed to load water shader");
 		return;
 	}
+
+	// The water is an FFT ocean, simulated on the CPU one frame ahead,
+	// possibly with waves on top of it; the waves live in a uniform
+	// buffer, bound along with the water.
+	auto ocean_enabled = true;
+	eda221::ocean_surface ocean(eda221::ocean_settings{ 256u, 50.0f, glm::vec2(-6.0f, 2.0f), 5.0e-5f, 1.0f, 1u });
+	auto waves_nb = 0;
+	eda221::wave_system wave_system;
+	wave_system.set_waves(eda221::generateWaves(static_cast<unsigned int>(waves_nb)));
 	// Set the uniforms of the shaders
 
 	f64 ddeltatime;
@@ -100,26 +121,74 @@ void eda221::Assignment4::run()
 
 	auto light_position = glm::vec3(-2.0f, 4.0f, 2.0f); // Light position;
 	auto camera_position = mCamera.mWorld.GetTranslation();
-	auto const set_uniforms = [&light_position,&camera_position,&nowTime](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform1f(glGetUniformLocation(program, "time"), static_cast<float>(nowTime)/1000.0f);
+	// Camera, light and time are shared by all draws, through the FrameBlock.
+	// Per-draw and per-frame data is rewritten each frame, into a ring of
+	// buffers the GPU reads from while the next frames are prepared.
+	auto& frame_stream = eda221::getStreamBuffer();
+	auto const& water_reflection = eda221::getProgramReflection(water_shader);
+	auto const ring_width_location = water_reflection.get_location("clipmap_ring_width");
+	auto const levels_nb_location = water_reflection.get_location("clipmap_levels_nb");
+	auto const cell_size_location = water_reflection.get_location("clipmap_cell_size");
+	auto const center_location = water_reflection.get_location("clipmap_center");
+	auto const bounds_location = water_reflection.get_location("clipmap_bounds");
+	auto const ocean_enabled_location = water_reflection.get_location("ocean_enabled");
+	auto const ocean_patch_size_location = water_reflection.get_location("ocean_patch_size");
+	auto const set_water_uniforms = [&wave_system,&ocean,&ocean_enabled,&water_layout,&water_bounds,&camera_position,ring_width_location,levels_nb_location,cell_size_location,center_location,bounds_location,ocean_enabled_location,ocean_patch_size_location](GLuint program) {
+		wave_system.bind();
+		// The water is not transformed: model-space is world-space.
+		auto const center = parametric_shapes::getClipmapCenter(water_layout, glm::vec2(camera_position.x, camera_position.z));
+		glUniform1i(ring_width_location, static_cast<GLint>(water_layout.ring_width));
+		glUniform1i(levels_nb_location, static_cast<GLint>(water_layout.levels_nb));
+		glUniform1f(cell_size_location, water_layout.cell_size);
+		glUniform2fv(center_location, 1, glm::value_ptr(center));
+		glUniform4fv(bounds_location, 1, glm::value_ptr(water_bounds));
+		glUniform1i(ocean_enabled_location, ocean_enabled ? 1 : 0);
+		glUniform1f(ocean_patch_size_location, ocean.get_settings().patch_size);
 	};
 	auto polygon_mode = polygon_mode_t::fill;
 	auto water_quad = Node();
-	auto bumpTex = loadTexture2D("waves.png");
+	// Images are decoded in the background; textures show a placeholder
+	// colour until `texture_loader.poll()` uploads them.
+	eda221::texture_loader texture_loader;
+	auto bumpTex = texture_loader.load_texture_2D("waves.png", glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
 	std::string cubeName = "cloudyhills/";
-	auto cloud = loadTextureCubeMap(cubeName + "posx.png", cubeName + "negx.png", cubeName + "posy.png", cubeName + "negy.png", cubeName + "posz.png", cubeName + "negz.png",true);
+	auto cloud = texture_loader.load_texture_cube_map(cubeName + "posx.png", cubeName + "negx.png", cubeName + "posy.png", cubeName + "negy.png", cubeName + "posz.png", cubeName + "negz.png",true);
 	water_quad.set_geometry(quad_shape);
-	water_quad.set_program(water_shader, set_uniforms);
+	water_quad.set_program(water_shader, set_water_uniforms);
 	water_quad.add_texture("bumpTex",bumpTex);
 	water_quad.add_texture("cubeTex", cloud, GL_TEXTURE_CUBE_MAP);
 	glEnable(GL_DEPTH_TEST);
+
+	// The water's GPU time can be measured for an increasing number of
+	// waves; each count is kept for `benchmark_frames` timed frames, after
+	// letting the queries issued with the previous count complete.
+	eda221::gpu_timer water_timer;
+	unsigned int const benchmark_waves_nbs[] = { 1u, 2u, 4u, 8u, 16u, 24u, 32u };
+	size_t const benchmark_steps_nb = sizeof(benchmark_waves_nbs) / sizeof(benchmark_waves_nbs[0]);
+	unsigned int const benchmark_warmup_results = 8u;
+	unsigned int const benchmark_frames = 120u;
+	struct {
+		bool running;
+		size_t step;
+		unsigned int first_result; // timer results completed when the step began
+		unsigned int last_result;
+		unsigned int samples_nb;
+		double total_ms;
+	} waves_benchmark = { false, 0u, 0u, 0u, 0u, 0.0 };
+	auto const start_benchmark_step = [&](size_t step) {
+		waves_benchmark.step = step;
+		waves_benchmark.first_result = waves_benchmark.last_result = water_timer.get_results_nb();
+		waves_benchmark.samples_nb = 0u;
+		waves_benchmark.total_ms = 0.0;
+		wave_system.set_waves(eda221::generateWaves(benchmark_waves_nbs[step]));
+	};
 	// Enable face culling to improve performance:
 	//glEnable(GL_CULL_FACE);
 	//glCullFace(GL_FRONT);
 	//glCullFace(GL_BACK);
 
+	// CPU and GPU time of each part of the frame, see the Profiler window.
+	eda221::profiler profiler;
 
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeMilliseconds();
@@ -129,8 +198,15 @@ void eda221::Assignment4::run()
 			fpsSamples = 0;
 		}
 		fpsSamples++;
+		profiler.begin_frame();
+		frame_stream.begin_frame();
+		eda221::program_reflection::reset_name_lookups_nb();
 
 		glfwPollEvents();
+		{
+			eda221::profile_scope texture_uploads_scope(profiler, "texture uploads");
+			texture_loader.poll();
+		}
 		inputHandler->Advance();
 		mCamera.Update(ddeltatime, *inputHandler);
 
@@ -159,29 +235,90 @@ void eda221::Assignment4::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		water_quad.render(mCamera.GetWorldToClipMatrix(), water_quad.get_transform());
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		if (ocean_enabled) {
+			eda221::profile_scope ocean_upload_scope(profiler, "ocean upload");
+			ocean.update(static_cast<float>(nowTime) / 1000.0f);
+			water_quad.replace_texture("ocean_displacements", ocean.get_displacement_texture());
+			water_quad.replace_texture("ocean_normals", ocean.get_normal_texture());
+		}
+
+		{
+			eda221::profile_scope water_scope(profiler, "water");
+			eda221::setFrameBlock({ mCamera.GetWorldToClipMatrix(), camera_position,
+			                        static_cast<float>(nowTime) / 1000.0f, light_position, 0.0f });
 
-		bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
-		if (opened) {
-			ImGui::SliderFloat3("Light Position", glm::value_ptr(light_position), -20.0f, 20.0f);
-			//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+			water_timer.begin();
+			water_quad.render(mCamera.GetWorldToClipMatrix());
+			water_timer.end();
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		}
-		ImGui::End();
 
-		ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
-		if (opened)
-			ImGui::Text("%.3f ms, %.1f fps", ddeltatime, 1000 / (ddeltatime));
-		ImGui::End();
+		if (waves_benchmark.running && water_timer.get_results_nb() != waves_benchmark.last_result) {
+			waves_benchmark.last_result = water_timer.get_results_nb();
+			if (waves_benchmark.last_result > waves_benchmark.first_result + benchmark_warmup_results) {
+				waves_benchmark.total_ms += water_timer.get_milliseconds();
+				++waves_benchmark.samples_nb;
+			}
+			if (waves_benchmark.samples_nb == benchmark_frames) {
+				LogInfo("%2u waves: %.3f ms per frame on the water (%u vertices)",
+				        benchmark_waves_nbs[waves_benchmark.step], waves_benchmark.total_ms / waves_benchmark.samples_nb,
+				        static_cast<unsigned int>(water_quad.get_indices_nb()));
+				if (waves_benchmark.step + 1u < benchmark_steps_nb) {
+					start_benchmark_step(waves_benchmark.step + 1u);
+				} else {
+					waves_benchmark.running = false;
+					wave_system.set_waves(eda221::generateWaves(static_cast<unsigned int>(waves_nb)));
+				}
+			}
+		}
 
-		ImGui::Render();
+		{
+			eda221::profile_scope imgui_scope(profiler, "ImGui");
+			bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
+			if (opened) {
+				ImGui::SliderFloat3("Light Position", glm::value_ptr(light_position), -20.0f, 20.0f);
+				auto const ring_width_changed = ImGui::SliderInt("Water ring width", &water_ring_width, 1, 64);
+				auto const levels_nb_changed = ImGui::SliderInt("Water levels", &water_levels_nb, 1, 8);
+				if (ring_width_changed || levels_nb_changed) {
+					water_layout.ring_width = static_cast<unsigned int>(water_ring_width);
+					water_layout.levels_nb = static_cast<unsigned int>(water_levels_nb);
+					water_quad.set_indices_nb(parametric_shapes::getClipmapVerticesNb(water_layout));
+				}
+				ImGui::Text("%u water vertices", static_cast<unsigned int>(water_quad.get_indices_nb()));
+				ImGui::Checkbox("FFT ocean", &ocean_enabled);
+				if (ImGui::SliderInt("Waves", &waves_nb, 0, static_cast<int>(eda221::wave_system::max_waves_nb)) && !waves_benchmark.running)
+					wave_system.set_waves(eda221::generateWaves(static_cast<unsigned int>(waves_nb)));
+				if (waves_benchmark.running)
+					ImGui::Text("Benchmarking %u waves...", benchmark_waves_nbs[waves_benchmark.step]);
+				else if (ImGui::Button("Benchmark waves")) {
+					waves_benchmark.running = true;
+					start_benchmark_step(0u);
+				}
+				//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+			}
+			ImGui::End();
+
+			ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
+			if (opened)
+				ImGui::Text("%.3f ms, %.1f fps\n%.3f ms GPU on the water\n%u uniform name lookups", ddeltatime, 1000 / (ddeltatime),
+				            water_timer.get_milliseconds(),
+				            static_cast<unsigned int>(eda221::program_reflection::get_name_lookups_nb()));
+			if (opened && ocean_enabled)
+				ImGui::Text("%.3f ms ocean simulation", ocean.get_simulation_milliseconds());
+			ImGui::End();
+
+			profiler.show_window();
+			ImGui::Render();
+		}
 
+		profiler.end_frame();
+		frame_stream.end_frame();
 		window->Swap();
 		lastTime = nowTime;
 	}
 	glDeleteProgram(water_shader);
 	water_shader = 0u;
-
+	eda221::releaseStreamBuffer();
 }
 
 int main()
@@ -1,7 +1,20 @@
 #include "assignment5.hpp"
+#include "collision.hpp"
+#include "game_loop.hpp"
+#include "instanced_node.hpp"
 #include "interpolation.hpp"
 #include "node.hpp"
+#include "ocean.hpp"
 #include "parametric_shapes.hpp"
+#include "profiler.hpp"
+#include "program_reflection.hpp"
+#include "texture_loader.hpp"
+#include "render_queue.hpp"
+#include "ring_buffer.hpp"
+#include "spatial_hash.hpp"
+#include "stream_buffer.hpp"
+#include "uniform_buffers.hpp"
+#include "wave_system.hpp"
 
 
 #include "config.hpp"
@@ -23,8 +36,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <stdexcept>
+#include <vector>
 
 enum class polygon_mode_t : unsigned int {
 	fill = 0u,
@@ -37,10 +53,6 @@ static polygon_mode_t get_next_mode(polygon_mode_t mode)
 	return static_cast<polygon_mode_t>((static_cast<unsigned int>(mode) + 1u) % 3u);
 }
 
-bool testSphereSphere(glm::vec3 const&p1, float const r1, glm::vec3 const&p2, float const r2) {
-	return glm::length(p1 - p2) < (r1 + r2);
-}
-
 eda221::Assignment5::Assignment5()
 {
 	Log::View::Init();
@@ -69,8 +81,15 @@ eda221::Assignment5::~Assignment5()
 void eda221::Assignment5::run()
 {
 	// Loading the level geometry
-	// Water that goes to the edge of the skybox
-	auto water_shape = parametric_shapes::createQuad(100u, 100u, 200u, 200u);
+	// Water that goes to the edge of the skybox. It is a clipmap following
+	// the snake, generated by its vertex shader, so its levels can be
+	// changed at runtime.
+	auto water_layout = parametric_shapes::clipmap_layout{ 12u, 6u, 0.5f };
+	auto water_ring_width = static_cast<int>(water_layout.ring_width);
+	auto water_levels_nb = static_cast<int>(water_layout.levels_nb);
+	auto const water_bounds = glm::vec4(0.0f, 0.0f, 200.0f, 200.0f);
+	auto const water_translation = glm::vec3(-100.0f, -1.5f, -100.0f);
+	auto water_shape = parametric_shapes::createClipmap(water_layout);
 	if (water_shape.vao == 0u) {
 		LogError("Failed to retrive quad mesh");
 		return;
@@ -132,20 +151,22 @@ void eda221::Assignment5::run()
 		LogError("Failed to load water shader");
 		return;
 	}
+	// The lava is made of waves, possibly on top of an FFT ocean simulated
+	// on the CPU one frame ahead; the waves live in a uniform buffer,
+	// bound along with the water.
+	auto ocean_enabled = false;
+	eda221::ocean_surface ocean(eda221::ocean_settings{ 256u, 100.0f, glm::vec2(-8.0f, 3.0f), 5.0e-5f, 1.0f, 1u });
+	auto waves_nb = 2;
+	eda221::wave_system wave_system;
+	wave_system.set_waves(eda221::generateWaves(static_cast<unsigned int>(waves_nb)));
 	// Skybox shader for the skybox
 	auto skybox_shader = eda221::createProgram("skybox.vert", "skybox.frag");
 	if (skybox_shader == 0u) {
 		LogError("Failed to load skybox shader");
 		return;
 	}
-	// Shader for the snake head
-	auto snake_head_shader = eda221::createProgram("boundry.vert", "boundry.frag");
-	if (snake_head_shader == 0u) {
-		LogError("Failed to load snake head shader");
-		return;
-	}
-	// Shader for the boundry
-	auto boundry_shader = eda221::createProgram("boundry.vert", "boundry.frag");
+	// Shader for the boundry and the snake body, drawn as instanced batches
+	auto boundry_shader = eda221::createProgram("boundry_instanced.vert", "boundry.frag");
 	if (boundry_shader == 0u) {
 		LogError("Failed to load boundy shader");
 		return;
@@ -174,88 +195,147 @@ void eda221::Assignment5::run()
 	auto light_position = glm::vec3(-90.0f, 100.0f, -90.0f); // Light position;
 	mCamera.mWorld.SetTranslate(glm::vec3(-100.0f, 100.0f, -100.0f));
 	auto camera_position = mCamera.mWorld.GetTranslation();
-	auto const set_uniforms = [&light_position, &camera_position, &nowTime](GLuint program) {
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform1f(glGetUniformLocation(program, "time"), static_cast<float>(nowTime) / 1000.0f);
-	};
+	// Camera, light and time are shared by all draws, through the FrameBlock.
+	// Per-draw and per-frame data is rewritten each frame, into a ring of
+	// buffers the GPU reads from while the next frames are prepared.
+	auto& frame_stream = eda221::getStreamBuffer();
+
+	// The snake and the boundries share the stone material, so the render
+	// queue only binds it once for both batches.
+	eda221::material stone_material({ glm::vec3(0.0f), 100.0f, glm::vec3(1.0f), 0.0f, glm::vec3(1.0f), 0.0f });
+	eda221::material food_material({ glm::vec3(0.0f), 100.0f, glm::vec3(0.8f, 0.6f, 0.2f), 0.0f, glm::vec3(0.3f), 0.0f });
 
 	auto polygon_mode = polygon_mode_t::fill;
 
-	auto bumpTex = loadTexture2D("lavanormal.png");
+	// Images are decoded in the background; textures show a placeholder
+	// colour until `texture_loader.poll()` uploads them.
+	eda221::texture_loader texture_loader;
+	auto bumpTex = texture_loader.load_texture_2D("lavanormal.png", glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
 	std::string cubeName = "Lava/";
-	auto cloud = loadTextureCubeMap(cubeName + "posx.png", cubeName + "negx.png", cubeName + "posy.png", cubeName + "negy.png", cubeName + "posz.png", cubeName + "negz.png", true);
-	auto stone_tex = loadTexture2D("fieldstone_diffuse.png");
-	auto stone_bump = loadTexture2D("fieldstone_bump.png");
+	auto cloud = texture_loader.load_texture_cube_map(cubeName + "posx.png", cubeName + "negx.png", cubeName + "posy.png", cubeName + "negy.png", cubeName + "posz.png", cubeName + "negz.png", true);
+	auto stone_tex = texture_loader.load_texture_2D("fieldstone_diffuse.png");
+	auto stone_bump = texture_loader.load_texture_2D("fieldstone_bump.png", glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
 	//Level Node
 	auto water_quad = Node();
 	water_quad.set_geometry(water_shape);
-	water_quad.set_program(water_shader, set_uniforms);
+	// The clipmap follows the snake, which is declared further down.
+	auto water_viewer = glm::vec2(0.0f, 0.0f);
+	auto const& water_reflection = eda221::getProgramReflection(water_shader);
+	auto const ring_width_location = water_reflection.get_location("clipmap_ring_width");
+	auto const levels_nb_location = water_reflection.get_location("clipmap_levels_nb");
+	auto const cell_size_location = water_reflection.get_location("clipmap_cell_size");
+	auto const center_location = water_reflection.get_location("clipmap_center");
+	auto const bounds_location = water_reflection.get_location("clipmap_bounds");
+	auto const ocean_enabled_location = water_reflection.get_location("ocean_enabled");
+	auto const ocean_patch_size_location = water_reflection.get_location("ocean_patch_size");
+	auto const set_water_uniforms = [&wave_system, &ocean, &ocean_enabled, &water_layout, &water_bounds, &water_viewer, ring_width_location, levels_nb_location, cell_size_location, center_location, bounds_location, ocean_enabled_location, ocean_patch_size_location](GLuint program) {
+		wave_system.bind();
+		auto const center = parametric_shapes::getClipmapCenter(water_layout, water_viewer);
+		glUniform1i(ring_width_location, static_cast<GLint>(water_layout.ring_width));
+		glUniform1i(levels_nb_location, static_cast<GLint>(water_layout.levels_nb));
+		glUniform1f(cell_size_location, water_layout.cell_size);
+		glUniform2fv(center_location, 1, glm::value_ptr(center));
+		glUniform4fv(bounds_location, 1, glm::value_ptr(water_bounds));
+		glUniform1i(ocean_enabled_location, ocean_enabled ? 1 : 0);
+		glUniform1f(ocean_patch_size_location, ocean.get_settings().patch_size);
+	};
+	water_quad.set_program(water_shader, set_water_uniforms);
 	water_quad.add_texture("bumpTex", bumpTex);
 	water_quad.add_texture("cubeTex", cloud, GL_TEXTURE_CUBE_MAP);
 	//Skybox Node
 	auto skybox = Node();
 	skybox.set_geometry(skybox_shape);
-	skybox.set_program(skybox_shader, set_uniforms);
+	skybox.set_program(skybox_shader);
 	skybox.add_texture("cubeMapName", cloud, GL_TEXTURE_CUBE_MAP);
-	//Snake head Node
+	//Snake head Node: only carries the transform of the head, which is
+	//drawn by its child
 	auto snake_head = Node();
-	snake_head.set_geometry(snake_shape);
-	snake_head.set_program(snake_head_shader, set_uniforms);
 	auto snake_head_t = Node();
 	snake_head_t.set_geometry(head_shape.at(0));
-	snake_head_t.set_program(ogre_shader, set_uniforms);
+	snake_head_t.set_program(ogre_shader);
 	snake_head.add_child(&snake_head_t);
 	snake_head.scale(glm::vec3(2, 2, 2));
 
-	//Snake body nodes
-	int const no_snake = 500;
-	Node snake_bodies[no_snake];
-	for (int i = 0; i < no_snake; i++) {
-		snake_bodies[i].set_geometry(snake_shape);
-		snake_bodies[i].set_program(snake_head_shader, set_uniforms);
-		snake_bodies[i].add_texture("myBumpMap", stone_bump);
-		snake_bodies[i].add_texture("thisTex", stone_tex);
-	}
+	//Snake body batch: one instance per body segment
+	InstancedNode snake_bodies;
+	snake_bodies.set_geometry(snake_shape);
+	snake_bodies.set_program(boundry_shader);
+	snake_bodies.set_material(&stone_material);
+	snake_bodies.add_texture("myBumpMap", stone_bump);
+	snake_bodies.add_texture("thisTex", stone_tex);
 	//Food node
 	auto food = Node();
 	food.set_geometry(food_shape);
-	food.set_program(food_shader, set_uniforms);
+	food.set_program(food_shader);
+	food.set_material(&food_material);
 
 	//Creation of boundry nodes.
 
 	int const no_boundries = 100;
-	Node boundries[no_boundries];
-	Node tetras[no_boundries];
+	InstancedNode boundries;
+	boundries.set_geometry(boundry_shape);
+	boundries.set_program(boundry_shader);
+	boundries.set_material(&stone_material);
+	boundries.add_texture("myBumpMap", stone_bump);
+	boundries.add_texture("thisTex", stone_tex);
 	glm::vec3 boundry_pos[no_boundries];
-	for (int i = 0; i < no_boundries; i++) {
-		boundries[i].set_geometry(boundry_shape);
-		boundries[i].set_program(boundry_shader, set_uniforms);
-		boundries[i].add_child(&tetras[i]);
-		boundries[i].add_texture("myBumpMap", stone_bump);
-		boundries[i].add_texture("thisTex", stone_tex);
-		/*
-		tetras[i].set_geometry(tetra.at(0));
-		tetras[i].set_program(boundry_shader,set_uniforms);*/
-	}
 	for (int i = 0; i < 25; i++) {
-		boundries[i].set_translation(glm::vec3(-100.0f, 0.0f, 100.0f - 8 * i));
 		boundry_pos[i] = glm::vec3(-100.0f, 0.0f, 100.0f - 8 * i);
-
-		boundries[i + 25].set_translation(glm::vec3(100.0f, 0.0f, 8 * i - 100.0f));
 		boundry_pos[i + 25] = glm::vec3(100.0f, 0.0f, 8 * i - 100.0f);
-
-		boundries[i + 50].set_translation(glm::vec3(-100.0f + 8 * i, 0.0f, -100.0f));
 		boundry_pos[i + 50] = glm::vec3(-100.0f + 8 * i, 0.0f, -100.0f);
-
-		boundries[i + 75].set_translation(glm::vec3(100.0f - 8 * i, 0.0f, 100.0f));
 		boundry_pos[i + 75] = glm::vec3(100.0f - 8 * i, 0.0f, 100.0f);
 	}
-
-	glm::vec3 cp[no_snake]; // no_snake control points
-	for (int i = 0; i < no_snake; i++) {
-		cp[i] = glm::vec3(0, 0, 0);
+	// The boundries never move: upload their transforms once.
+	std::vector<glm::mat4> boundry_transforms(no_boundries);
+	for (int i = 0; i < no_boundries; i++) {
+		boundry_transforms[i] = glm::translate(glm::mat4(), boundry_pos[i]);
 	}
+	boundries.set_instances(boundry_transforms);
+	eda221::spatial_hash boundry_grid(2.0f * boundry_radius, no_boundries);
+	for (int i = 0; i < no_boundries; i++) {
+		boundry_grid.insert(static_cast<std::uint32_t>(i), boundry_pos[i], boundry_radius);
+	}
+
+	// Positions of the body segments, newest first. Each segment keeps its
+	// slot in the ring until it is dropped, and instance i of snake_bodies
+	// mirrors slot i: a step only uploads the new segment.
+	eda221::ring_buffer<glm::vec3> trail;
+	trail.push_front(glm::vec3(0.0f, 0.0f, 0.0f));
+	snake_bodies.set_instances(std::vector<glm::mat4>(trail.capacity(), glm::mat4()));
+	snake_bodies.set_instances_range(trail.get_slot(0u), 1u);
+	// The live segments, by slot, each bounded with its capsule towards
+	// the next older segment: however far apart they were laid, a query
+	// around the head finds every capsule it can touch.
+	eda221::spatial_hash trail_grid(2.0f * snake_radius);
+	auto const index_segment = [&trail, &trail_grid, snake_radius](size_t i) {
+		auto const& older = i + 1u < trail.size() ? trail[i + 1u] : trail[i];
+		trail_grid.insert(static_cast<std::uint32_t>(trail.get_slot(i)), 0.5f * (trail[i] + older),
+		                  snake_radius + 0.5f * glm::distance(trail[i], older));
+	};
+	index_segment(0u);
+	auto const drop_tail = [&trail, &trail_grid](size_t kept_nb) {
+		while (trail.size() > kept_nb) {
+			trail_grid.remove(static_cast<std::uint32_t>(trail.get_slot(trail.size() - 1u)));
+			trail.pop_back();
+		}
+	};
+	auto const push_segment = [&trail, &trail_grid, &snake_bodies, &index_segment](glm::vec3 const& position) {
+		if (trail.push_front(position)) {
+			std::vector<glm::mat4> snake_transforms(trail.capacity());
+			for (size_t i = 0; i < snake_transforms.size(); i++) {
+				snake_transforms[i] = glm::translate(glm::mat4(), trail.get_slot_value(i));
+			}
+			snake_bodies.set_instances(snake_transforms);
+			// Every segment moved to a new slot.
+			trail_grid.clear();
+			for (size_t i = 0; i < trail.size(); i++) {
+				index_segment(i);
+			}
+		} else {
+			snake_bodies.set_instance(trail.get_slot(0u), glm::translate(glm::mat4(), position));
+			index_segment(0u);
+		}
+	};
 
 
 	glEnable(GL_DEPTH_TEST);
@@ -265,7 +345,7 @@ void eda221::Assignment5::run()
 	//glCullFace(GL_BACK);
 
 	//Initializing positions.
-	water_quad.translate(glm::vec3(-100.0f, -1.5f, -100.0f)); // Moving lava down
+	water_quad.translate(water_translation); // Moving lava down
 	snake_head.set_translation(glm::vec3(0.0f, 0.0f, 0.0f)); // centering snake head:
 	float turning = 0.0f; //init angle
 	float speed = 50.0f; // init speed
@@ -282,6 +362,86 @@ void eda221::Assignment5::run()
 	unsigned int high_score = 0;
 	float distance = 0;
 	unsigned int camera_mode = 0;
+	// The snake moves in fixed ticks, whatever the frame rate, and each
+	// tick sweeps it from its previous position: it cannot jump over a
+	// boundry or its own body, however long a frame or low the tick rate.
+	// It is drawn in between the last two ticks.
+	struct snake_state {
+		glm::vec3 position;
+		float turning;
+		unsigned int lives; // respawns teleport, and are not interpolated
+	};
+	int tick_rate = 120; // in Hz
+	// Past this many ticks per frame, the game slows down instead of
+	// spiralling into ever longer frames.
+	unsigned int const max_ticks_per_frame = 32u;
+	float const turn_speed = 6.0f; // in radians per second
+	// Back to the start, with an empty body.
+	auto const respawn = [&](snake_state& state) {
+		state.position = glm::vec3(0.0f, 0.0f, 0.0f);
+		++state.lives;
+		if (score > high_score) {
+			high_score = score;
+		}
+		score = 0;
+		distance = 0;
+		drop_tail(0u);
+		push_segment(state.position);
+	};
+	// The ticks upload the body and move the food: they have to run on
+	// the render thread.
+	auto const tick = [&](snake_state& state, float const& turn_direction, double step_seconds) {
+		auto const tick_seconds = static_cast<float>(step_seconds);
+		state.turning = fmod(state.turning + turn_direction * turn_speed * tick_seconds, bonobo::two_pi);
+		auto const step = speed * tick_seconds;
+		auto const next_pos = state.position + step * glm::vec3(cos(state.turning), 0.0f, -sin(state.turning));
+
+		// Testing collision, over the whole step
+		auto hit_time = 0.0f;
+		auto hit = boundry_grid.find_first_hit(state.position, next_pos, snake_radius, hit_time) != eda221::spatial_hash::no_id;
+		// The body is a chain of capsules between consecutive segments,
+		// each indexed by its bounding sphere. The two newest segments
+		// always touch the head.
+		auto const hittable_nb = std::min<size_t>(score, trail.size());
+		auto const hits_body = [&](std::uint32_t slot) {
+			auto const i = trail.get_index(slot);
+			if (i < 2 || i >= hittable_nb)
+				return false;
+			auto const& older = i + 1 < hittable_nb ? trail[i + 1] : trail[i];
+			return eda221::sweepSphereCapsule(state.position, next_pos, snake_radius, trail[i], older, snake_radius, hit_time);
+		};
+		hit = hit || trail_grid.find_overlap(0.5f * (state.position + next_pos), snake_radius + 0.5f * step, hits_body) != eda221::spatial_hash::no_id;
+		if (hit) {
+			respawn(state);
+			return;
+		}
+
+		if (eda221::sweepSphereSphere(state.position, next_pos, snake_radius, food_pos, food_radius, hit_time)) {
+			score++;
+			food_pos.x = rand() % 180 - 90;
+			food_pos.z = rand() % 180 - 90;
+			// Retry until the food lands off the snake.
+			while (eda221::testSphereSphere(next_pos, snake_radius, food_pos, food_radius)
+			    || trail_grid.find_overlap(food_pos, food_radius) != eda221::spatial_hash::no_id) {
+				food_pos.x = rand() % 180 - 90;
+				food_pos.z = rand() % 180 - 90;
+			}
+			food.set_translation(food_pos);
+		}
+
+		state.position = next_pos;
+		distance += step;
+		if (distance > 2 * snake_radius) {
+			distance = 0;
+			// Make room first, so that the ring only grows with the score.
+			drop_tail(score);
+			push_segment(state.position);
+		}
+	};
+	eda221::game_loop<snake_state, float> snake_loop(snake_state{ snake_pos, turning, 0u }, 1.0 / tick_rate, tick, max_ticks_per_frame);
+	eda221::render_queue render_queue;
+	// CPU and GPU time of each part of the frame, see the Profiler window.
+	eda221::profiler profiler;
 	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
 		nowTime = GetTimeMilliseconds();
 		ddeltatime = nowTime - lastTime;
@@ -290,8 +450,15 @@ void eda221::Assignment5::run()
 			fpsSamples = 0;
 		}
 		fpsSamples++;
+		profiler.begin_frame();
+		frame_stream.begin_frame();
+		eda221::program_reflection::reset_name_lookups_nb();
 
 		glfwPollEvents();
+		{
+			eda221::profile_scope texture_uploads_scope(profiler, "texture uploads");
+			texture_loader.poll();
+		}
 		inputHandler->Advance();
 		mCamera.Update(ddeltatime, *inputHandler);
 
@@ -319,11 +486,12 @@ void eda221::Assignment5::run()
 			camera_mode = (camera_mode + 1) % 3;
 		}
 
+		float turn_direction = 0.0f;
 		if (inputHandler->GetKeycodeState(GLFW_KEY_LEFT) & PRESSED) {
-			turning = fmod(turning + 0.1, bonobo::two_pi);
+			turn_direction = 1.0f;
 		}
 		else if (inputHandler->GetKeycodeState(GLFW_KEY_RIGHT) & PRESSED) {
-			turning = fmod(turning - 0.1, bonobo::two_pi);
+			turn_direction = -1.0f;
 		}
 		if (camera_mode == 0) {
 			mCamera.mWorld.SetTranslate(glm::vec3((snake_pos.x - sin(turning + bonobo::pi / 2)*60.0f), 20.0f, snake_pos.z - cos(turning + bonobo::pi / 2)* 60.0f));
@@ -338,104 +506,108 @@ void eda221::Assignment5::run()
 			mCamera.mWorld.LookAt(glm::vec3(snake_pos.x, snake_pos.y, snake_pos.z));
 		}
 
-		snake_head.translate(glm::vec3(speed*ddeltatime / 1000 * cos(turning), 0.0f, -speed*ddeltatime / 1000 * sin(turning)));
-		snake_head.set_rotation_y(turning + bonobo::pi / 2);
-		snake_pos = glm::vec3(snake_pos.x + speed*ddeltatime / 1000 * cos(turning), 0, snake_pos.z - speed*ddeltatime / 1000 * sin(turning));
-
-		//if ((int)(nowTime/1000) % (int)(2 * snake_radius / (speed*ddeltatime / 1000)) == 0) {
-		if (distance > 2 * snake_radius) {
-			for (int i = no_snake - 1; i > 0; i--) {
-				cp[i] = cp[i - 1];
-			}
-			distance = 0;
-			cp[0] = snake_pos;
-		}
-		for (int i = 0; i < no_snake; i++) {
-			snake_bodies[i].set_translation(cp[i]);
+		{
+			eda221::profile_scope simulation_scope(profiler, "simulation");
+			snake_loop.set_input(turn_direction);
+			snake_loop.advance(ddeltatime / 1000.0);
 		}
+		auto const& previous = snake_loop.get_previous();
+		auto const& current = snake_loop.get_current();
+		auto const alpha = previous.lives == current.lives ? snake_loop.get_alpha() : 1.0f;
+		snake_pos = interpolation::evalLERP(previous.position, current.position, alpha);
+		turning = current.turning;
+		snake_head.set_translation(snake_pos);
+		snake_head.set_rotation_y(turning + bonobo::pi / 2);
 
-
-
-		// Testing collision
-		for (int i = 0; i < no_boundries; i++) {
-			if (testSphereSphere(snake_pos, snake_radius, boundry_pos[i], boundry_radius)) {
-				snake_head.translate(glm::vec3(-snake_pos.x, 0, -snake_pos.z));
-				snake_pos = glm::vec3(0.0f, 0.0f, 0.0f);
-				if (score > high_score) {
-					high_score = score;
-				}
-				score = 0;
-			}
-		}
-		for (int i = 2; i < score; i++) {
-			if (testSphereSphere(snake_pos, snake_radius, cp[i], snake_radius)) {
-				snake_head.translate(glm::vec3(-snake_pos.x, 0, -snake_pos.z));
-				snake_pos = glm::vec3(0.0f, 0.0f, 0.0f);
-				if (score > high_score) {
-					high_score = score;
-				}
-				score = 0;
-			}
-		}
-		if (testSphereSphere(snake_pos, snake_radius, food_pos, food_radius)) {
-			score++;
-			food_pos.x = rand() % 180 - 90;
-			food_pos.z = rand() % 180 - 90;
-			int food_test = 0;
-			while(food_test == 0){
-				food_test = 1;
-				if (abs(snake_pos.x - food_pos.x) < 2 || abs(snake_pos.z - food_pos.z) < 2) {
-					food_test = 0;
-				}
-				for (int i = 0; i < (score + 1); i++) {
-					if (abs(cp[i].x - food_pos.x) < 2 || abs(cp[i].z - food_pos.z) < 2) {
-						food_test = 0;
-					}
-				}
-				if (food_test == 0) {
-					food_pos.x = rand() % 180 - 90;
-					food_pos.z = rand() % 180 - 90;
-				}
-			}
-			food.set_translation(food_pos);
-		}
+		snake_bodies.set_instances_range(trail.get_slot(trail.size() - 1u), trail.size());
 
 		//mCamera.mWorld.LookAt(glm::vec3());
 		camera_position = mCamera.mWorld.GetTranslation();
+		water_viewer = glm::vec2(snake_pos.x - water_translation.x, snake_pos.z - water_translation.z);
 		auto const window_size = window->GetDimensions();
 		glViewport(0, 0, window_size.x, window_size.y);
 		glClearDepthf(1.0f);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		water_quad.render(mCamera.GetWorldToClipMatrix(), water_quad.get_transform());
-		skybox.render(mCamera.GetWorldToClipMatrix(), skybox.get_transform());
-		snake_head_t.render(mCamera.GetWorldToClipMatrix(), snake_head.get_transform());
-		food.render(mCamera.GetWorldToClipMatrix(), food.get_transform());
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		for (int i = 0; i < no_boundries; i++) {
-			boundries[i].render(mCamera.GetWorldToClipMatrix(), boundries[i].get_transform());
-		}
-		for (int i = 0; i < score + 1 && i < no_snake; i++) {
-			snake_bodies[i].render(mCamera.GetWorldToClipMatrix(), snake_bodies[i].get_transform());
+		if (ocean_enabled) {
+			eda221::profile_scope ocean_upload_scope(profiler, "ocean upload");
+			ocean.update(static_cast<float>(nowTime) / 1000.0f);
+			water_quad.replace_texture("ocean_displacements", ocean.get_displacement_texture());
+			water_quad.replace_texture("ocean_normals", ocean.get_normal_texture());
 		}
-		bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
-		if (opened) {
-			//ImGui::SliderFloat("Speed", &speed, 0.0f, 50.0f);
-			//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+
+		eda221::setFrameBlock({ mCamera.GetWorldToClipMatrix(), camera_position,
+		                        static_cast<float>(nowTime) / 1000.0f, light_position, 0.0f });
+
+		render_queue.reset_stats();
+		{
+			eda221::profile_scope render_scope(profiler, "render");
+			render_queue.set_world_to_clip(mCamera.GetWorldToClipMatrix());
+			{
+				eda221::profile_scope scene_scope(profiler, "scene");
+				water_quad.enqueue(render_queue);
+				skybox.enqueue(render_queue);
+				snake_head.enqueue(render_queue);
+				food.enqueue(render_queue);
+				render_queue.flush();
+			}
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			{
+				eda221::profile_scope stones_scope(profiler, "stones");
+				boundries.enqueue(render_queue);
+				snake_bodies.enqueue(render_queue);
+				render_queue.flush();
+			}
 		}
-		ImGui::End();
 
-		ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
-		if (opened)
-			ImGui::Text(" %.0f fps \n Score: %d \n Highscore: %d", 1000 / (ddeltatime), score, high_score);
-		ImGui::End();
+		{
+			eda221::profile_scope imgui_scope(profiler, "ImGui");
+			bool opened = ImGui::Begin("Scene Control", &opened, ImVec2(300, 100), -1.0f, 0);
+			if (opened) {
+				ImGui::SliderFloat("Speed", &speed, 0.0f, 200.0f);
+				if (ImGui::SliderInt("Tick rate (Hz)", &tick_rate, 10, 240))
+					snake_loop.set_step_seconds(1.0 / tick_rate);
+				auto const ring_width_changed = ImGui::SliderInt("Water ring width", &water_ring_width, 1, 64);
+				auto const levels_nb_changed = ImGui::SliderInt("Water levels", &water_levels_nb, 1, 8);
+				if (ring_width_changed || levels_nb_changed) {
+					water_layout.ring_width = static_cast<unsigned int>(water_ring_width);
+					water_layout.levels_nb = static_cast<unsigned int>(water_levels_nb);
+					water_quad.set_indices_nb(parametric_shapes::getClipmapVerticesNb(water_layout));
+				}
+				ImGui::Text("%u water vertices", static_cast<unsigned int>(water_quad.get_indices_nb()));
+				ImGui::Checkbox("FFT ocean", &ocean_enabled);
+				if (ImGui::SliderInt("Waves", &waves_nb, 0, static_cast<int>(eda221::wave_system::max_waves_nb)))
+					wave_system.set_waves(eda221::generateWaves(static_cast<unsigned int>(waves_nb)));
+				//			ImGui::SliderInt("Faces Nb", &faces_nb, 1u, 16u);
+			}
+			ImGui::End();
+
+			ImGui::Begin("Render Time", &opened, ImVec2(120, 50), -1.0f, 0);
+			if (opened) {
+				auto const& stats = render_queue.get_stats();
+				ImGui::Text(" %.0f fps \n Score: %d \n Highscore: %d \n %u uniform name lookups", 1000 / (ddeltatime), score, high_score,
+				            static_cast<unsigned int>(eda221::program_reflection::get_name_lookups_nb()));
+				if (ocean_enabled)
+					ImGui::Text(" %.3f ms ocean simulation", ocean.get_simulation_milliseconds());
+				ImGui::Text(" %u draws \n %u program switches \n %u texture binds \n %u VAO switches \n %u material binds",
+				            static_cast<unsigned int>(stats.draws), static_cast<unsigned int>(stats.program_switches),
+				            static_cast<unsigned int>(stats.texture_binds), static_cast<unsigned int>(stats.vao_switches),
+				            static_cast<unsigned int>(stats.material_binds));
+				ImGui::Text(" %u bytes streamed \n %u stream stalls", static_cast<unsigned int>(frame_stream.get_frame_usage()),
+				            static_cast<unsigned int>(frame_stream.get_stalls_nb()));
+			}
+			ImGui::End();
+
+			profiler.show_window();
+			ImGui::Render();
+		}
 
-		ImGui::Render();
+		profiler.end_frame();
+		frame_stream.end_frame();
 		window->Swap();
 		lastTime = nowTime;
 
-		distance = distance + sqrt(pow(speed*ddeltatime / 1000 * cos(turning), 2) + pow(speed*ddeltatime / 1000 * sin(turning), 2));
 
 
 
@@ -445,8 +617,9 @@ void eda221::Assignment5::run()
 	water_shader = 0u;
 	glDeleteProgram(skybox_shader);
 	skybox_shader = 0u;
-	glDeleteProgram(snake_head_shader);
-	snake_head_shader = 0u;
+	glDeleteProgram(boundry_shader);
+	boundry_shader = 0u;
+	eda221::releaseStreamBuffer();
 }
 
 int main()
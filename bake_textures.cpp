@@ -0,0 +1,64 @@
+#include "texture_compression.hpp"
+
+#include "core/Bonobo.h"
+#include "core/Log.h"
+
+#include <string>
+#include <vector>
+
+//
+// Offline tool compressing textures into the texture cache (see
+// `eda221::bakeTexture2D()`), which the texture loaders then read instead
+// of the PNG images.
+//
+// Usage: bake_textures [texture.png...] [--cube folder/...]
+//
+// Textures are relative to `res/textures`; cube map folders are relative
+// to `res/cubemaps` and should contain posx.png, negx.png, ..., negz.png.
+// Without arguments, the textures used by the assignments are baked.
+//
+
+namespace
+{
+	bool
+	bake_cube_map(std::string const& folder)
+	{
+		return eda221::bakeTextureCubeMap(folder + "posx.png", folder + "negx.png",
+		                                  folder + "posy.png", folder + "negy.png",
+		                                  folder + "posz.png", folder + "negz.png");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Bonobo::Init();
+
+	std::vector<std::string> textures;
+	std::vector<std::string> cube_maps;
+	if (argc <= 1) {
+		textures = { "earth_diffuse.png", "earth_bump.png", "waves.png", "lavanormal.png",
+		             "fieldstone_diffuse.png", "fieldstone_bump.png" };
+		cube_maps = { "forbidden/", "cloudyhills/", "Lava/" };
+	}
+	for (int i = 1; i < argc; ++i) {
+		auto const argument = std::string(argv[i]);
+		if (argument == "--cube" && i + 1 < argc)
+			cube_maps.emplace_back(argv[++i]);
+		else
+			textures.push_back(argument);
+	}
+
+	auto failures_nb = 0;
+	for (auto const& texture : textures)
+		if (!eda221::bakeTexture2D(texture))
+			++failures_nb;
+	for (auto const& cube_map : cube_maps)
+		if (!bake_cube_map(cube_map))
+			++failures_nb;
+
+	if (failures_nb != 0)
+		LogError("%d textures could not be baked", failures_nb);
+
+	Bonobo::Destroy();
+	return failures_nb == 0 ? 0 : 1;
+}
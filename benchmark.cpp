@@ -0,0 +1,191 @@
+#include "benchmark.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<std::uint64_t> allocations_nb(0u);
+	std::atomic<std::uint64_t> bytes_allocated(0u);
+	std::atomic<std::int64_t> live_bytes(0);
+	std::atomic<std::int64_t> live_bytes_at_reset(0);
+	std::atomic<std::int64_t> peak_live_bytes(0);
+
+	// Each allocation is prefixed with its size, so that `operator delete`
+	// knows how much memory is released; the prefix keeps the returned
+	// pointer aligned like `malloc()` does.
+	std::size_t const header_size = alignof(std::max_align_t);
+
+	void*
+	tracked_allocate(std::size_t size) noexcept
+	{
+		auto const block = static_cast<unsigned char*>(std::malloc(size + header_size));
+		if (block == nullptr)
+			return nullptr;
+		*reinterpret_cast<std::size_t*>(block) = size;
+
+		allocations_nb.fetch_add(1u, std::memory_order_relaxed);
+		bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+		auto const live = live_bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed)
+		                + static_cast<std::int64_t>(size);
+		auto peak = peak_live_bytes.load(std::memory_order_relaxed);
+		while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+			;
+
+		return block + header_size;
+	}
+
+	void*
+	tracked_allocate_or_throw(std::size_t size)
+	{
+		for (;;) {
+			if (auto const pointer = tracked_allocate(size))
+				return pointer;
+			auto const handler = std::get_new_handler();
+			if (handler == nullptr)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void
+	tracked_free(void* pointer) noexcept
+	{
+		if (pointer == nullptr)
+			return;
+		auto const block = static_cast<unsigned char*>(pointer) - header_size;
+		auto const size = *reinterpret_cast<std::size_t*>(block);
+		live_bytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+		std::free(block);
+	}
+
+	std::string
+	format_bytes(double bytes)
+	{
+		char const* const units[] = { "B", "KiB", "MiB", "GiB" };
+		auto unit = 0u;
+		while (bytes >= 1024.0 && unit < 3u) {
+			bytes /= 1024.0;
+			++unit;
+		}
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.1f %s", bytes, units[unit]);
+		return buffer;
+	}
+}
+
+void* operator new(std::size_t size) { return tracked_allocate_or_throw(size); }
+void* operator new[](std::size_t size) { return tracked_allocate_or_throw(size); }
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept { return tracked_allocate(size); }
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept { return tracked_allocate(size); }
+void operator delete(void* pointer) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { tracked_free(pointer); }
+void operator delete(void* pointer, std::nothrow_t const&) noexcept { tracked_free(pointer); }
+void operator delete[](void* pointer, std::nothrow_t const&) noexcept { tracked_free(pointer); }
+
+void
+eda221::resetAllocationStats()
+{
+	allocations_nb = 0u;
+	bytes_allocated = 0u;
+	live_bytes_at_reset = live_bytes.load();
+	peak_live_bytes = live_bytes.load();
+}
+
+eda221::allocation_stats
+eda221::getAllocationStats()
+{
+	allocation_stats stats;
+	stats.allocations_nb = allocations_nb.load();
+	stats.bytes_allocated = bytes_allocated.load();
+	stats.peak_bytes = static_cast<std::uint64_t>(std::max<std::int64_t>(peak_live_bytes.load() - live_bytes_at_reset.load(), 0));
+	return stats;
+}
+
+eda221::benchmark_state::benchmark_state(double min_time, std::uint64_t max_iterations) :
+	_min_time(min_time), _max_iterations(std::max<std::uint64_t>(max_iterations, 1u)),
+	_iterations_nb(0u), _items_nb(0u), _elapsed(clock::duration::zero()), _start(), _is_timing(false)
+{
+}
+
+bool
+eda221::benchmark_state::keep_running()
+{
+	if (_iterations_nb == 0u && !_is_timing) {
+		resetAllocationStats();
+		resume_timing();
+		_iterations_nb = 1u;
+		return true;
+	}
+
+	pause_timing();
+	if (_iterations_nb >= _max_iterations || get_elapsed_seconds() >= _min_time)
+		return false;
+	++_iterations_nb;
+	resume_timing();
+	return true;
+}
+
+void
+eda221::benchmark_state::pause_timing()
+{
+	if (!_is_timing)
+		return;
+	_elapsed += clock::now() - _start;
+	_is_timing = false;
+}
+
+void
+eda221::benchmark_state::resume_timing()
+{
+	if (_is_timing)
+		return;
+	_start = clock::now();
+	_is_timing = true;
+}
+
+double
+eda221::benchmark_state::get_elapsed_seconds() const
+{
+	auto elapsed = _elapsed;
+	if (_is_timing)
+		elapsed += clock::now() - _start;
+	return std::chrono::duration<double>(elapsed).count();
+}
+
+eda221::benchmark_result
+eda221::runBenchmark(std::string const& name, std::function<void (benchmark_state&)> const& function,
+                     double min_time, std::uint64_t max_iterations)
+{
+	auto state = benchmark_state(min_time, max_iterations);
+	function(state);
+	auto const allocations = getAllocationStats();
+
+	benchmark_result result;
+	result.name = name;
+	result.iterations_nb = std::max<std::uint64_t>(state.get_iterations(), 1u);
+	result.seconds = state.get_elapsed_seconds() / result.iterations_nb;
+	result.items_per_second = state.get_elapsed_seconds() > 0.0
+	                        ? state.get_items_processed() / state.get_elapsed_seconds()
+	                        : 0.0;
+	result.bytes_allocated = allocations.bytes_allocated / result.iterations_nb;
+	result.allocations_nb = allocations.allocations_nb / result.iterations_nb;
+	result.peak_bytes = allocations.peak_bytes;
+
+	LogInfo("%-36s %8llu it %12.3f ms %10.2f Mitems/s %12s alloc/it (%llu) %12s peak",
+	        name.c_str(), static_cast<unsigned long long>(result.iterations_nb),
+	        result.seconds * 1000.0, result.items_per_second / 1.0e6,
+	        format_bytes(static_cast<double>(result.bytes_allocated)).c_str(),
+	        static_cast<unsigned long long>(result.allocations_nb),
+	        format_bytes(static_cast<double>(result.peak_bytes)).c_str());
+
+	return result;
+}
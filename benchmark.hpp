@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+//
+// Minimal benchmark harness, in the spirit of Google Benchmark, for code
+// that runs without an OpenGL context.
+//
+// Linking benchmark.cpp replaces the global `operator new` and
+// `operator delete`, so that allocations made while a benchmark runs
+// can be reported.
+//
+
+namespace eda221
+{
+	//! \brief Heap usage since the last call to `resetAllocationStats()`.
+	struct allocation_stats {
+		std::uint64_t allocations_nb;  //!< number of calls to `operator new`
+		std::uint64_t bytes_allocated; //!< total size of those allocations
+		std::uint64_t peak_bytes;      //!< highest amount of memory live at
+		                               //!< once, on top of what was live
+		                               //!< when the stats were reset
+	};
+
+	//! \brief Restart tracking allocations from the current heap usage.
+	void resetAllocationStats();
+
+	//! \brief Get the allocations made since `resetAllocationStats()`.
+	allocation_stats getAllocationStats();
+
+	//! \brief Drives the iterations of a benchmark, and gathers what it
+	//!        measures.
+	//!
+	//! The benchmarked function should look like:
+	//!
+	//!     while (state.keep_running()) {
+	//!         // timed code
+	//!     }
+	//!     state.set_items_processed(state.get_iterations() * items_per_iteration);
+	class benchmark_state
+	{
+	public:
+		//! \brief Run for at least `min_time` seconds, unless
+		//!        `max_iterations` iterations are done first.
+		benchmark_state(double min_time, std::uint64_t max_iterations);
+
+		//! \brief Start the next iteration.
+		//!
+		//! @return false once enough iterations were run
+		bool keep_running();
+
+		//! \brief Stop timing, for example to set up the next iteration.
+		void pause_timing();
+
+		//! \brief Resume timing after `pause_timing()`.
+		void resume_timing();
+
+		//! \brief Report how many items (vertices, lookups, ...) were
+		//!        processed over all iterations.
+		void set_items_processed(std::uint64_t items_nb) { _items_nb = items_nb; }
+
+		std::uint64_t get_iterations() const { return _iterations_nb; }
+		std::uint64_t get_items_processed() const { return _items_nb; }
+
+		//! \brief Get the time spent in the timed parts of all iterations.
+		double get_elapsed_seconds() const;
+
+	private:
+		using clock = std::chrono::high_resolution_clock;
+
+		double const _min_time;
+		std::uint64_t const _max_iterations;
+		std::uint64_t _iterations_nb;
+		std::uint64_t _items_nb;
+		clock::duration _elapsed;
+		clock::time_point _start;
+		bool _is_timing;
+	};
+
+	//! \brief Results of a benchmark, per iteration.
+	struct benchmark_result {
+		std::string name;
+		std::uint64_t iterations_nb;
+		double seconds;              //!< average time per iteration
+		double items_per_second;     //!< 0 if no items were reported
+		std::uint64_t bytes_allocated; //!< average bytes allocated per iteration
+		std::uint64_t allocations_nb;  //!< average allocations per iteration
+		std::uint64_t peak_bytes;      //!< peak heap usage over the run
+	};
+
+	//! \brief Run a benchmark and log its results.
+	//!
+	//! @param [in] name printed along with the results
+	//! @param [in] function the benchmark, see `benchmark_state`
+	//! @param [in] min_time minimum time to spend iterating, in seconds
+	//! @param [in] max_iterations iterations after which to stop, even if
+	//!             `min_time` was not reached
+	//! @return the measured results
+	benchmark_result runBenchmark(std::string const& name,
+	                              std::function<void (benchmark_state&)> const& function,
+	                              double min_time = 0.5, std::uint64_t max_iterations = 1000000u);
+}
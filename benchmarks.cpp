@@ -0,0 +1,295 @@
+#include "benchmark.hpp"
+#include "helpers.hpp"
+#include "interpolation.hpp"
+#include "mesh_cache.hpp"
+#include "ocean.hpp"
+#include "parametric_shapes.hpp"
+#include "ring_buffer.hpp"
+#include "spatial_hash.hpp"
+#include "vertex_layout.hpp"
+
+#include "core/Bonobo.h"
+#include "core/Log.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// CPU-side benchmarks; no OpenGL context is created.
+//
+// Usage: benchmarks [scene.obj...]
+//
+// The parametric shape generators are run at resolutions from 10x10 to
+// 4096x4096, and the ocean simulation at FFT sizes from 64x64 to
+// 1024x1024, where a frame has to fit in a few milliseconds. The spatial
+// hash is stressed with 10k to 1M objects, against a linear scan, and
+// while a snake trail of that length moves. Splines are sampled point by
+// point and in batches, from 1k to 1M samples. Scenes are relative to `res/scenes`; loading each of them
+// through assimp is compared with mapping its mesh cache (see
+// `eda221::mesh_cache_file`).
+//
+
+namespace
+{
+	unsigned int const shape_resolutions[] = { 10u, 32u, 100u, 256u, 512u, 1024u, 2048u, 4096u };
+
+	// Packing reorders the triangles for the vertex caches, which is too
+	// slow to be worth running on the largest resolutions.
+	unsigned int const max_packed_resolution = 1024u;
+
+	void
+	benchmark_shape(std::string const& name, unsigned int resolution,
+	                parametric_shapes::shape_data (*generate)(unsigned int))
+	{
+		auto const vertices_nb = static_cast<std::uint64_t>(resolution) * resolution;
+		auto const suffix = "/" + std::to_string(resolution) + "x" + std::to_string(resolution);
+
+		eda221::runBenchmark("generate " + name + suffix, [generate, resolution, vertices_nb](eda221::benchmark_state& state) {
+			while (state.keep_running())
+				generate(resolution);
+			state.set_items_processed(state.get_iterations() * vertices_nb);
+		});
+
+		if (resolution > max_packed_resolution)
+			return;
+		eda221::runBenchmark("pack " + name + suffix, [generate, resolution, vertices_nb](eda221::benchmark_state& state) {
+			while (state.keep_running()) {
+				state.pause_timing();
+				auto const shape = generate(resolution);
+				state.resume_timing();
+				parametric_shapes::packShape(shape);
+			}
+			state.set_items_processed(state.get_iterations() * vertices_nb);
+		});
+	}
+
+	void
+	benchmark_shapes()
+	{
+		for (auto const resolution : shape_resolutions) {
+			benchmark_shape("quad", resolution, [](unsigned int res) {
+				return parametric_shapes::generateQuad(res, res, 1u, 1u);
+			});
+			benchmark_shape("sphere", resolution, [](unsigned int res) {
+				return parametric_shapes::generateSphere(res, res, 1.0f);
+			});
+			benchmark_shape("torus", resolution, [](unsigned int res) {
+				return parametric_shapes::generateTorus(res, res, 1.0f, 3.0f);
+			});
+			benchmark_shape("circle ring", resolution, [](unsigned int res) {
+				return parametric_shapes::generateCircleRing(res, res, 1.0f, 2.0f);
+			});
+		}
+	}
+
+	unsigned int const ocean_resolutions[] = { 64u, 128u, 256u, 512u, 1024u };
+
+	void
+	benchmark_ocean()
+	{
+		for (auto const resolution : ocean_resolutions) {
+			auto simulation = eda221::ocean_simulation(eda221::ocean_settings{ resolution, 50.0f, glm::vec2(-6.0f, 2.0f), 5.0e-5f, 1.0f, 1u });
+			auto maps = eda221::ocean_maps();
+			auto const texels_nb = static_cast<std::uint64_t>(resolution) * resolution;
+			auto const name = "ocean fft/" + std::to_string(resolution) + "x" + std::to_string(resolution);
+			eda221::runBenchmark(name, [&simulation, &maps, texels_nb](eda221::benchmark_state& state) {
+				auto time = 0.0f;
+				while (state.keep_running()) {
+					simulation.simulate(time, maps);
+					time += 1.0f / 60.0f;
+				}
+				state.set_items_processed(state.get_iterations() * texels_nb);
+			});
+		}
+	}
+
+	unsigned int const spatial_hash_sizes[] = { 10000u, 100000u, 1000000u };
+
+	// Objects as spread as the snake segments, which are 2 units wide and
+	// 4 units apart.
+	float const object_radius = 1.0f;
+	float const object_spacing = 4.0f;
+
+	size_t const queries_nb = 4096u;
+	size_t const linear_queries_nb = 16u; // a full scan each
+	size_t const steps_nb = 1024u;
+
+	std::vector<glm::vec3>
+	generate_positions(size_t positions_nb, float side, std::mt19937& generator)
+	{
+		auto distribution = std::uniform_real_distribution<float>(0.0f, side);
+		auto positions = std::vector<glm::vec3>(positions_nb);
+		for (auto& position : positions)
+			position = glm::vec3(distribution(generator), 0.0f, distribution(generator));
+		return positions;
+	}
+
+	void
+	benchmark_spatial_hash()
+	{
+		for (auto const objects_nb : spatial_hash_sizes) {
+			auto const side = object_spacing * std::sqrt(static_cast<float>(objects_nb));
+			auto generator = std::mt19937(objects_nb);
+			auto const objects = generate_positions(objects_nb, side, generator);
+			auto const queries = generate_positions(queries_nb, side, generator);
+			auto const suffix = "/" + std::to_string(objects_nb);
+
+			eda221::runBenchmark("spatial hash build" + suffix, [&objects](eda221::benchmark_state& state) {
+				while (state.keep_running()) {
+					auto grid = eda221::spatial_hash(2.0f * object_radius, objects.size());
+					for (size_t i = 0u; i < objects.size(); ++i)
+						grid.insert(static_cast<std::uint32_t>(i), objects[i], object_radius);
+				}
+				state.set_items_processed(state.get_iterations() * objects.size());
+			}, 0.5, 100u);
+
+			auto grid = eda221::spatial_hash(2.0f * object_radius, objects.size());
+			for (size_t i = 0u; i < objects.size(); ++i)
+				grid.insert(static_cast<std::uint32_t>(i), objects[i], object_radius);
+			eda221::runBenchmark("spatial hash query" + suffix, [&grid, &queries](eda221::benchmark_state& state) {
+				auto volatile hits_nb = 0u;
+				while (state.keep_running())
+					for (auto const& query : queries)
+						hits_nb += grid.find_overlap(query, object_radius) != eda221::spatial_hash::no_id;
+				state.set_items_processed(state.get_iterations() * queries.size());
+			});
+			eda221::runBenchmark("linear query" + suffix, [&objects, &queries](eda221::benchmark_state& state) {
+				auto volatile hits_nb = 0u;
+				auto const distance = 2.0f * object_radius;
+				while (state.keep_running())
+					for (size_t q = 0u; q < linear_queries_nb; ++q)
+						for (auto const& object : objects) {
+							auto const offset = object - queries[q];
+							if (glm::dot(offset, offset) < distance * distance) {
+								++hits_nb;
+								break;
+							}
+						}
+				state.set_items_processed(state.get_iterations() * linear_queries_nb);
+			});
+
+			// A snake of objects_nb segments, walking a raster wide enough
+			// for it not to cross itself: each step recycles the tail slot
+			// and tests the head, as assignment 5 does.
+			auto const row_length = static_cast<size_t>(std::sqrt(static_cast<float>(objects_nb))) + 1u;
+			auto const walk = [row_length](size_t step) {
+				auto const row = (step / row_length) % row_length;
+				return object_spacing * glm::vec3(static_cast<float>(step % row_length), 0.0f, static_cast<float>(row));
+			};
+			auto trail = eda221::ring_buffer<glm::vec3>(objects_nb + 1u);
+			auto trail_grid = eda221::spatial_hash(2.0f * object_radius, objects_nb);
+			auto step = size_t(0u);
+			for (; step < objects_nb; ++step) {
+				trail.push_front(walk(step));
+				trail_grid.insert(static_cast<std::uint32_t>(trail.get_slot(0u)), trail[0u], object_radius);
+			}
+			eda221::runBenchmark("spatial hash trail" + suffix, [&trail, &trail_grid, &walk, &step](eda221::benchmark_state& state) {
+				auto volatile hits_nb = 0u;
+				while (state.keep_running())
+					for (size_t i = 0u; i < steps_nb; ++i, ++step) {
+						trail_grid.remove(static_cast<std::uint32_t>(trail.get_slot(trail.size() - 1u)));
+						trail.pop_back();
+						trail.push_front(walk(step));
+						trail_grid.insert(static_cast<std::uint32_t>(trail.get_slot(0u)), trail[0u], object_radius);
+						auto const is_hittable = [&trail](std::uint32_t slot) { return trail.get_index(slot) >= 2u; };
+						hits_nb += trail_grid.find_overlap(trail[0u], object_radius, is_hittable) != eda221::spatial_hash::no_id;
+					}
+				state.set_items_processed(state.get_iterations() * steps_nb);
+			});
+		}
+	}
+
+	size_t const spline_samples_nbs[] = { 1024u, 16384u, 262144u, 1048576u };
+
+	void
+	benchmark_splines()
+	{
+		auto generator = std::mt19937(42u);
+		auto const points = generate_positions(64u, 10.0f, generator);
+		auto const points_nb = points.size();
+
+		for (auto const samples_nb : spline_samples_nbs) {
+			auto samples = std::vector<glm::vec3>(samples_nb);
+			auto const suffix = "/" + std::to_string(samples_nb);
+
+			eda221::runBenchmark("catmull-rom per point" + suffix, [&points, points_nb, &samples](eda221::benchmark_state& state) {
+				while (state.keep_running())
+					for (size_t i = 0u; i < samples.size(); ++i) {
+						auto const u = static_cast<double>(i) * points_nb / samples.size();
+						auto const k = static_cast<size_t>(u);
+						samples[i] = interpolation::evalCatmullRom(points[(k + points_nb - 1u) % points_nb], points[k],
+						                                           points[(k + 1u) % points_nb], points[(k + 2u) % points_nb],
+						                                           0.5f, static_cast<float>(u - k));
+					}
+				state.set_items_processed(state.get_iterations() * samples.size());
+			});
+
+			auto const modes = { std::make_pair("uniform", interpolation::parameterization::uniform),
+			                     std::make_pair("centripetal", interpolation::parameterization::centripetal) };
+			for (auto const& mode : modes) {
+				auto const param = mode.second;
+				eda221::runBenchmark(std::string("catmull-rom batch ") + mode.first + suffix, [&points, param, &samples](eda221::benchmark_state& state) {
+					while (state.keep_running()) {
+						auto const path = interpolation::buildCatmullRom(points.data(), points.size(), true, param);
+						interpolation::evalSpline(path, samples.data(), samples.size());
+					}
+					state.set_items_processed(state.get_iterations() * samples.size());
+				});
+			}
+		}
+	}
+
+	// Compare importing a scene through assimp with mapping its cache.
+	void
+	benchmark_mesh_loading(std::string const& filename)
+	{
+		auto const source_path = "scenes/" + filename;
+		auto const cache_path = eda221::getMeshCachePath(filename);
+
+		auto const meshes = eda221::importObjects(filename);
+		if (meshes.empty() || !eda221::writeMeshCache(cache_path, source_path, meshes)) {
+			LogError("Could not import and cache \"%s\"", filename.c_str());
+			return;
+		}
+
+		eda221::runBenchmark("assimp import " + filename, [&filename](eda221::benchmark_state& state) {
+			while (state.keep_running())
+				eda221::importObjects(filename);
+		}, 1.0, 10u);
+		eda221::runBenchmark("mesh cache " + filename, [&cache_path, &source_path](eda221::benchmark_state& state) {
+			while (state.keep_running()) {
+				eda221::mesh_cache_file cache;
+				cache.open(cache_path, source_path, eda221::getDefaultVertexLayout());
+				// Touch every page, as the upload would.
+				auto volatile checksum = 0u;
+				for (auto const& mesh : cache.get_meshes()) {
+					auto const bytes = static_cast<unsigned char const*>(mesh.vertex_data);
+					for (size_t i = 0u; i < mesh.vertex_data_size; i += 4096u)
+						checksum += bytes[i];
+				}
+			}
+		}, 1.0, 10u);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Bonobo::Init();
+
+	benchmark_shapes();
+	benchmark_ocean();
+	benchmark_spatial_hash();
+	benchmark_splines();
+
+	auto scenes = std::vector<std::string>(argv + 1, argv + argc);
+	if (scenes.empty())
+		scenes = { "ogre.obj" };
+	for (auto const& scene : scenes)
+		benchmark_mesh_loading(scene);
+
+	Bonobo::Destroy();
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool
+eda221::testSphereSphere(glm::vec3 const& p1, float r1, glm::vec3 const& p2, float r2)
+{
+	auto const offset = p1 - p2;
+	return glm::dot(offset, offset) < (r1 + r2) * (r1 + r2);
+}
+
+bool
+eda221::sweepSphereSphere(glm::vec3 const& from, glm::vec3 const& to, float radius,
+                          glm::vec3 const& center, float center_radius, float& hit_time)
+{
+	// Intersect the segment with the static sphere grown by `radius`:
+	// |m + t d|^2 = r^2, with m = from - center and d = to - from.
+	auto const r = radius + center_radius;
+	auto const m = from - center;
+	auto const c = glm::dot(m, m) - r * r;
+	if (c < 0.0f) {
+		hit_time = 0.0f;
+		return true;
+	}
+
+	auto const d = to - from;
+	auto const a = glm::dot(d, d);
+	auto const b = glm::dot(m, d);
+	if (a == 0.0f || b >= 0.0f) // not moving, or moving away
+		return false;
+	auto const discriminant = b * b - a * c;
+	if (discriminant < 0.0f)
+		return false;
+	auto const t = (-b - std::sqrt(discriminant)) / a;
+	if (t > 1.0f)
+		return false;
+	hit_time = t;
+	return true;
+}
+
+bool
+eda221::sweepSphereCapsule(glm::vec3 const& from, glm::vec3 const& to, float radius,
+                           glm::vec3 const& a, glm::vec3 const& b, float capsule_radius, float& hit_time)
+{
+	auto const r = radius + capsule_radius;
+	auto const axis = b - a;
+	auto const axis_length2 = glm::dot(axis, axis);
+
+	// Already overlapping the capsule?
+	auto const oa = from - a;
+	auto const closest = axis_length2 > 0.0f ? glm::clamp(glm::dot(oa, axis) / axis_length2, 0.0f, 1.0f) : 0.0f;
+	auto const separation = oa - closest * axis;
+	if (glm::dot(separation, separation) < r * r) {
+		hit_time = 0.0f;
+		return true;
+	}
+
+	// The capsule lies within the infinite cylinder around its axis, and
+	// the segment crosses the side of that cylinder at most once on the
+	// way in: if it does so between the caps, that is the first hit.
+	auto const d = to - from;
+	auto const axis_d = glm::dot(axis, d);
+	auto const axis_oa = glm::dot(axis, oa);
+	auto const qa = axis_length2 * glm::dot(d, d) - axis_d * axis_d;
+	if (qa > 0.0f) {
+		auto const qb = axis_length2 * glm::dot(d, oa) - axis_oa * axis_d;
+		auto const qc = axis_length2 * (glm::dot(oa, oa) - r * r) - axis_oa * axis_oa;
+		auto const discriminant = qb * qb - qa * qc;
+		if (discriminant < 0.0f)
+			return false; // never within r of the axis
+		auto const t = (-qb - std::sqrt(discriminant)) / qa;
+		auto const along_axis = axis_oa + t * axis_d;
+		if (t >= 0.0f && along_axis > 0.0f && along_axis < axis_length2) {
+			if (t > 1.0f)
+				return false;
+			hit_time = t;
+			return true;
+		}
+	}
+
+	// Otherwise, it can only enter through one of the caps.
+	auto cap_time = 2.0f;
+	auto t = 0.0f;
+	if (sweepSphereSphere(from, to, radius, a, capsule_radius, t))
+		cap_time = t;
+	if (sweepSphereSphere(from, to, radius, b, capsule_radius, t))
+		cap_time = std::min(cap_time, t);
+	if (cap_time > 1.0f)
+		return false;
+	hit_time = cap_time;
+	return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace eda221
+{
+	//! \brief Test whether two spheres overlap.
+	//!
+	//! @return whether the centres are closer than the sum of the radii
+	bool testSphereSphere(glm::vec3 const& p1, float r1, glm::vec3 const& p2, float r2);
+
+	//! \brief Sweep a sphere along a segment, against a static sphere.
+	//!
+	//! @param [in] from centre of the moving sphere at time 0
+	//! @param [in] to centre of the moving sphere at time 1
+	//! @param [in] radius of the moving sphere
+	//! @param [in] center of the static sphere
+	//! @param [in] center_radius radius of the static sphere
+	//! @param [out] hit_time first time in [0, 1] at which they touch, 0 if
+	//!              they already overlap at `from`; untouched on a miss
+	//! @return whether they touch during the sweep
+	bool sweepSphereSphere(glm::vec3 const& from, glm::vec3 const& to, float radius,
+	                       glm::vec3 const& center, float center_radius, float& hit_time);
+
+	//! \brief Sweep a sphere along a segment, against a static capsule,
+	//!        that is, all points within `capsule_radius` of the segment
+	//!        [a, b].
+	//!
+	//! See `sweepSphereSphere()` for the other parameters.
+	bool sweepSphereCapsule(glm::vec3 const& from, glm::vec3 const& to, float radius,
+	                        glm::vec3 const& a, glm::vec3 const& b, float capsule_radius, float& hit_time);
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace eda221
+{
+	//! \brief Hands the latest value written by one thread over to another
+	//!        one, without locks.
+	//!
+	//! The writer fills `get_back()` and publishes it; the reader picks
+	//! the latest published value up with `update()`. Values published in
+	//! between are skipped, and neither side ever waits.
+	template<typename T>
+	class triple_buffer
+	{
+	public:
+		triple_buffer() : _slots(), _back(0u), _middle(1u), _front(2u)
+		{
+		}
+
+		triple_buffer(triple_buffer const&) = delete;
+		triple_buffer& operator=(triple_buffer const&) = delete;
+
+		//! \brief Get the value to write; it holds an older value, to be
+		//!        overwritten.
+		T& get_back() { return _slots[_back]; }
+
+		//! \brief Publish `get_back()`, and move on to another slot.
+		void publish()
+		{
+			_back = _middle.exchange(_back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+		}
+
+		//! \brief Pick up the latest published value, if any.
+		//!
+		//! @return whether `get_front()` changed
+		bool update()
+		{
+			if ((_middle.load(std::memory_order_relaxed) & fresh_bit) == 0u)
+				return false;
+			_front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+			return true;
+		}
+
+		//! \brief Get the value last picked up by `update()`.
+		T const& get_front() const { return _slots[_front]; }
+
+	private:
+		static unsigned int const index_mask = 3u;
+		static unsigned int const fresh_bit = 4u;
+
+		std::array<T, 3> _slots;
+		unsigned int _back;
+		std::atomic<unsigned int> _middle; // index, and whether it is unread
+		unsigned int _front;
+	};
+
+	//! \brief Runs a simulation in fixed steps, decoupled from the frame
+	//!        rate.
+	//!
+	//! Each frame calls `advance()` with the time it took, and the loop
+	//! runs as many steps as fit in the accumulated time; the remainder is
+	//! `get_alpha()`. Rendering shows the state one step late, by
+	//! interpolating `get_previous()` and `get_current()` with it, for
+	//! example through `interpolation::evalLERP()`, so that the motion is
+	//! smooth and identical at any frame rate.
+	//!
+	//! After `start_thread()`, the steps run on their own thread instead,
+	//! paced by a steady clock. Inputs reach it and states come back
+	//! through `triple_buffer`s, so that neither thread waits for the
+	//! other; the step function then must not touch anything else the
+	//! render thread uses, OpenGL included.
+	//!
+	//! @tparam State what gets simulated and interpolated; it is copied
+	//!         at every step
+	//! @tparam Input what the simulation reads from the player
+	template<typename State, typename Input>
+	class game_loop
+	{
+	public:
+		//! \brief Advance `state` by `step_seconds`, given `input`.
+		using step_function = std::function<void (State& state, Input const& input, double step_seconds)>;
+
+		//! \brief Create a loop, running on the calling thread.
+		//!
+		//! @param [in] initial the state at time 0
+		//! @param [in] step_seconds duration of a step
+		//! @param [in] step the simulation itself
+		//! @param [in] max_steps_per_frame beyond this many steps, the
+		//!             time of a frame is dropped and the simulation slows
+		//!             down, rather than spiralling into ever longer frames
+		game_loop(State const& initial, double step_seconds, step_function step, unsigned int max_steps_per_frame = 32u)
+			: _step(std::move(step)), _step_seconds(step_seconds), _max_steps_per_frame(max_steps_per_frame),
+			  _previous(initial), _current(initial), _input(), _accumulator(0.0), _steps_nb(0u),
+			  _thread(), _is_running(false), _states(), _inputs(), _current_time()
+		{
+			assert(step_seconds > 0.0);
+		}
+
+		//! \brief Stop the simulation thread, if any.
+		~game_loop() { stop_thread(); }
+
+		game_loop(game_loop const&) = delete;
+		game_loop& operator=(game_loop const&) = delete;
+
+		//! \brief Set the input of the next steps.
+		void set_input(Input const& input)
+		{
+			if (is_threaded()) {
+				_inputs.get_back() = input;
+				_inputs.publish();
+			} else {
+				_input = input;
+			}
+		}
+
+		//! \brief Run the steps fitting in a frame, or, when threaded,
+		//!        pick up the latest states.
+		//!
+		//! @param [in] elapsed_seconds duration of the frame
+		//! @return the number of steps run by this call
+		unsigned int advance(double elapsed_seconds)
+		{
+			if (is_threaded()) {
+				pick_up_states();
+				auto const since_current = std::chrono::duration<double>(clock::now() - _current_time).count();
+				_accumulator = std::min(std::max(since_current, 0.0), _step_seconds);
+				return 0u;
+			}
+
+			_accumulator = std::min(_accumulator + elapsed_seconds, _max_steps_per_frame * _step_seconds);
+			auto steps_nb = 0u;
+			for (; _accumulator >= _step_seconds; _accumulator -= _step_seconds, ++steps_nb) {
+				_previous = _current;
+				_step(_current, _input, _step_seconds);
+			}
+			_steps_nb += steps_nb;
+			return steps_nb;
+		}
+
+		//! \brief Change the duration of a step; not while threaded.
+		void set_step_seconds(double step_seconds)
+		{
+			assert(step_seconds > 0.0 && !is_threaded());
+			_step_seconds = step_seconds;
+		}
+
+		double get_step_seconds() const { return _step_seconds; }
+
+		//! \brief Get how far rendering is from `get_previous()` towards
+		//!        `get_current()`, in [0, 1].
+		float get_alpha() const { return static_cast<float>(_accumulator / _step_seconds); }
+
+		State const& get_previous() const { return _previous; }
+		State const& get_current() const { return _current; }
+
+		//! \brief Get the number of steps run so far on the calling thread.
+		std::uint64_t get_steps_nb() const { return _steps_nb; }
+
+		bool is_threaded() const { return _thread.joinable(); }
+
+		//! \brief Move the steps to their own thread, starting from the
+		//!        current state.
+		void start_thread()
+		{
+			if (is_threaded())
+				return;
+			_is_running.store(true);
+			_current_time = clock::now();
+			_thread = std::thread([this]() { simulate(); });
+		}
+
+		//! \brief Move the steps back to the calling thread.
+		void stop_thread()
+		{
+			if (!is_threaded())
+				return;
+			_is_running.store(false);
+			_thread.join();
+			pick_up_states();
+			_accumulator = 0.0;
+		}
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct snapshot {
+			State previous;
+			State current;
+			clock::time_point current_time; // when rendering starts leaving previous
+		};
+
+		// Body of the simulation thread; it owns its copies of the state
+		// and the input until stopped.
+		void simulate()
+		{
+			auto state = _current;
+			auto input = _input;
+			auto const step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(_step_seconds));
+			auto next_time = clock::now();
+			while (_is_running.load()) {
+				if (_inputs.update())
+					input = _inputs.get_front();
+
+				auto& out = _states.get_back();
+				out.previous = state;
+				_step(state, input, _step_seconds);
+				out.current = state;
+				out.current_time = next_time;
+				_states.publish();
+				next_time += step;
+
+				// Drop the time of steps too late to catch up with.
+				auto const now = clock::now();
+				if (now - next_time > _max_steps_per_frame * step)
+					next_time = now;
+				std::this_thread::sleep_until(next_time);
+			}
+			_input = input;
+		}
+
+		void pick_up_states()
+		{
+			if (!_states.update())
+				return;
+			auto const& in = _states.get_front();
+			_previous = in.previous;
+			_current = in.current;
+			_current_time = in.current_time;
+		}
+
+		step_function _step;
+		double _step_seconds;
+		unsigned int const _max_steps_per_frame;
+		State _previous;
+		State _current;
+		Input _input;
+		double _accumulator; // in seconds, less than a step once advanced
+		std::uint64_t _steps_nb;
+
+		std::thread _thread;
+		std::atomic<bool> _is_running;
+		triple_buffer<snapshot> _states;
+		triple_buffer<Input> _inputs;
+		clock::time_point _current_time;
+	};
+}
@@ -0,0 +1,51 @@
+#include "gpu_timer.hpp"
+
+eda221::gpu_timer::gpu_timer() : _queries(), _next(0u), _pending_nb(0u), _is_timing(false),
+	_milliseconds(-1.0), _results_nb(0u)
+{
+	glGenQueries(static_cast<GLsizei>(queries_nb), _queries.data());
+}
+
+eda221::gpu_timer::~gpu_timer()
+{
+	glDeleteQueries(static_cast<GLsizei>(queries_nb), _queries.data());
+}
+
+void
+eda221::gpu_timer::begin()
+{
+	collect();
+	if (_pending_nb == queries_nb)
+		return;
+	glBeginQuery(GL_TIME_ELAPSED, _queries[_next]);
+	_is_timing = true;
+}
+
+void
+eda221::gpu_timer::end()
+{
+	if (!_is_timing)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	_is_timing = false;
+	_next = (_next + 1u) % queries_nb;
+	++_pending_nb;
+}
+
+void
+eda221::gpu_timer::collect()
+{
+	// Queries complete in the order they were issued.
+	while (_pending_nb > 0u) {
+		auto const query = _queries[(_next + queries_nb - _pending_nb) % queries_nb];
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+			return;
+		GLuint64 nanoseconds = 0u;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		_milliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+		++_results_nb;
+		--_pending_nb;
+	}
+}
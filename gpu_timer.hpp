@@ -0,0 +1,53 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+
+namespace eda221
+{
+	//! \brief Measures the GPU time spent on the commands issued between
+	//!        `begin()` and `end()`, using GL_TIME_ELAPSED queries.
+	//!
+	//! Results arrive a few frames late; the timer cycles through several
+	//! queries so that reading them never stalls the pipeline, and skips a
+	//! measurement when all of them are still in flight.
+	class gpu_timer
+	{
+	public:
+		//! \brief Create the queries.
+		gpu_timer();
+
+		//! \brief Delete the queries.
+		~gpu_timer();
+
+		gpu_timer(gpu_timer const&) = delete;
+		gpu_timer& operator=(gpu_timer const&) = delete;
+
+		//! \brief Start timing; no other GL_TIME_ELAPSED query can be
+		//!        active meanwhile.
+		void begin();
+
+		//! \brief Stop timing.
+		void end();
+
+		//! \brief Get the latest available measurement, in milliseconds,
+		//!        or a negative value if none is available yet.
+		double get_milliseconds() const { return _milliseconds; }
+
+		//! \brief Get how many measurements were completed so far.
+		unsigned int get_results_nb() const { return _results_nb; }
+
+	private:
+		static size_t const queries_nb = 4u;
+
+		void collect();
+
+		std::array<GLuint, queries_nb> _queries;
+		size_t _next;
+		size_t _pending_nb;
+		bool _is_timing;
+		double _milliseconds;
+		unsigned int _results_nb;
+	};
+}
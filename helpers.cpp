@@ -1,5 +1,10 @@
 #include "config.hpp"
 #include "helpers.hpp"
+#include "mesh_cache.hpp"
+#include "program_reflection.hpp"
+#include "texture_compression.hpp"
+#include "uniform_buffers.hpp"
+#include "vertex_layout.hpp"
 
 #include "core/Log.h"
 #include "core/Misc.h"
@@ -11,32 +16,50 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <thread>
 
-static std::vector<u8>
-getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
+#include <sys/stat.h>
+#if defined(_WIN32)
+#	include <direct.h>
+#endif
+
+std::vector<unsigned char>
+eda221::loadImage(std::string const& filename, u32& width, u32& height, bool flip)
 {
 	auto const path = config::resources_path(filename);
 	std::vector<unsigned char> image;
 	if (lodepng::decode(image, width, height, path, LCT_RGBA) != 0) {
-		LogWarning("Couldn't load or decode image file %s", path.c_str());
+		image.clear();
 		return image;
 	}
 	if (!flip)
 		return image;
 
-	auto const channels_nb = 4u;
-	auto flipBuffer = std::vector<u8>(width * height * channels_nb);
-	for (u32 y = 0; y < height; y++)
-		memcpy(flipBuffer.data() + (height - 1 - y) * width * channels_nb, &image[y * width * channels_nb], width * channels_nb);
+	// Swap rows in place rather than copying the whole image.
+	auto const row_size = static_cast<size_t>(width) * 4u;
+	for (u32 y = 0; y < height / 2u; y++)
+		std::swap_ranges(image.begin() + y * row_size, image.begin() + (y + 1u) * row_size,
+		                 image.begin() + (height - 1u - y) * row_size);
 
-	return flipBuffer;
+	return image;
 }
 
-std::vector<eda221::mesh_data>
-eda221::loadObjects(std::string const& filename)
+static std::vector<u8>
+getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
 {
-	std::vector<eda221::mesh_data> objects;
+	auto image = eda221::loadImage(filename, width, height, flip);
+	if (image.empty())
+		LogWarning("Couldn't load or decode image file %s", config::resources_path(filename).c_str());
+	return image;
+}
+
+std::vector<eda221::packed_mesh>
+eda221::importObjects(std::string const& filename)
+{
+	std::vector<eda221::packed_mesh> objects;
 
 	auto const scene_filepath = config::resources_path("scenes/" + filename);
 	Assimp::Importer importer;
@@ -68,69 +91,7 @@ eda221::loadObjects(std::string const& filename)
 			continue;
 		}
 
-		eda221::mesh_data object;
-		object.vao = 0u;
-
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
-
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
-
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
-
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
-
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
-
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
-
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
-
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-		}
-
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-		}
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-		object.indices_nb = assimp_object_mesh->mNumFaces * 3u;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
+		auto object_indices = std::vector<GLuint>(assimp_object_mesh->mNumFaces * 3u);
 		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
 			auto const& face = assimp_object_mesh->mFaces[i];
 			assert(face.mNumIndices == 3u);
@@ -138,18 +99,22 @@ eda221::loadObjects(std::string const& filename)
 			object_indices[3u * i + 1u] = face.mIndices[1u];
 			object_indices[3u * i + 2u] = face.mIndices[2u];
 		}
-		object.ibo = 0u;
-		glGenBuffers(1, &object.ibo);
-		assert(object.ibo != 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
 
-		glBindVertexArray(0u);
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-		objects.push_back(object);
+		// aiVector3D is laid out as three consecutive floats, just like
+		// glm::vec3.
+		auto const as_vec3 = [](aiVector3D const* v) {
+			return reinterpret_cast<glm::vec3 const*>(v);
+		};
+		auto const has_tangents = assimp_object_mesh->HasTangentsAndBitangents();
+		auto object = eda221::packMesh(eda221::getDefaultVertexLayout(), assimp_object_mesh->mNumVertices,
+		                                           as_vec3(assimp_object_mesh->mVertices),
+		                                           assimp_object_mesh->HasNormals() ? as_vec3(assimp_object_mesh->mNormals) : nullptr,
+		                                           assimp_object_mesh->HasTextureCoords(0u) ? as_vec3(assimp_object_mesh->mTextureCoords[0u]) : nullptr,
+		                                           has_tangents ? as_vec3(assimp_object_mesh->mTangents) : nullptr,
+		                                           has_tangents ? as_vec3(assimp_object_mesh->mBitangents) : nullptr,
+		                                           object_indices.data(), object_indices.size());
+
+		objects.push_back(std::move(object));
 
 		LogInfo("Loaded object \"%s\" with normals:%d, tangents&bitangents:%d, texcoords:%d",
 		        assimp_object_mesh->mName.C_Str(), assimp_object_mesh->HasNormals(),
@@ -159,9 +124,59 @@ eda221::loadObjects(std::string const& filename)
 	return objects;
 }
 
+std::vector<eda221::mesh_data>
+eda221::loadObjects(std::string const& filename)
+{
+	std::vector<eda221::mesh_data> objects;
+	auto const start = std::chrono::high_resolution_clock::now();
+	auto const get_elapsed_ms = [&start]() {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	// The cached meshes are uploaded straight from the mapped file.
+	auto const source_path = "scenes/" + filename;
+	auto const cache_path = getMeshCachePath(filename);
+	mesh_cache_file cache;
+	if (cache.open(cache_path, source_path, getDefaultVertexLayout())) {
+		objects.reserve(cache.get_meshes().size());
+		for (auto const& mesh : cache.get_meshes())
+			objects.push_back(uploadMeshData(mesh.layout, mesh.vertex_data, mesh.vertex_data_size,
+			                                 mesh.indices_type, mesh.index_data, mesh.indices_nb));
+		LogInfo("Loaded \"%s\" from its mesh cache in %.2f ms", filename.c_str(), get_elapsed_ms());
+		return objects;
+	}
+
+	auto const meshes = importObjects(filename);
+	if (meshes.empty())
+		return objects;
+	objects.reserve(meshes.size());
+	for (auto const& mesh : meshes)
+		objects.push_back(uploadMeshData(mesh));
+	LogInfo("Imported \"%s\" with assimp in %.2f ms", filename.c_str(), get_elapsed_ms());
+
+	writeMeshCache(cache_path, source_path, meshes);
+
+	return objects;
+}
+
 GLuint
 eda221::loadTexture2D(std::string const& filename)
 {
+	// Prefer the block-compressed version baked by `bakeTexture2D()`.
+	auto const cache_path = getTextureCachePath("textures/" + filename);
+	compressed_texture compressed;
+	if (isTextureCacheFresh(cache_path, { "textures/" + filename }) && loadKTX(cache_path, compressed)) {
+		GLuint texture = 0u;
+		glGenTextures(1, &texture);
+		assert(texture != 0u);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		uploadCompressedTexture(compressed, GL_TEXTURE_2D, compressed.data.data(), compressed.levels_nb);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		return texture;
+	}
+
 	u32 width, height;
 	auto const data = getTextureData("textures/" + filename, width, height, true);
 	if (data.empty())
@@ -213,6 +228,18 @@ eda221::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+	// If the cube map was baked by `bakeTextureCubeMap()`, upload its
+	// compressed faces and mip levels as they are.
+	auto const cache_path = getCubeMapCachePath("cubemaps/" + posx);
+	compressed_texture compressed;
+	if (isTextureCacheFresh(cache_path, { "cubemaps/" + posx, "cubemaps/" + negx, "cubemaps/" + posy,
+	                                      "cubemaps/" + negy, "cubemaps/" + posz, "cubemaps/" + negz })
+	    && loadKTX(cache_path, compressed) && compressed.faces_nb == 6u) {
+		uploadCompressedTexture(compressed, GL_TEXTURE_CUBE_MAP, compressed.data.data(), generate_mipmap ? compressed.levels_nb : 1u);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+		return texture;
+	}
+
 	// We need to fill in the cube map using the images passed in as
 	// argument. The function `getTextureData()` uses lodepng to read in
 	// the image files and return a `std::vector<u8>` containing all the
@@ -337,5 +364,71 @@ eda221::createProgram(std::string const& vert_shader_source_path, std::string co
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 	assert(program != 0u);
+
+	// Resolve all active uniforms once, so that the render loop does not
+	// have to look them up by name, and connect the shared uniform blocks.
+	eda221::registerProgramReflection(program);
+	eda221::bindUniformBlocks(program);
+
 	return program;
 }
+
+bool
+eda221::getFileStatus(std::string const& path, file_status& status)
+{
+	struct stat file_stat;
+	if (stat(path.c_str(), &file_stat) != 0)
+		return false;
+	status.size = static_cast<std::uint64_t>(file_stat.st_size);
+	status.modification_time = static_cast<std::int64_t>(file_stat.st_mtime);
+	return true;
+}
+
+void
+eda221::createParentFolders(std::string const& path)
+{
+	for (auto separator = path.find_first_of("/\\", 1u); separator != std::string::npos;
+	     separator = path.find_first_of("/\\", separator + 1u)) {
+		auto const folder = path.substr(0u, separator);
+#if defined(_WIN32)
+		_mkdir(folder.c_str());
+#else
+		mkdir(folder.c_str(), 0755);
+#endif
+	}
+}
+
+void
+eda221::parallelFor(size_t count, size_t min_range_size,
+                    std::function<void (size_t begin, size_t end)> const& function)
+{
+	auto const max_ranges_nb = std::max<size_t>(std::thread::hardware_concurrency(), 1u);
+	auto const ranges_nb = std::min(max_ranges_nb, std::max<size_t>(count / std::max<size_t>(min_range_size, 1u), 1u));
+	if (ranges_nb == 1u) {
+		if (count != 0u)
+			function(0u, count);
+		return;
+	}
+
+	auto threads = std::vector<std::thread>();
+	threads.reserve(ranges_nb - 1u);
+	for (size_t i = 1u; i < ranges_nb; ++i)
+		threads.emplace_back(function, count * i / ranges_nb, count * (i + 1u) / ranges_nb);
+	function(0u, count / ranges_nb);
+	for (auto& thread : threads)
+		thread.join();
+}
+
+bool
+eda221::hasBufferStorage()
+{
+#if defined(GL_VERSION_4_4) && defined(GL_ARB_buffer_storage)
+	return GLAD_GL_VERSION_4_4 != 0 || GLAD_GL_ARB_buffer_storage != 0;
+#elif defined(GL_VERSION_4_4)
+	return GLAD_GL_VERSION_4_4 != 0;
+#elif defined(GL_ARB_buffer_storage)
+	return GLAD_GL_ARB_buffer_storage != 0;
+#else
+	return false;
+#endif
+}
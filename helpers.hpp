@@ -3,6 +3,8 @@
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -16,18 +18,46 @@ namespace eda221
 		normals,       //!< = 1, value of the binding point for normals
 		texcoords,     //!< = 2, value of the binding point for texcoords
 		tangents,      //!< = 3, value of the binding point for tangents
-		binormals      //!< = 4, value of the binding point for binormals
+		binormals,     //!< = 4, value of the binding point for binormals;
+		               //!<   unused by `vertex_layout`, where binormals are
+		               //!<   rebuilt from normals and tangents
+		instance_transforms //!< = 5, first binding point of the per-instance
+		                    //!<   model-to-world matrix; uses 5 to 8
 	};
 
+	//! \brief Formalise mapping between an OpenGL uniform buffer binding
+	//!        point, and the uniform block bound to it; programs get their
+	//!        blocks connected by `eda221::createProgram()`.
+	enum class uniform_block_bindings : unsigned int {
+		frame = 0u, //!< = 0, `FrameBlock`, see `eda221::frame_block`
+		material,   //!< = 1, `MaterialBlock`, see `eda221::material_block`
+		waves,      //!< = 2, `WaveBlock`, see `eda221::wave_system`
+		object      //!< = 3, `ObjectBlock`, see `eda221::object_block`
+	};
+
+	struct packed_mesh;
+
 	//! \brief Contains the data for a mesh in OpenGL.
 	struct mesh_data {
 		GLuint vao;        //!< OpenGL name of the Vertex Array Object
 		GLuint bo;         //!< OpenGL name of the Buffer Object
 		GLuint ibo;        //!< OpenGL name of the Buffer Object for indices
 		size_t indices_nb; //!< number of indices stored in ibo
+		GLenum indices_type; //!< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT,
+		                     //!<   type of the indices stored in ibo; or
+		                     //!<   GL_NONE if there is no ibo, in which
+		                     //!<   case `indices_nb` vertices are drawn
+		                     //!<   in order
+		GLenum mode;       //!< primitive type, such as GL_TRIANGLES or
+		                   //!<   GL_TRIANGLE_STRIP
 	};
 
-	//! \brief Load objects found in an object/scene file, using assimp.
+	//! \brief Load objects found in an object/scene file.
+	//!
+	//! The first time a file is loaded, it is imported using assimp and
+	//! the packed meshes are written to a binary cache (see
+	//! `eda221::mesh_cache_file`); later loads map that cache and upload
+	//! it without parsing or copying it. Load times are logged.
 	//!
 	//! @param [in] filename of the object/scene file to load, relative to
 	//!             the `res/scenes` folder
@@ -35,8 +65,35 @@ namespace eda221
 	//!         object found in the input file
 	std::vector<mesh_data> loadObjects(std::string const& filename);
 
+	//! \brief Import and pack the objects found in an object/scene file
+	//!        using assimp, without any caching nor uploading.
+	//!
+	//! @param [in] filename of the object/scene file to load, relative to
+	//!             the `res/scenes` folder
+	//! @return one packed mesh per object found in the input file
+	std::vector<packed_mesh> importObjects(std::string const& filename);
+
+	//! \brief Decode a PNG image into RGBA texels.
+	//!
+	//! This does not use OpenGL nor the log, and can be called from any
+	//! thread.
+	//!
+	//! @param [in] filename of the PNG image, relative to the `resources`
+	//!             folder
+	//! @param [out] width of the image, in texels
+	//! @param [out] height of the image, in texels
+	//! @param [in] flip whether to flip the rows, so that the first row
+	//!             is the bottom one as OpenGL expects
+	//! @return 4 bytes per texel, or an empty vector if the image could
+	//!         not be loaded
+	std::vector<unsigned char> loadImage(std::string const& filename, unsigned int& width,
+	                                     unsigned int& height, bool flip);
+
 	//! \brief Load a PNG image into an OpenGL 2D-texture.
 	//!
+	//! If an up-to-date compressed version was baked with
+	//! `eda221::bakeTexture2D()`, it is used instead of the PNG image.
+	//!
 	//! @param [in] filename of the PNG image, relative to the `textures`
 	//!             folder within the `resources` folder.
 	//! @return the name of the OpenGL 2D-texture
@@ -52,7 +109,9 @@ namespace eda221
 	//! @param [in] posz path to the texture on the back of the cubemap
 	//! @return the name of the OpenGL cubemap-texture
 	//!
-	//! All paths are relative to the `res/cubemaps` folder.
+	//! All paths are relative to the `res/cubemaps` folder. If an
+	//! up-to-date compressed version was baked with
+	//! `eda221::bakeTextureCubeMap()`, it is used instead of the PNG images.
 	GLuint loadTextureCubeMap(std::string const& posx, std::string const& negx,
                                   std::string const& posy, std::string const& negy,
                                   std::string const& negz, std::string const& posz,
@@ -66,6 +125,45 @@ namespace eda221
 	//! @param [in] frag_shader_source_path of the fragment shader source
 	//!             code, relative to the `shaders/EDA221` folder
 	//! @return the name of the OpenGL shader program
+	//!
+	//! The locations of all active uniforms are resolved once the program
+	//! is linked, and can be retrieved with `eda221::getProgramReflection()`.
 	GLuint createProgram(std::string const& vert_shader_source_path,
 	                     std::string const& frag_shader_source_path);
+
+	//! \brief Size and modification time of a file.
+	struct file_status {
+		std::uint64_t size;              //!< in bytes
+		std::int64_t modification_time;  //!< in seconds since the epoch
+	};
+
+	//! \brief Get the size and modification time of a file.
+	//!
+	//! @param [in] path full path to the file
+	//! @param [out] status the status of the file, if it exists
+	//! @return whether the file exists
+	bool getFileStatus(std::string const& path, file_status& status);
+
+	//! \brief Create all missing folders leading to a file.
+	//!
+	//! @param [in] path full path to the file
+	void createParentFolders(std::string const& path);
+
+	//! \brief Process `[0, count)` in contiguous ranges, in parallel.
+	//!
+	//! The calling thread processes the first range, and one thread per
+	//! extra range is started, up to one range per hardware thread.
+	//!
+	//! @param [in] count the number of elements to process
+	//! @param [in] min_range_size ranges are never made smaller than this,
+	//!             so that small workloads stay on the calling thread
+	//! @param [in] function called as `function(begin, end)` on each range;
+	//!             it must be safe to call it concurrently
+	void parallelFor(size_t count, size_t min_range_size,
+	                 std::function<void (size_t begin, size_t end)> const& function);
+
+	//! \brief Check whether buffers can be persistently mapped.
+	//!
+	//! @return whether OpenGL 4.4 or GL_ARB_buffer_storage is available
+	bool hasBufferStorage();
 }
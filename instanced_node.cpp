@@ -0,0 +1,177 @@
+#include "instanced_node.hpp"
+#include "helpers.hpp"
+#include "program_reflection.hpp"
+#include "stream_buffer.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+InstancedNode::InstancedNode() : _vao(0u), _indices_nb(0u), _indices_type(GL_UNSIGNED_INT), _mode(GL_TRIANGLES), _instances_bo(0u), _instances_capacity(0u), _instances_uploaded_nb(0u), _instances_nb(0), _instances_first(0u), _instances_source_bo(0u), _instances_source_offset(0), _program(0u), _reflection(&eda221::getProgramReflection(0u)), _set_uniforms(), _material(nullptr), _textures()
+{
+}
+
+InstancedNode::~InstancedNode()
+{
+	if (_instances_bo != 0u)
+		glDeleteBuffers(1, &_instances_bo);
+	_instances_bo = 0u;
+}
+
+void
+InstancedNode::render(glm::mat4 const& WVP) const
+{
+	eda221::render_queue queue;
+	queue.set_world_to_clip(WVP);
+	enqueue(queue);
+	queue.flush();
+}
+
+void
+InstancedNode::enqueue(eda221::render_queue& queue) const
+{
+	if (_instances_nb == 0)
+		return;
+
+	eda221::draw_packet packet;
+	packet.program = _program;
+	packet.reflection = _reflection;
+	packet.set_uniforms = &_set_uniforms;
+	packet.textures = &_textures;
+	packet.has_diffuse_texture = false;
+	packet.material = _material;
+	packet.vao = _vao;
+	packet.indices_nb = _indices_nb;
+	packet.indices_type = _indices_type;
+	packet.mode = _mode;
+	packet.instances_bo = _instances_source_bo;
+	packet.world = glm::mat4();
+	packet.normal_world = glm::mat4();
+
+	// A range wrapping around is split in two draws.
+	auto const instances_nb = static_cast<size_t>(_instances_nb);
+	auto const contiguous_nb = std::min(instances_nb, _instances_uploaded_nb - _instances_first);
+	packet.instances_offset = _instances_source_offset + static_cast<GLintptr>(_instances_first * sizeof(glm::mat4));
+	packet.instances_nb = static_cast<GLsizei>(contiguous_nb);
+	queue.submit(packet);
+	if (contiguous_nb < instances_nb) {
+		packet.instances_offset = _instances_source_offset;
+		packet.instances_nb = static_cast<GLsizei>(instances_nb - contiguous_nb);
+		queue.submit(packet);
+	}
+}
+
+void
+InstancedNode::set_geometry(eda221::mesh_data const& shape)
+{
+	_vao = shape.vao;
+	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_indices_type = shape.indices_type;
+	_mode = shape.mode;
+}
+
+void
+InstancedNode::set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms)
+{
+	_program = program;
+	_reflection = &eda221::getProgramReflection(program);
+	_set_uniforms = set_uniforms;
+
+	for (auto& texture : _textures)
+		std::get<3>(texture) = _reflection->get_location(std::get<0>(texture));
+}
+
+void
+InstancedNode::set_material(eda221::material const* material)
+{
+	_material = material;
+}
+
+void
+InstancedNode::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+	if (tex_id != 0u)
+		_textures.emplace_back(name, tex_id, type, _reflection->get_location(name));
+}
+
+void
+InstancedNode::set_instances(std::vector<glm::mat4> const& transforms)
+{
+	if (_instances_bo == 0u) {
+		glGenBuffers(1, &_instances_bo);
+		assert(_instances_bo != 0u);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, _instances_bo);
+	auto const size = static_cast<GLsizeiptr>(transforms.size() * sizeof(glm::mat4));
+	if (transforms.size() > _instances_capacity) {
+		glBufferData(GL_ARRAY_BUFFER, size, reinterpret_cast<GLvoid const*>(transforms.data()), GL_DYNAMIC_DRAW);
+		_instances_capacity = transforms.size();
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, reinterpret_cast<GLvoid const*>(transforms.data()));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	_instances_source_bo = _instances_bo;
+	_instances_source_offset = 0;
+	_instances_uploaded_nb = transforms.size();
+	_instances_nb = static_cast<GLsizei>(transforms.size());
+	_instances_first = 0u;
+}
+
+void
+InstancedNode::stream_instances(std::vector<glm::mat4> const& transforms)
+{
+	auto& stream = eda221::getStreamBuffer();
+	auto const size = transforms.size() * sizeof(glm::mat4);
+	auto const allocation = stream.allocate(size, sizeof(glm::vec4));
+	_instances_first = 0u;
+	if (allocation.data == nullptr) {
+		_instances_uploaded_nb = 0u;
+		_instances_nb = 0;
+		return;
+	}
+	std::memcpy(allocation.data, transforms.data(), size);
+
+	_instances_source_bo = allocation.buffer;
+	_instances_source_offset = allocation.offset;
+	_instances_uploaded_nb = transforms.size();
+	_instances_nb = static_cast<GLsizei>(transforms.size());
+}
+
+size_t
+InstancedNode::get_instances_nb() const
+{
+	return static_cast<size_t>(_instances_nb);
+}
+
+void
+InstancedNode::set_instances_nb(size_t instances_nb)
+{
+	if (instances_nb > _instances_uploaded_nb)
+		LogWarning("Only %u instances were uploaded, but %u were requested", static_cast<unsigned int>(_instances_uploaded_nb), static_cast<unsigned int>(instances_nb));
+	_instances_nb = static_cast<GLsizei>(std::min(instances_nb, _instances_uploaded_nb));
+	_instances_first = 0u;
+}
+
+void
+InstancedNode::set_instance(size_t index, glm::mat4 const& transform)
+{
+	if (index >= _instances_uploaded_nb || _instances_source_bo != _instances_bo) {
+		LogWarning("Instance %u was not uploaded by set_instances()", static_cast<unsigned int>(index));
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, _instances_bo);
+	glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(index * sizeof(glm::mat4)), sizeof(glm::mat4), reinterpret_cast<GLvoid const*>(&transform));
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+}
+
+void
+InstancedNode::set_instances_range(size_t first, size_t instances_nb)
+{
+	set_instances_nb(instances_nb);
+	_instances_first = _instances_uploaded_nb != 0u ? first % _instances_uploaded_nb : 0u;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "render_queue.hpp"
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eda221
+{
+	class material;
+	struct mesh_data;
+	class program_reflection;
+}
+
+//! \brief Renders many copies of the same mesh, each with its own
+//!        model-to-world transform, using a single instanced draw call.
+//!
+//! Unlike `Node`, all instances share the same program, uniforms and
+//! textures; only their transform differs. The transforms are read by the
+//! vertex shader from the `eda221::shader_bindings::instance_transforms`
+//! attribute, rather than from the `ObjectBlock` uniform block (see
+//! `shaders/boundry_instanced.vert`).
+class InstancedNode
+{
+public:
+	//! \brief Default constructor.
+	InstancedNode();
+
+	//! \brief Default destructor; releases the instance buffer.
+	~InstancedNode();
+
+	InstancedNode(InstancedNode const&) = delete;
+	InstancedNode& operator=(InstancedNode const&) = delete;
+
+	//! \brief Render all instances with a single draw call.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space
+	void render(glm::mat4 const& WVP) const;
+
+	//! \brief Submit the instanced draw to a render queue.
+	//!
+	//! @param [in] queue the queue to add the draw to; its world-to-clip
+	//!             matrix should already be set
+	void enqueue(eda221::render_queue& queue) const;
+
+	//! \brief Set the geometry shared by all instances.
+	//!
+	//! @param [in] shape OpenGL data to use as geometry
+	void set_geometry(eda221::mesh_data const& shape);
+
+	//! \brief Set the program shared by all instances.
+	//!
+	//! @param [in] program OpenGL shader program to use; it should read
+	//!             the instance transforms from the instance attribute
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms; can be empty, when all the uniforms come from
+	//!             uniform blocks
+	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms = std::function<void (GLuint)>());
+
+	//! \brief Set the material bound to the `MaterialBlock` of the program.
+	//!
+	//! @param [in] material the material to use, which has to outlive
+	//!             this node; null to not bind any
+	void set_material(eda221::material const* material);
+
+	//! \brief Add a texture shared by all instances.
+	//!
+	//! @param [in] name the variable name used by the attached OpenGL
+	//!                  shader program
+	//! @param [in] tex_id the name of an OpenGL texture
+	//! @param [in] type the type of texture; defaults to GL_TEXTURE_2D
+	void add_texture(std::string const& name, GLuint tex_id, GLenum type = GL_TEXTURE_2D);
+
+	//! \brief Upload the transforms of all instances.
+	//!
+	//! The number of instances to draw is reset to `transforms.size()`.
+	//!
+	//! @param [in] transforms model-to-world matrix of each instance
+	void set_instances(std::vector<glm::mat4> const& transforms);
+
+	//! \brief Write the transforms of all instances to the shared stream
+	//!        buffer, for the current frame only.
+	//!
+	//! Meant for transforms changing every frame: it has to be called
+	//! again on each frame, between `stream_buffer::begin_frame()` and
+	//! `stream_buffer::end_frame()`. The number of instances to draw is
+	//! reset to `transforms.size()`, or to 0 if the stream buffer is full.
+	//!
+	//! @param [in] transforms model-to-world matrix of each instance
+	void stream_instances(std::vector<glm::mat4> const& transforms);
+
+	//! \brief Get the number of instances to draw.
+	//!
+	//! @return how many instances will be drawn
+	size_t get_instances_nb() const;
+
+	//! \brief Only draw the first instances.
+	//!
+	//! @param [in] instances_nb how many instances to draw; it is clamped
+	//!             to the number of uploaded transforms
+	void set_instances_nb(size_t instances_nb);
+
+	//! \brief Replace the transform of one uploaded instance.
+	//!
+	//! Only that transform is uploaded, which suits instances stored as an
+	//! `eda221::ring_buffer`, slot by slot.
+	//!
+	//! @param [in] index of the instance; it has to be less than the
+	//!             number of transforms uploaded by `set_instances()`
+	//! @param [in] transform its new model-to-world matrix
+	void set_instance(size_t index, glm::mat4 const& transform);
+
+	//! \brief Draw a range of instances, wrapping around past the last
+	//!        uploaded transform.
+	//!
+	//! A range wrapping around is drawn with two draw calls.
+	//!
+	//! @param [in] first index of the first instance to draw
+	//! @param [in] instances_nb how many instances to draw; it is clamped
+	//!             to the number of uploaded transforms
+	void set_instances_range(size_t first, size_t instances_nb);
+
+private:
+	// Geometry data
+	GLuint _vao;
+	GLsizei _indices_nb;
+	GLenum _indices_type;
+	GLenum _mode;
+
+	// Instance data
+	GLuint _instances_bo;
+	size_t _instances_capacity;
+	size_t _instances_uploaded_nb;
+	GLsizei _instances_nb;
+	size_t _instances_first;
+	GLuint _instances_source_bo;       // either _instances_bo or the stream buffer
+	GLintptr _instances_source_offset;
+
+	// Program data
+	GLuint _program;
+	eda221::program_reflection const* _reflection;
+	std::function<void (GLuint)> _set_uniforms;
+	eda221::material const* _material;
+
+	// Textures data
+	eda221::texture_bindings _textures;
+};
@@ -1,5 +1,109 @@
 #include "interpolation.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define EDA221_HAS_SSE2 1
+#	include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Rows give the coefficients of 1, x, x^2 and x^3 of a cubic Hermite
+	// segment, from its end points p1, p2 and its end tangents m1, m2.
+	float const hermite_basis[4][4] = {
+		{  1.0f,  0.0f,  0.0f,  0.0f },
+		{  0.0f,  0.0f,  1.0f,  0.0f },
+		{ -3.0f,  3.0f, -2.0f, -1.0f },
+		{  2.0f, -2.0f,  1.0f,  1.0f }
+	};
+
+	// Knot intervals shorter than this are stretched to it, so that
+	// repeated control points do not divide by zero.
+	float const min_knot_interval = 1.0e-4f;
+
+	float
+	get_knot_interval(glm::vec3 const& p0, glm::vec3 const& p1, float alpha)
+	{
+		if (alpha == 0.0f)
+			return 1.0f;
+		auto const offset = p1 - p0;
+		return std::max(std::pow(glm::dot(offset, offset), 0.5f * alpha), min_knot_interval);
+	}
+
+	interpolation::cubic_segment
+	build_segment(glm::vec3 const& p0, glm::vec3 const& p1, glm::vec3 const& p2, glm::vec3 const& p3,
+	              float alpha, float tension)
+	{
+		// Tangents of the non-uniform Catmull-Rom spline (Barry and
+		// Goldman), in the parameter of the [p1, p2] segment; with equal
+		// intervals and a tension of 0.5, they are the usual (p2 - p0) / 2
+		// and (p3 - p1) / 2.
+		auto const d0 = get_knot_interval(p0, p1, alpha);
+		auto const d1 = get_knot_interval(p1, p2, alpha);
+		auto const d2 = get_knot_interval(p2, p3, alpha);
+		auto const scale = 2.0f * tension * d1;
+		auto const m1 = scale * ((p1 - p0) / d0 - (p2 - p0) / (d0 + d1) + (p2 - p1) / d1);
+		auto const m2 = scale * ((p2 - p1) / d1 - (p3 - p1) / (d1 + d2) + (p3 - p2) / d2);
+
+		glm::vec3 const hermite[4] = { p1, p2, m1, m2 };
+		glm::vec3 coefficients[4];
+		for (int i = 0; i < 4; ++i) {
+			coefficients[i] = glm::vec3(0.0f);
+			for (int j = 0; j < 4; ++j)
+				coefficients[i] += hermite_basis[i][j] * hermite[j];
+		}
+		return { coefficients[0], coefficients[1], coefficients[2], coefficients[3] };
+	}
+
+	glm::vec3
+	eval_segment(interpolation::cubic_segment const& segment, float x)
+	{
+		return ((segment.d * x + segment.c) * x + segment.b) * x + segment.a;
+	}
+
+	// Evaluate samples_nb points of one segment, at x = x0 + i * dx.
+	void
+	eval_segment_samples(interpolation::cubic_segment const& segment, float x0, float dx,
+	                     glm::vec3* out, size_t samples_nb)
+	{
+		size_t i = 0u;
+#if defined(EDA221_HAS_SSE2)
+		static_assert(sizeof(glm::vec3) == 3u * sizeof(float), "glm::vec3 has to be tightly packed");
+		// Four samples at a time: each lane holds one x, and the results
+		// are transposed from x, y and z vectors to interleaved points.
+		__m128 const a[3] = { _mm_set1_ps(segment.a.x), _mm_set1_ps(segment.a.y), _mm_set1_ps(segment.a.z) };
+		__m128 const b[3] = { _mm_set1_ps(segment.b.x), _mm_set1_ps(segment.b.y), _mm_set1_ps(segment.b.z) };
+		__m128 const c[3] = { _mm_set1_ps(segment.c.x), _mm_set1_ps(segment.c.y), _mm_set1_ps(segment.c.z) };
+		__m128 const d[3] = { _mm_set1_ps(segment.d.x), _mm_set1_ps(segment.d.y), _mm_set1_ps(segment.d.z) };
+		auto const lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		auto const step = _mm_set1_ps(dx);
+		for (; i + 4u <= samples_nb; i += 4u) {
+			auto const x = _mm_add_ps(_mm_set1_ps(x0 + static_cast<float>(i) * dx), _mm_mul_ps(lanes, step));
+			__m128 p[3];
+			for (size_t k = 0u; k < 3u; ++k) {
+				auto v = _mm_add_ps(_mm_mul_ps(d[k], x), c[k]);
+				v = _mm_add_ps(_mm_mul_ps(v, x), b[k]);
+				p[k] = _mm_add_ps(_mm_mul_ps(v, x), a[k]);
+			}
+			auto const xy01 = _mm_unpacklo_ps(p[0], p[1]); // x0 y0 x1 y1
+			auto const xy23 = _mm_unpackhi_ps(p[0], p[1]); // x2 y2 x3 y3
+			auto const z0x1 = _mm_shuffle_ps(p[2], xy01, _MM_SHUFFLE(2, 2, 0, 0)); // z0 z0 x1 x1
+			auto const y1z1 = _mm_shuffle_ps(xy01, p[2], _MM_SHUFFLE(1, 1, 3, 3)); // y1 y1 z1 z1
+			auto const z2z3 = _mm_shuffle_ps(p[2], xy23, _MM_SHUFFLE(3, 2, 3, 2)); // z2 z3 x3 y3
+			auto const dst = reinterpret_cast<float*>(out + i);
+			_mm_storeu_ps(dst,     _mm_shuffle_ps(xy01, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(dst + 4, _mm_shuffle_ps(y1z1, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+			_mm_storeu_ps(dst + 8, _mm_shuffle_ps(z2z3, z2z3, _MM_SHUFFLE(1, 3, 2, 0)));
+		}
+#endif
+		for (; i < samples_nb; ++i)
+			out[i] = eval_segment(segment, x0 + static_cast<float>(i) * dx);
+	}
+}
+
 glm::vec3
 interpolation::evalLERP(glm::vec3 const& p0, glm::vec3 const& p1, float const x)
 {
@@ -14,9 +118,76 @@ interpolation::evalCatmullRom(glm::vec3 const& p0, glm::vec3 const& p1,
 	float const t, float const x)
 {
 	//! \todo Implement this function
-	glm::vec3 px = p0*((-t)*x + 2.0f*t*pow(x, 2.0f) - t*pow(x, 3.0f))
-		+ p1*(1.0f + pow(x, 2.0f)*(t - 3) + pow(x, 3.0f)*(2 - t))
-		+ p2*(t*x + pow(x, 2.0f)*(3 - 2 * t) + pow(x, 3.0f)*(t - 2))
-		+ p3*(-t*pow(x, 2.0f) + t*pow(x, 3));
+	auto const x2 = x * x;
+	auto const x3 = x2 * x;
+	glm::vec3 px = p0*((-t)*x + 2.0f*t*x2 - t*x3)
+		+ p1*(1.0f + x2*(t - 3) + x3*(2 - t))
+		+ p2*(t*x + x2*(3 - 2 * t) + x3*(t - 2))
+		+ p3*(-t*x2 + t*x3);
 	return px;
 }
+
+interpolation::spline
+interpolation::buildCatmullRom(glm::vec3 const* points, size_t points_nb, bool is_closed,
+                               parameterization param, float tension)
+{
+	auto result = spline{ std::vector<cubic_segment>(), is_closed };
+	if (points_nb < 2u)
+		return result;
+
+	auto const alpha = param == parameterization::uniform ? 0.0f
+	                 : param == parameterization::centripetal ? 0.5f
+	                 : 1.0f;
+	// Open splines get mirrored end points, so that they start at the
+	// first control point and end at the last one.
+	auto const get_point = [points, points_nb, is_closed](std::ptrdiff_t i) {
+		auto const n = static_cast<std::ptrdiff_t>(points_nb);
+		if (is_closed)
+			return points[((i % n) + n) % n];
+		if (i < 0)
+			return 2.0f * points[0] - points[1];
+		if (i >= n)
+			return 2.0f * points[n - 1] - points[n - 2];
+		return points[i];
+	};
+
+	auto const segments_nb = is_closed ? points_nb : points_nb - 1u;
+	result.segments.reserve(segments_nb);
+	for (size_t i = 0u; i < segments_nb; ++i) {
+		auto const k = static_cast<std::ptrdiff_t>(i);
+		result.segments.push_back(build_segment(get_point(k - 1), get_point(k), get_point(k + 1), get_point(k + 2), alpha, tension));
+	}
+	return result;
+}
+
+void
+interpolation::evalSpline(spline const& s, glm::vec3* out, size_t samples_nb)
+{
+	if (samples_nb == 0u)
+		return;
+	auto const segments_nb = s.segments.size();
+	if (segments_nb == 0u) {
+		std::fill(out, out + samples_nb, glm::vec3(0.0f));
+		return;
+	}
+
+	// Sample i lies at u = i * du along the spline, u = k + x being at x
+	// along segment k.
+	auto const intervals_nb = s.is_closed || samples_nb == 1u ? samples_nb : samples_nb - 1u;
+	auto const du = static_cast<double>(segments_nb) / static_cast<double>(intervals_nb);
+	size_t first = 0u;
+	for (size_t k = 0u; k < segments_nb && first < samples_nb; ++k) {
+		// Samples before u = k + 1, the last segment taking the end.
+		auto last = samples_nb;
+		if (k + 1u < segments_nb) {
+			last = std::min(samples_nb, static_cast<size_t>(std::ceil((k + 1u) / du)));
+			while (last > first && (last - 1u) * du >= k + 1u)
+				--last;
+			while (last < samples_nb && last * du < k + 1u)
+				++last;
+		}
+		auto const x0 = static_cast<float>(first * du - k);
+		eval_segment_samples(s.segments[k], x0, static_cast<float>(du), out + first, last - first);
+		first = last;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace interpolation
+{
+	//! \brief How the knots of a Catmull-Rom spline are spaced: evenly,
+	//!        or by the square root of the distance between control
+	//!        points, or by that distance. Centripetal splines never form
+	//!        cusps nor loops within a segment.
+	enum class parameterization {
+		uniform,
+		centripetal,
+		chordal
+	};
+
+	//! \brief One cubic segment of a spline, p(x) = a + b x + c x^2 + d x^3
+	//!        for x in [0, 1].
+	struct cubic_segment {
+		glm::vec3 a;
+		glm::vec3 b;
+		glm::vec3 c;
+		glm::vec3 d;
+	};
+
+	//! \brief A spline, as the polynomials of its segments.
+	struct spline {
+		std::vector<cubic_segment> segments;
+		bool is_closed; //!< whether the last segment leads back to the first one
+	};
+
+	//! \brief Evaluate the linear interpolation between two points.
+	//!
+	//! @param [in] p0 the point at x = 0
+	//! @param [in] p1 the point at x = 1
+	//! @param [in] x the distance from p0, in [0, 1]
+	//! @return the interpolated point
+	glm::vec3 evalLERP(glm::vec3 const& p0, glm::vec3 const& p1, float const x);
+
+	//! \brief Evaluate a Catmull-Rom spline between p1 and p2.
+	//!
+	//! @param [in] p0 the point before p1
+	//! @param [in] p1 the point at x = 0
+	//! @param [in] p2 the point at x = 1
+	//! @param [in] p3 the point after p2
+	//! @param [in] t the tension of the spline
+	//! @param [in] x the distance from p1, in [0, 1]
+	//! @return the interpolated point
+	glm::vec3 evalCatmullRom(glm::vec3 const& p0, glm::vec3 const& p1,
+	                         glm::vec3 const& p2, glm::vec3 const& p3,
+	                         float const t, float const x);
+
+	//! \brief Precompute the segments of a Catmull-Rom spline, so that
+	//!        `evalSpline()` only evaluates polynomials.
+	//!
+	//! @param [in] points the control points
+	//! @param [in] points_nb the number of control points; at least 2 for
+	//!             the spline to have any segment
+	//! @param [in] is_closed whether the spline loops back to its first
+	//!             point, as indexing the points modulo their number does;
+	//!             otherwise, it goes from the first to the last point
+	//! @param [in] param the spacing of the knots
+	//! @param [in] tension the tension of the spline, as in
+	//!             `evalCatmullRom()`
+	//! @return the spline
+	spline buildCatmullRom(glm::vec3 const* points, size_t points_nb, bool is_closed,
+	                       parameterization param = parameterization::uniform, float tension = 0.5f);
+
+	//! \brief Evaluate a spline at evenly spaced samples, in one pass.
+	//!
+	//! Sample i lies at i * segments_nb / samples_nb segments from the
+	//! start of a closed spline, so that the samples loop seamlessly; on
+	//! an open spline, the first and last samples are its ends. Samples
+	//! are evaluated four at a time when SSE2 is available.
+	//!
+	//! @param [in] s the spline
+	//! @param [out] out where to write the samples_nb points
+	//! @param [in] samples_nb the number of samples
+	void evalSpline(spline const& s, glm::vec3* out, size_t samples_nb);
+}
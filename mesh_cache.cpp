@@ -0,0 +1,341 @@
+#include "mesh_cache.hpp"
+#include "helpers.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace
+{
+	char const mesh_cache_magic[8] = { 'E', 'D', 'A', 'M', 'E', 'S', 'H', '\0' };
+	std::uint32_t const mesh_cache_version = 1u;
+
+	// Blobs are aligned on 16 bytes within the file, which is more than
+	// any attribute or index needs.
+	std::uint64_t const blob_alignment = 16u;
+
+	struct file_header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t meshes_nb;
+		std::uint64_t source_size;
+		std::int64_t source_modification_time;
+		std::uint64_t source_hash;
+	};
+
+	struct mesh_header {
+		std::uint32_t formats[4];
+		std::uint32_t offsets[4];
+		std::uint32_t stride;
+		std::uint32_t indices_type;
+		std::uint64_t vertices_nb;
+		std::uint64_t indices_nb;
+		std::uint64_t vertex_data_offset;
+		std::uint64_t vertex_data_size;
+		std::uint64_t index_data_offset;
+		std::uint64_t index_data_size;
+	};
+
+	std::uint64_t
+	align(std::uint64_t offset)
+	{
+		return (offset + blob_alignment - 1u) & ~(blob_alignment - 1u);
+	}
+
+	// Whether [offset, offset + size) lies within [0, total), without
+	// overflowing on corrupt values.
+	bool
+	is_within(std::uint64_t offset, std::uint64_t size, std::uint64_t total)
+	{
+		return offset <= total && size <= total - offset;
+	}
+
+	// Whether the counts of a mesh match its blobs, so that uploading it
+	// does not read past them.
+	bool
+	is_mesh_consistent(mesh_header const& descriptor)
+	{
+		std::uint64_t index_size = 0u;
+		switch (descriptor.indices_type) {
+		case GL_UNSIGNED_SHORT:
+			index_size = sizeof(GLushort);
+			break;
+		case GL_UNSIGNED_INT:
+			index_size = sizeof(GLuint);
+			break;
+		default:
+			return false;
+		}
+		if (descriptor.stride == 0u)
+			return false;
+		return descriptor.indices_nb <= descriptor.index_data_size / index_size
+		    && descriptor.vertices_nb <= descriptor.vertex_data_size / descriptor.stride;
+	}
+
+	// Replace a file with another one, in a single step.
+	bool
+	replace_file(std::string const& from, std::string const& to)
+	{
+#if defined(_WIN32)
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+
+	// 64-bit FNV-1a hash of a file's content
+	bool
+	hash_file(std::string const& path, std::uint64_t& hash)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		hash = 14695981039346656037ull;
+		char buffer[64 * 1024];
+		while (file) {
+			file.read(buffer, sizeof(buffer));
+			for (std::streamsize i = 0; i < file.gcount(); ++i) {
+				hash ^= static_cast<unsigned char>(buffer[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+		return true;
+	}
+
+	bool
+	is_layout_compatible(std::uint32_t const formats[4], eda221::vertex_layout const& layout)
+	{
+		// Meshes do not store the attributes they have no data for.
+		if (formats[0] != static_cast<std::uint32_t>(layout.formats[0]))
+			return false;
+		for (size_t i = 1u; i < 4u; ++i)
+			if (formats[i] != static_cast<std::uint32_t>(eda221::attribute_format::none)
+			    && formats[i] != static_cast<std::uint32_t>(layout.formats[i]))
+				return false;
+		return true;
+	}
+}
+
+eda221::mesh_cache_file::mesh_cache_file() : _mapping(nullptr), _mapping_size(0u),
+#if defined(_WIN32)
+	_file(INVALID_HANDLE_VALUE), _file_mapping(nullptr),
+#endif
+	_meshes()
+{
+}
+
+eda221::mesh_cache_file::~mesh_cache_file()
+{
+	close();
+}
+
+bool
+eda221::mesh_cache_file::open(std::string const& cache_path, std::string const& source_path, vertex_layout const& layout)
+{
+	close();
+
+	auto const full_cache_path = config::resources_path(cache_path);
+	file_status cache_status;
+	if (!getFileStatus(full_cache_path, cache_status) || cache_status.size < sizeof(file_header))
+		return false;
+	_mapping_size = static_cast<size_t>(cache_status.size);
+
+#if defined(_WIN32)
+	_file = CreateFileA(full_cache_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+	_file_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_file_mapping != nullptr)
+		_mapping = MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	auto const descriptor = ::open(full_cache_path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	auto const mapping = mmap(nullptr, _mapping_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor);
+	if (mapping != MAP_FAILED)
+		_mapping = mapping;
+#endif
+	if (_mapping == nullptr) {
+		LogWarning("Failed to map mesh cache \"%s\"", full_cache_path.c_str());
+		close();
+		return false;
+	}
+
+	auto const bytes = static_cast<unsigned char const*>(_mapping);
+	file_header header;
+	std::memcpy(&header, bytes, sizeof(header));
+	if (std::memcmp(header.magic, mesh_cache_magic, sizeof(mesh_cache_magic)) != 0
+	    || header.version != mesh_cache_version
+	    || !is_within(sizeof(file_header), static_cast<std::uint64_t>(header.meshes_nb) * sizeof(mesh_header), _mapping_size)) {
+		close();
+		return false;
+	}
+
+	// Check the key: if the source was touched without being modified,
+	// its hash still matches. Without a source, there is nothing to
+	// tell a stale cache from a valid one.
+	auto const full_source_path = config::resources_path(source_path);
+	file_status source_status;
+	if (!getFileStatus(full_source_path, source_status)) {
+		LogWarning("Couldn't find \"%s\"; ignoring its mesh cache", full_source_path.c_str());
+		close();
+		return false;
+	}
+	if (source_status.size != header.source_size || source_status.modification_time != header.source_modification_time) {
+		std::uint64_t source_hash = 0u;
+		if (source_status.size != header.source_size
+		    || !hash_file(full_source_path, source_hash) || source_hash != header.source_hash) {
+			close();
+			return false;
+		}
+	}
+
+	_meshes.reserve(header.meshes_nb);
+	for (std::uint32_t i = 0u; i < header.meshes_nb; ++i) {
+		mesh_header descriptor;
+		std::memcpy(&descriptor, bytes + sizeof(file_header) + i * sizeof(mesh_header), sizeof(descriptor));
+		if (!is_layout_compatible(descriptor.formats, layout)
+		    || !is_within(descriptor.vertex_data_offset, descriptor.vertex_data_size, _mapping_size)
+		    || !is_within(descriptor.index_data_offset, descriptor.index_data_size, _mapping_size)
+		    || !is_mesh_consistent(descriptor)) {
+			LogWarning("Mesh cache \"%s\" is corrupt; ignoring it", full_cache_path.c_str());
+			close();
+			return false;
+		}
+
+		mesh_view mesh;
+		for (size_t a = 0u; a < 4u; ++a) {
+			mesh.layout.formats[a] = static_cast<attribute_format>(descriptor.formats[a]);
+			mesh.layout.offsets[a] = descriptor.offsets[a];
+		}
+		mesh.layout.stride = static_cast<GLsizei>(descriptor.stride);
+		mesh.vertices_nb = static_cast<size_t>(descriptor.vertices_nb);
+		mesh.vertex_data = bytes + descriptor.vertex_data_offset;
+		mesh.vertex_data_size = static_cast<size_t>(descriptor.vertex_data_size);
+		mesh.indices_type = static_cast<GLenum>(descriptor.indices_type);
+		mesh.indices_nb = static_cast<size_t>(descriptor.indices_nb);
+		mesh.index_data = bytes + descriptor.index_data_offset;
+		_meshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+void
+eda221::mesh_cache_file::close()
+{
+	_meshes.clear();
+#if defined(_WIN32)
+	if (_mapping != nullptr)
+		UnmapViewOfFile(_mapping);
+	if (_file_mapping != nullptr)
+		CloseHandle(_file_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+	_file_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+#else
+	if (_mapping != nullptr)
+		munmap(const_cast<void*>(_mapping), _mapping_size);
+#endif
+	_mapping = nullptr;
+	_mapping_size = 0u;
+}
+
+std::string
+eda221::getMeshCachePath(std::string const& filename)
+{
+	return "cache/scenes/" + filename + ".mesh";
+}
+
+bool
+eda221::writeMeshCache(std::string const& cache_path, std::string const& source_path,
+                       std::vector<packed_mesh> const& meshes)
+{
+	auto const full_source_path = config::resources_path(source_path);
+	file_header header;
+	std::memcpy(header.magic, mesh_cache_magic, sizeof(mesh_cache_magic));
+	header.version = mesh_cache_version;
+	header.meshes_nb = static_cast<std::uint32_t>(meshes.size());
+	file_status source_status;
+	if (!getFileStatus(full_source_path, source_status) || !hash_file(full_source_path, header.source_hash)) {
+		LogWarning("Couldn't read \"%s\"; not caching it", full_source_path.c_str());
+		return false;
+	}
+	header.source_size = source_status.size;
+	header.source_modification_time = source_status.modification_time;
+
+	auto descriptors = std::vector<mesh_header>(meshes.size());
+	auto offset = static_cast<std::uint64_t>(sizeof(file_header) + meshes.size() * sizeof(mesh_header));
+	for (size_t i = 0u; i < meshes.size(); ++i) {
+		auto const& mesh = meshes[i];
+		auto& descriptor = descriptors[i];
+		for (size_t a = 0u; a < 4u; ++a) {
+			descriptor.formats[a] = static_cast<std::uint32_t>(mesh.layout.formats[a]);
+			descriptor.offsets[a] = mesh.layout.offsets[a];
+		}
+		descriptor.stride = static_cast<std::uint32_t>(mesh.layout.stride);
+		descriptor.indices_type = mesh.indices_type;
+		descriptor.vertices_nb = mesh.vertices_nb;
+		descriptor.indices_nb = mesh.indices_nb;
+		descriptor.vertex_data_offset = align(offset);
+		descriptor.vertex_data_size = mesh.vertex_data.size();
+		descriptor.index_data_offset = align(descriptor.vertex_data_offset + descriptor.vertex_data_size);
+		descriptor.index_data_size = mesh.index_data.size();
+		offset = descriptor.index_data_offset + descriptor.index_data_size;
+	}
+
+	// Write next to the cache, then swap it in, so that a crash or a
+	// concurrent load never sees a partial file.
+	auto const full_cache_path = config::resources_path(cache_path);
+	auto const temporary_path = full_cache_path + ".tmp";
+	createParentFolders(full_cache_path);
+	std::ofstream file(temporary_path, std::ios::binary);
+	if (!file) {
+		LogWarning("Couldn't open \"%s\" for writing", temporary_path.c_str());
+		return false;
+	}
+
+	char const padding[blob_alignment] = {};
+	auto position = static_cast<std::uint64_t>(0u);
+	auto const write = [&file, &position, &padding](std::uint64_t at, void const* data, std::uint64_t size) {
+		file.write(padding, static_cast<std::streamsize>(at - position));
+		file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+		position = at + size;
+	};
+	write(0u, &header, sizeof(header));
+	write(position, descriptors.data(), descriptors.size() * sizeof(mesh_header));
+	for (size_t i = 0u; i < meshes.size(); ++i) {
+		write(descriptors[i].vertex_data_offset, meshes[i].vertex_data.data(), descriptors[i].vertex_data_size);
+		write(descriptors[i].index_data_offset, meshes[i].index_data.data(), descriptors[i].index_data_size);
+	}
+
+	file.close();
+	if (!file) {
+		LogWarning("Couldn't write \"%s\"", temporary_path.c_str());
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+	if (!replace_file(temporary_path, full_cache_path)) {
+		LogWarning("Couldn't replace \"%s\"", full_cache_path.c_str());
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
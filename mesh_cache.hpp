@@ -0,0 +1,94 @@
+#pragma once
+
+#include "vertex_layout.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief A packed mesh read from a mesh cache file, pointing directly
+	//!        into the mapped file.
+	struct mesh_view {
+		vertex_layout layout;     //!< layout of `vertex_data`
+		size_t vertices_nb;       //!< number of vertices
+		void const* vertex_data;  //!< interleaved vertices
+		size_t vertex_data_size;  //!< size of `vertex_data`, in bytes
+		GLenum indices_type;      //!< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		size_t indices_nb;        //!< number of indices
+		void const* index_data;   //!< triangle indices
+	};
+
+	//! \brief Memory-mapped mesh cache file, as written by
+	//!        `writeMeshCache()`.
+	//!
+	//! The file consists of a header identifying the source scene (its
+	//! size, modification time and a 64-bit FNV-1a hash of its content),
+	//! followed by, for each mesh, a vertex layout descriptor, the
+	//! interleaved vertex blob and the index blob. Blobs are aligned so
+	//! that they can be handed to OpenGL without any copy.
+	class mesh_cache_file
+	{
+	public:
+		//! \brief Default constructor; nothing is mapped.
+		mesh_cache_file();
+
+		//! \brief Unmap the file.
+		~mesh_cache_file();
+
+		mesh_cache_file(mesh_cache_file const&) = delete;
+		mesh_cache_file& operator=(mesh_cache_file const&) = delete;
+
+		//! \brief Map a cache file, if it is valid for a source scene.
+		//!
+		//! The cache is valid if it was written from a file with the same
+		//! size and modification time as the source, or, if those differ,
+		//! with the same content hash; a cache whose source is missing is
+		//! not valid. Meshes packed with a different layout than `layout`,
+		//! or whose counts do not fit their blobs, are not valid either.
+		//!
+		//! @param [in] cache_path path of the cache file, relative to the
+		//!             `resources` folder
+		//! @param [in] source_path path of the source scene, relative to
+		//!             the `resources` folder
+		//! @param [in] layout the expected vertex layout
+		//! @return whether the cache was valid and could be mapped
+		bool open(std::string const& cache_path, std::string const& source_path, vertex_layout const& layout);
+
+		//! \brief Unmap the file, invalidating the mesh views.
+		void close();
+
+		//! \brief Get the meshes of the mapped file; they are valid until
+		//!        the file is closed.
+		std::vector<mesh_view> const& get_meshes() const { return _meshes; }
+
+	private:
+		void const* _mapping;
+		size_t _mapping_size;
+#if defined(_WIN32)
+		void* _file;
+		void* _file_mapping;
+#endif
+		std::vector<mesh_view> _meshes;
+	};
+
+	//! \brief Get where the cached version of a scene is stored.
+	//!
+	//! @param [in] filename of the scene, relative to the `scenes` folder
+	//! @return the path of the cache file, relative to the `resources`
+	//!         folder
+	std::string getMeshCachePath(std::string const& filename);
+
+	//! \brief Write packed meshes to a cache file, keyed by their source.
+	//!
+	//! @param [in] cache_path path of the cache file, relative to the
+	//!             `resources` folder; missing folders are created, and
+	//!             the file is only replaced once fully written
+	//! @param [in] source_path path of the source scene, relative to the
+	//!             `resources` folder
+	//! @param [in] meshes the meshes imported from the source
+	//! @return whether the file could be written
+	bool writeMeshCache(std::string const& cache_path, std::string const& source_path,
+	                    std::vector<packed_mesh> const& meshes);
+}
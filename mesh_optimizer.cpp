@@ -0,0 +1,279 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	eda221::mesh_optimization_options options = { true, false, true };
+
+	// Size of the LRU cache modelled by the Forsyth optimiser
+	int const forsyth_cache_size = 32;
+
+	// Clusters shorter than this are merged with the next one by the
+	// overdraw optimiser, so that sorting them does not hurt the cache.
+	size_t const min_cluster_triangles_nb = 64u;
+
+	GLuint const invalid_index = std::numeric_limits<GLuint>::max();
+
+	float
+	forsyth_vertex_score(int cache_position, GLuint remaining_triangles_nb)
+	{
+		if (remaining_triangles_nb == 0u)
+			return -1.0f; // no triangle needs this vertex anymore
+
+		auto score = 0.0f;
+		if (cache_position >= 0) {
+			if (cache_position < 3) {
+				// Used by the last triangle: give it a fixed score, so
+				// that strips are not favoured over fans.
+				score = 0.75f;
+			} else {
+				auto const scaler = 1.0f / static_cast<float>(forsyth_cache_size - 3);
+				score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, 1.5f);
+			}
+		}
+		// Favour vertices with few triangles left, to get rid of them.
+		score += 2.0f / std::sqrt(static_cast<float>(remaining_triangles_nb));
+		return score;
+	}
+}
+
+eda221::mesh_optimization_options const&
+eda221::getMeshOptimizationOptions()
+{
+	return options;
+}
+
+void
+eda221::setMeshOptimizationOptions(mesh_optimization_options const& new_options)
+{
+	options = new_options;
+}
+
+float
+eda221::computeACMR(GLuint const* indices, size_t indices_nb, size_t vertices_nb, unsigned int cache_size)
+{
+	if (indices_nb < 3u)
+		return 0.0f;
+
+	// Time at which each vertex entered the FIFO; it is still cached if
+	// fewer than `cache_size` vertices entered it since.
+	auto entry_time = std::vector<size_t>(vertices_nb, 0u);
+	size_t misses_nb = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto const v = indices[i];
+		if (entry_time[v] == 0u || misses_nb + 1u - entry_time[v] > cache_size) {
+			++misses_nb;
+			entry_time[v] = misses_nb;
+		}
+	}
+	return static_cast<float>(misses_nb) / static_cast<float>(indices_nb / 3u);
+}
+
+void
+eda221::optimizeVertexCache(GLuint* indices, size_t indices_nb, size_t vertices_nb)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return;
+
+	// Triangles using each vertex, stored contiguously per vertex
+	auto remaining = std::vector<GLuint>(vertices_nb, 0u);
+	for (size_t i = 0u; i < indices_nb; ++i)
+		++remaining[indices[i]];
+	auto adjacency_offsets = std::vector<GLuint>(vertices_nb + 1u, 0u);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		adjacency_offsets[v + 1u] = adjacency_offsets[v] + remaining[v];
+	auto adjacency = std::vector<GLuint>(indices_nb);
+	{
+		auto cursors = std::vector<GLuint>(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (size_t i = 0u; i < indices_nb; ++i)
+			adjacency[cursors[indices[i]]++] = static_cast<GLuint>(i / 3u);
+	}
+
+	auto cache_position = std::vector<int>(vertices_nb, -1);
+	auto vertex_score = std::vector<float>(vertices_nb);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+
+	auto triangle_emitted = std::vector<bool>(triangles_nb, false);
+	auto triangle_score = std::vector<float>(triangles_nb);
+	auto best_triangle = invalid_index;
+	auto best_score = -1.0f;
+	for (size_t t = 0u; t < triangles_nb; ++t) {
+		triangle_score[t] = vertex_score[indices[3u * t + 0u]]
+		                  + vertex_score[indices[3u * t + 1u]]
+		                  + vertex_score[indices[3u * t + 2u]];
+		if (triangle_score[t] > best_score) {
+			best_score = triangle_score[t];
+			best_triangle = static_cast<GLuint>(t);
+		}
+	}
+
+	auto cache = std::array<GLuint, forsyth_cache_size + 3>();
+	size_t cache_nb = 0u;
+	auto output = std::vector<GLuint>();
+	output.reserve(indices_nb);
+	size_t scan_cursor = 0u;
+
+	while (best_triangle != invalid_index) {
+		triangle_emitted[best_triangle] = true;
+		GLuint const* const triangle = indices + 3u * best_triangle;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// Move the triangle's vertices to the front of the LRU cache.
+		auto new_cache = std::array<GLuint, forsyth_cache_size + 3>();
+		size_t new_cache_nb = 0u;
+		for (size_t k = 0u; k < 3u; ++k) {
+			--remaining[triangle[k]];
+			if (std::find(new_cache.begin(), new_cache.begin() + new_cache_nb, triangle[k]) == new_cache.begin() + new_cache_nb)
+				new_cache[new_cache_nb++] = triangle[k];
+		}
+		for (size_t i = 0u; i < cache_nb; ++i)
+			if (std::find(new_cache.begin(), new_cache.begin() + new_cache_nb, cache[i]) == new_cache.begin() + new_cache_nb)
+				new_cache[new_cache_nb++] = cache[i];
+
+		// Update the scores of every vertex whose position changed,
+		// including the ones just evicted.
+		for (size_t i = 0u; i < new_cache_nb; ++i) {
+			auto const v = new_cache[i];
+			cache_position[v] = i < static_cast<size_t>(forsyth_cache_size) ? static_cast<int>(i) : -1;
+			vertex_score[v] = forsyth_vertex_score(cache_position[v], remaining[v]);
+		}
+
+		// Only triangles touching those vertices changed score; pick the
+		// best one among them.
+		best_triangle = invalid_index;
+		best_score = -1.0f;
+		for (size_t i = 0u; i < new_cache_nb; ++i) {
+			auto const v = new_cache[i];
+			for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1u]; ++a) {
+				auto const t = adjacency[a];
+				if (triangle_emitted[t])
+					continue;
+				triangle_score[t] = vertex_score[indices[3u * t + 0u]]
+				                  + vertex_score[indices[3u * t + 1u]]
+				                  + vertex_score[indices[3u * t + 2u]];
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best_triangle = t;
+				}
+			}
+		}
+
+		cache_nb = std::min(new_cache_nb, static_cast<size_t>(forsyth_cache_size));
+		std::copy(new_cache.begin(), new_cache.begin() + cache_nb, cache.begin());
+
+		// Nothing left around the cache: restart from any remaining
+		// triangle.
+		if (best_triangle == invalid_index) {
+			while (scan_cursor < triangles_nb && triangle_emitted[scan_cursor])
+				++scan_cursor;
+			if (scan_cursor < triangles_nb)
+				best_triangle = static_cast<GLuint>(scan_cursor);
+		}
+	}
+
+	assert(output.size() == triangles_nb * 3u);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void
+eda221::optimizeOverdraw(GLuint* indices, size_t indices_nb, glm::vec3 const* vertices, size_t vertices_nb)
+{
+	auto const triangles_nb = indices_nb / 3u;
+	if (triangles_nb == 0u)
+		return;
+
+	// Split the triangles into clusters, wherever a triangle misses the
+	// (FIFO) cache for all three of its vertices.
+	unsigned int const cache_size = 32u;
+	auto entry_time = std::vector<size_t>(vertices_nb, 0u);
+	size_t misses_nb = 0u;
+	auto cluster_starts = std::vector<size_t>(1u, 0u);
+	for (size_t t = 0u; t < triangles_nb; ++t) {
+		unsigned int triangle_misses_nb = 0u;
+		for (size_t k = 0u; k < 3u; ++k) {
+			auto const v = indices[3u * t + k];
+			if (entry_time[v] == 0u || misses_nb + 1u - entry_time[v] > cache_size) {
+				++misses_nb;
+				++triangle_misses_nb;
+				entry_time[v] = misses_nb;
+			}
+		}
+		if (triangle_misses_nb == 3u && t - cluster_starts.back() >= min_cluster_triangles_nb)
+			cluster_starts.push_back(t);
+	}
+	if (cluster_starts.size() < 2u)
+		return;
+	cluster_starts.push_back(triangles_nb);
+
+	auto mesh_centroid = glm::vec3(0.0f);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		mesh_centroid += vertices[v];
+	mesh_centroid /= static_cast<float>(vertices_nb);
+
+	// Clusters facing away from the centre are more likely to occlude the
+	// rest of the mesh: draw them first.
+	auto const clusters_nb = cluster_starts.size() - 1u;
+	auto sort_keys = std::vector<std::pair<float, size_t>>(clusters_nb);
+	for (size_t c = 0u; c < clusters_nb; ++c) {
+		auto centroid = glm::vec3(0.0f);
+		auto normal = glm::vec3(0.0f);
+		auto area = 0.0f;
+		for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1u]; ++t) {
+			auto const& p0 = vertices[indices[3u * t + 0u]];
+			auto const& p1 = vertices[indices[3u * t + 1u]];
+			auto const& p2 = vertices[indices[3u * t + 2u]];
+			auto const weighted_normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+			auto const triangle_area = glm::length(weighted_normal);
+			centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+			normal += weighted_normal;
+			area += triangle_area;
+		}
+		if (area > 0.0f)
+			centroid /= area;
+		auto const normal_length = glm::length(normal);
+		if (normal_length > 0.0f)
+			normal /= normal_length;
+		sort_keys[c] = std::make_pair(-glm::dot(centroid - mesh_centroid, normal), c);
+	}
+	std::stable_sort(sort_keys.begin(), sort_keys.end(),
+	                 [](std::pair<float, size_t> const& a, std::pair<float, size_t> const& b) { return a.first < b.first; });
+
+	auto output = std::vector<GLuint>();
+	output.reserve(indices_nb);
+	for (auto const& key : sort_keys) {
+		auto const c = key.second;
+		output.insert(output.end(), indices + 3u * cluster_starts[c], indices + 3u * cluster_starts[c + 1u]);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+std::vector<GLuint>
+eda221::optimizeVertexFetch(GLuint* indices, size_t indices_nb, size_t vertices_nb)
+{
+	auto remap = std::vector<GLuint>(vertices_nb, invalid_index);
+	auto order = std::vector<GLuint>();
+	order.reserve(vertices_nb);
+
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto& new_index = remap[indices[i]];
+		if (new_index == invalid_index) {
+			new_index = static_cast<GLuint>(order.size());
+			order.push_back(indices[i]);
+		}
+		indices[i] = new_index;
+	}
+
+	// Keep unreferenced vertices, so that the vertex count does not change.
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		if (remap[v] == invalid_index)
+			order.push_back(static_cast<GLuint>(v));
+
+	return order;
+}
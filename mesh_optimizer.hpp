@@ -0,0 +1,78 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Which optimisations `eda221::createMeshData()` applies to the
+	//!        meshes it uploads.
+	struct mesh_optimization_options {
+		bool vertex_cache; //!< reorder triangles for post-transform cache locality
+		bool overdraw;     //!< sort triangle clusters to reduce overdraw
+		bool vertex_fetch; //!< reorder vertices in the order they are first used
+	};
+
+	//! \brief Get the optimisations applied to uploaded meshes.
+	//!
+	//! @return the options set by `setMeshOptimizationOptions()`; by
+	//!         default, vertex cache and vertex fetch optimisations are
+	//!         enabled, overdraw optimisation is not
+	mesh_optimization_options const& getMeshOptimizationOptions();
+
+	//! \brief Change the optimisations applied to uploaded meshes.
+	//!
+	//! @param [in] options the options to use for meshes created afterwards
+	void setMeshOptimizationOptions(mesh_optimization_options const& options);
+
+	//! \brief Compute the Average Cache Miss Ratio of a triangle list.
+	//!
+	//! The post-transform vertex cache is modelled as a FIFO.
+	//!
+	//! @param [in] indices the triangle indices
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] vertices_nb the number of vertices referenced
+	//! @param [in] cache_size the number of entries of the modelled cache
+	//! @return the average number of vertices transformed per triangle,
+	//!         between 0.5 (ideal, for large grids) and 3 (no reuse)
+	float computeACMR(GLuint const* indices, size_t indices_nb, size_t vertices_nb,
+	                  unsigned int cache_size = 32u);
+
+	//! \brief Reorder triangles to improve post-transform vertex cache
+	//!        locality, following Tom Forsyth's "Linear-Speed Vertex Cache
+	//!        Optimisation".
+	//!
+	//! @param [in,out] indices the triangle indices, reordered in place
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] vertices_nb the number of vertices referenced
+	void optimizeVertexCache(GLuint* indices, size_t indices_nb, size_t vertices_nb);
+
+	//! \brief Reorder clusters of triangles so that the ones more likely to
+	//!        occlude the others are drawn first.
+	//!
+	//! The triangles are expected to be already optimised for the vertex
+	//! cache: the list is split into clusters wherever the cache is
+	//! flushed, so that the cache efficiency is mostly kept. Clusters are
+	//! then sorted by how much they face away from the mesh centre (see
+	//! Sander et al., "Fast Triangle Reordering for Vertex Locality and
+	//! Reduced Overdraw").
+	//!
+	//! @param [in,out] indices the triangle indices, reordered in place
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] vertices the vertex positions
+	//! @param [in] vertices_nb the number of vertices
+	void optimizeOverdraw(GLuint* indices, size_t indices_nb, glm::vec3 const* vertices, size_t vertices_nb);
+
+	//! \brief Renumber vertices in the order they are first referenced, to
+	//!        improve pre-transform (fetch) locality.
+	//!
+	//! @param [in,out] indices the triangle indices, rewritten in place
+	//! @param [in] indices_nb the number of indices
+	//! @param [in] vertices_nb the number of vertices
+	//! @return for each new vertex, the index of the original vertex it
+	//!         should be copied from; unreferenced vertices are kept, at
+	//!         the end
+	std::vector<GLuint> optimizeVertexFetch(GLuint* indices, size_t indices_nb, size_t vertices_nb);
+}
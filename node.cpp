@@ -1,48 +1,102 @@
 #include "node.hpp"
 #include "helpers.hpp"
+#include "program_reflection.hpp"
 
 #include "core/Log.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Node::Node() : _vao(0u), _indices_nb(0u), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
+#include <algorithm>
+
+Node::Node() : _vao(0u), _indices_nb(0u), _indices_type(GL_UNSIGNED_INT), _mode(GL_TRIANGLES), _program(0u), _reflection(&eda221::getProgramReflection(0u)), _set_uniforms(), _material(nullptr), _textures(), _has_diffuse_texture(false), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _local(), _world(), _normal_world(), _local_dirty(true), _world_dirty(true), _parent(nullptr), _children()
+{
+}
+
+void
+Node::render(glm::mat4 const& WVP) const
 {
+	eda221::render_queue queue;
+	queue.set_world_to_clip(WVP);
+	enqueue(queue);
+	queue.flush();
 }
 
 void
 Node::render(glm::mat4 const& WVP, glm::mat4 const& world) const
 {
-	if (_vao == 0u || _program == 0u)
+	eda221::render_queue queue;
+	queue.set_world_to_clip(WVP);
+	queue.submit(make_packet(world, glm::transpose(glm::inverse(world))));
+	queue.flush();
+}
+
+void
+Node::enqueue(eda221::render_queue& queue) const
+{
+	// Only a root may seed the cache: the world transforms of a child
+	// depend on its parent.
+	if (_parent != nullptr) {
+		enqueue_uncached(queue, glm::mat4());
 		return;
+	}
+	update_world_transforms(glm::mat4(), false);
+	enqueue_subtree(queue);
+}
 
-	glUseProgram(_program);
+void
+Node::update_world_transforms(glm::mat4 const& parent_world, bool parent_changed) const
+{
+	auto const changed = parent_changed || _world_dirty;
+	if (changed) {
+		_world = parent_world * get_transform();
+		_normal_world = glm::transpose(glm::inverse(_world));
+		_world_dirty = false;
+	}
 
-	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+	for (auto const child : _children)
+		child->update_world_transforms(_world, changed);
+}
 
-	_set_uniforms(_program);
+void
+Node::enqueue_subtree(eda221::render_queue& queue) const
+{
+	queue.submit(make_packet(_world, _normal_world));
 
-	glUniformMatrix4fv(glGetUniformLocation(_program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(_program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(_program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(WVP));
+	for (auto const child : _children)
+		child->enqueue_subtree(queue);
+}
 
-	glUniform1i(glGetUniformLocation(_program, "has_textures"), !_textures.empty());
-	bool has_diffuse_texture = false;
-	for (size_t i = 0u; i < _textures.size(); ++i) {
-		auto const texture = _textures[i];
-		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(_program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-		if (std::get<0>(texture) == "diffuse_texture")
-			has_diffuse_texture = true;
-	}
-	glUniform1i(glGetUniformLocation(_program, "has_diffuse_texture"), has_diffuse_texture);
+void
+Node::enqueue_uncached(eda221::render_queue& queue, glm::mat4 const& parent_world) const
+{
+	auto const world = parent_world * get_transform();
+	queue.submit(make_packet(world, glm::transpose(glm::inverse(world))));
 
-	glBindVertexArray(_vao);
-	glDrawElements(GL_TRIANGLES, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-	glBindVertexArray(0u);
+	for (auto const child : _children)
+		child->enqueue_uncached(queue, world);
+}
 
-	glUseProgram(0u);
+eda221::draw_packet
+Node::make_packet(glm::mat4 const& world, glm::mat4 const& normal_world) const
+{
+	eda221::draw_packet packet;
+	packet.program = _program;
+	packet.reflection = _reflection;
+	packet.set_uniforms = &_set_uniforms;
+	packet.textures = &_textures;
+	packet.has_diffuse_texture = _has_diffuse_texture;
+	packet.material = _material;
+	packet.vao = _vao;
+	packet.indices_nb = _indices_nb;
+	packet.indices_type = _indices_type;
+	packet.mode = _mode;
+	packet.instances_bo = 0u;
+	packet.instances_offset = 0;
+	packet.instances_nb = 0;
+	packet.world = world;
+	packet.normal_world = normal_world;
+	return packet;
 }
 
 void
@@ -50,13 +104,25 @@ Node::set_geometry(eda221::mesh_data const& shape)
 {
 	_vao = shape.vao;
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_indices_type = shape.indices_type;
+	_mode = shape.mode;
 }
 
 void
 Node::set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms)
 {
 	_program = program;
+	_reflection = &eda221::getProgramReflection(program);
 	_set_uniforms = set_uniforms;
+
+	for (auto& texture : _textures)
+		std::get<3>(texture) = _reflection->get_location(std::get<0>(texture));
+}
+
+void
+Node::set_material(eda221::material const* material)
+{
+	_material = material;
 }
 
 size_t
@@ -74,16 +140,51 @@ Node::set_indices_nb(size_t const& indices_nb)
 void
 Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 {
-	if (tex_id != 0u)
-		_textures.emplace_back(name, tex_id, type);
+	if (tex_id == 0u)
+		return;
+
+	_textures.emplace_back(name, tex_id, type, _reflection->get_location(name));
+	if (name == "diffuse_texture")
+		_has_diffuse_texture = true;
+}
+
+void
+Node::replace_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+	if (tex_id == 0u)
+		return;
+
+	for (auto& texture : _textures) {
+		if (std::get<0>(texture) == name) {
+			std::get<1>(texture) = tex_id;
+			std::get<2>(texture) = type;
+			return;
+		}
+	}
+	add_texture(name, tex_id, type);
 }
 
 void
-Node::add_child(Node const* child)
+Node::add_child(Node* child)
 {
-	if (child == nullptr)
+	if (child == nullptr) {
 		LogError("Trying to add a nullptr as child!");
+		return;
+	}
+	if (child == this) {
+		LogError("Trying to add a node as its own child!");
+		return;
+	}
+	if (child->_parent == this)
+		return;
+	if (child->_parent != nullptr) {
+		auto& siblings = child->_parent->_children;
+		siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
+	}
 	_children.emplace_back(child);
+	// The child now has a parent, so its world transform has to change.
+	child->_parent = this;
+	child->_world_dirty = true;
 }
 
 size_t
@@ -103,36 +204,45 @@ void
 Node::set_translation(glm::vec3 const& translation)
 {
 	_translation = translation;
+	mark_dirty();
 }
 
 void
 Node::translate(glm::vec3 const& v)
 {
 	_translation += v;
+	mark_dirty();
 }
 
 void
 Node::set_scaling(glm::vec3 const& scaling)
 {
 	_scaling = scaling;
+	mark_dirty();
 }
 
 void
 Node::scale(glm::vec3 const& s)
 {
 	_scaling *= s;
+	mark_dirty();
 }
 
 glm::mat4x4
 Node::get_transform() const
 {
-	auto const scaling =  glm::scale(glm::mat4(), _scaling);
-	auto const translating = glm::translate(glm::mat4(), _translation);
-	auto const rotation_x = glm::rotate(glm::mat4(), _rotation.x, glm::vec3(1.0, 0.0, 0.0));
-	auto const rotation_y = glm::rotate(glm::mat4(), _rotation.y, glm::vec3(0.0, 1.0, 0.0));
-	auto const rotation_z = glm::rotate(glm::mat4(), _rotation.z, glm::vec3(0.0, 0.0, 1.0));
-	auto const rotating = rotation_z * rotation_y * rotation_x;
-
-	//! \todo Use the same code as in assignment 1
-	return translating * rotating * scaling;
+	if (!_local_dirty)
+		return _local;
+
+	// translating * rotation_z * rotation_y * rotation_x * scaling, where
+	// each step is applied in place rather than through a full matrix
+	// product.
+	auto transform = glm::translate(glm::mat4(), _translation);
+	transform = glm::rotate(transform, _rotation.z, glm::vec3(0.0, 0.0, 1.0));
+	transform = glm::rotate(transform, _rotation.y, glm::vec3(0.0, 1.0, 0.0));
+	transform = glm::rotate(transform, _rotation.x, glm::vec3(1.0, 0.0, 0.0));
+	_local = glm::scale(transform, _scaling);
+	_local_dirty = false;
+
+	return _local;
 }
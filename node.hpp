@@ -4,13 +4,17 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "render_queue.hpp"
+
 #include <functional>
 #include <tuple>
 #include <vector>
 
 namespace eda221
 {
+	class material;
 	struct mesh_data;
+	class program_reflection;
 }
 
 //! \brief Represents a node of a scene graph
@@ -20,7 +24,34 @@ public:
 	//! \brief Default constructor.
 	Node();
 
-	//! \brief Render this node.
+	//! \brief Render this node and all its descendants.
+	//!
+	//! This node is considered to be the root of the hierarchy: its
+	//! world transform is its own transform, and the world transform of
+	//! each child is the world transform of its parent composed with its
+	//! own transform. World transforms are cached, and only recomputed for
+	//! the subtrees which were modified since the previous render; the
+	//! cache belongs to the actual root, so rendering a child directly
+	//! computes its subtree afresh instead.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space;
+	//!             only used for sorting, as shaders read it from the
+	//!             `FrameBlock` (see `eda221::setFrameBlock()`)
+	void render(glm::mat4 const& WVP) const;
+
+	//! \brief Submit this node and all its descendants to a render queue.
+	//!
+	//! Same as `render(WVP)`, except that the draws are only issued when
+	//! the queue is flushed, sorted along with the draws of other nodes.
+	//!
+	//! @param [in] queue the queue to add the draws to; its
+	//!             world-to-clip matrix should already be set
+	void enqueue(eda221::render_queue& queue) const;
+
+	//! \brief Render this node only, with an explicit transform.
+	//!
+	//! Children are not rendered, and the cached world transform is not
+	//! used; prefer `render(WVP)` whenever possible.
 	//!
 	//! @param [in] WVP Matrix transforming from world-space to clip-space
 	//! @param [in] world Matrix transforming from model-space to
@@ -48,13 +79,22 @@ public:
 	//! \brief Set the program of this node.
 	//!
 	//! A node without a program will not render itself, but its children
-	//! will be rendered if they have one.
+	//! will be rendered if they have one. The locations of the uniforms
+	//! and samplers used by this node are resolved here, once, rather than
+	//! on every render.
 	//!
 	//! @param [in] program OpenGL shader program to use
 	//! @param [in] set_uniforms function that will take as argument an
 	//!             OpenGL shader program, and will setup that program's
-	//!             uniforms
-	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms);
+	//!             uniforms; can be empty, when all the uniforms come from
+	//!             uniform blocks
+	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms = std::function<void (GLuint)>());
+
+	//! \brief Set the material bound to the `MaterialBlock` of the program.
+	//!
+	//! @param [in] material the material to use, which has to outlive
+	//!             this node; null to not bind any
+	void set_material(eda221::material const* material);
 
 	//! \brief Add a texture to this node.
 	//!
@@ -65,11 +105,20 @@ public:
 	//! @param [in] type the type of texture; defaults to GL_TEXTURE_2D
 	void add_texture(std::string const& name, GLuint tex_id, GLenum type = GL_TEXTURE_2D);
 
+	//! \brief Replace the texture added under a name, for example to
+	//!        follow a texture swapped every frame; add it if there is none.
+	//!
+	//! See `add_texture()` for the parameters.
+	void replace_texture(std::string const& name, GLuint tex_id, GLenum type = GL_TEXTURE_2D);
+
 	//! \brief Add a child to this node.
 	//!
+	//! A node has at most one parent: a child of another node is first
+	//! removed from it.
+	//!
 	//! @param [in] child pointer to the child to add; the pointer has to
 	//!             be non-null
-	void add_child(Node const* child);
+	void add_child(Node* child);
 
 	//! \brief Return the number of children to this node.
 	//!
@@ -98,40 +147,40 @@ public:
 	//!
 	//! @param [in] angle new rotation angle along the x-axis; it should be
 	//!                   given in radians
-	void set_rotation_x(float angle) { _rotation.x = angle; }
+	void set_rotation_x(float angle) { _rotation.x = angle; mark_dirty(); }
 
 	//! \brief Rotate this node along the x-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the x-axis; it should be given in
 	//!                     radians
-	void rotate_x(float d_angle) { _rotation.x += d_angle; }
+	void rotate_x(float d_angle) { _rotation.x += d_angle; mark_dirty(); }
 
 	//! \brief Reset the rotation along the y-axis to a new value.
 	//!
 	//! @param [in] angle new rotation angle along the y-axis; it should be
 	//!                   given in radians
-	void set_rotation_y(float angle) { _rotation.y = angle; }
+	void set_rotation_y(float angle) { _rotation.y = angle; mark_dirty(); }
 
 	//! \brief Rotate this node along the y-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the y-axis; it should be given in
 	//!                     radians
-	void rotate_y(float d_angle) { _rotation.y += d_angle; }
+	void rotate_y(float d_angle) { _rotation.y += d_angle; mark_dirty(); }
 
 	//! \brief Reset the rotation along the z-axis to a new value.
 	//!
 	//! @param [in] angle new rotation angle along the z-axis; it should be
 	//!                   given in radians
-	void set_rotation_z(float angle) { _rotation.z = angle; }
+	void set_rotation_z(float angle) { _rotation.z = angle; mark_dirty(); }
 
 	//! \brief Rotate this node along the z-axis.
 	//!
 	//! @param [in] d_angle delta angle to add to the current rotation
 	//!                     angle around the z-axis; it should be given in
 	//!                     radians
-	void rotate_z(float d_angle) { _rotation.z += d_angle; }
+	void rotate_z(float d_angle) { _rotation.z += d_angle; mark_dirty(); }
 
 	//! \brief Reset the scaling to a new value.
 	//!
@@ -148,26 +197,63 @@ public:
 	//! \brief Return this node transformation matrix.
 	//!
 	//! @return the composition of the rotation, scaling and translation
-	//!         transformations; this is the model matrix of this node
+	//!         transformations; this is the model matrix of this node,
+	//!         relative to its parent
 	glm::mat4x4 get_transform() const;
 
+	//! \brief Return the world transform computed during the last call
+	//!        to `render(WVP)` on the root of this node's hierarchy.
+	//!
+	//! @return the matrix transforming from model-space to world-space
+	glm::mat4x4 const& get_world_transform() const { return _world; }
+
 private:
+	// Flag the local, and therefore the world, transform as outdated.
+	void mark_dirty() { _local_dirty = true; _world_dirty = true; }
+
+	// Recompute the world transforms of this subtree, if this node or one
+	// of its ancestors changed.
+	void update_world_transforms(glm::mat4 const& parent_world, bool parent_changed) const;
+
+	// Submit this subtree using the cached world transforms.
+	void enqueue_subtree(eda221::render_queue& queue) const;
+
+	// Submit this subtree, computing its world transforms from
+	// `parent_world` without caching them.
+	void enqueue_uncached(eda221::render_queue& queue, glm::mat4 const& parent_world) const;
+
+	// Describe the draw call for this node only.
+	eda221::draw_packet make_packet(glm::mat4 const& world, glm::mat4 const& normal_world) const;
+
 	// Geometry data
 	GLuint _vao;
 	GLsizei _indices_nb;
+	GLenum _indices_type;
+	GLenum _mode;
 
 	// Program data
 	GLuint _program;
+	eda221::program_reflection const* _reflection;
 	std::function<void (GLuint)> _set_uniforms;
+	eda221::material const* _material;
 
 	// Textures data
-	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+	eda221::texture_bindings _textures;
+	bool _has_diffuse_texture;
 
 	// Transformation data
 	glm::vec3 _scaling;
 	glm::vec3 _rotation; // as (angle around x-axis, angle around y-axis, angle around z-axis)
 	glm::vec3 _translation;
 
-	// Children data
+	// Cached transforms
+	mutable glm::mat4 _local;
+	mutable glm::mat4 _world;
+	mutable glm::mat4 _normal_world; // inverse-transpose of _world
+	mutable bool _local_dirty;
+	mutable bool _world_dirty;
+
+	// Hierarchy data
+	Node* _parent; // owner of the cached world transform, if any
 	std::vector<Node const*> _children;
 };
@@ -0,0 +1,282 @@
+#include "ocean.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+#include "core/utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <utility>
+
+namespace
+{
+	using complex = std::complex<float>;
+
+	float const gravity = 9.81f;
+
+	// Rows are split across threads once there are that many texels per
+	// thread.
+	size_t const min_texels_per_thread = 16384u;
+
+	// std::complex multiplication checks for infinities and NaNs, which
+	// costs more than the multiplication itself.
+	inline complex
+	multiply(complex const& a, complex const& b)
+	{
+		return complex(a.real() * b.real() - a.imag() * b.imag(),
+		               a.real() * b.imag() + a.imag() * b.real());
+	}
+
+	bool
+	is_power_of_two(unsigned int n)
+	{
+		return n != 0u && (n & (n - 1u)) == 0u;
+	}
+
+	// In-place inverse FFT of one row, without normalisation: radix-2,
+	// decimation in time.
+	void
+	inverse_fft(complex* row, std::vector<complex> const& twiddles, std::vector<unsigned int> const& bit_reversal)
+	{
+		auto const n = bit_reversal.size();
+		for (size_t i = 0u; i < n; ++i) {
+			auto const j = bit_reversal[i];
+			if (i < j)
+				std::swap(row[i], row[j]);
+		}
+		for (size_t half = 1u; half < n; half *= 2u) {
+			auto const stride = n / (2u * half);
+			for (size_t start = 0u; start < n; start += 2u * half) {
+				for (size_t k = 0u; k < half; ++k) {
+					auto const a = row[start + k];
+					auto const b = multiply(row[start + k + half], twiddles[k * stride]);
+					row[start + k] = a + b;
+					row[start + k + half] = a - b;
+				}
+			}
+		}
+	}
+
+	// Phillips spectrum, with the waves much shorter than the wind's
+	// largest wave damped, and the waves going against the wind reduced.
+	float
+	phillips(glm::vec2 const& k, eda221::ocean_settings const& settings)
+	{
+		auto const k_length = glm::length(k);
+		auto const wind_speed = glm::length(settings.wind);
+		if (k_length < 1.0e-6f || wind_speed < 1.0e-6f)
+			return 0.0f;
+		auto const largest_wave = wind_speed * wind_speed / gravity;
+		auto const smallest_wave = largest_wave / 1000.0f;
+		auto const alignment = glm::dot(k / k_length, settings.wind / wind_speed);
+		auto const k2 = k_length * k_length;
+		auto p = settings.amplitude * std::exp(-1.0f / (k2 * largest_wave * largest_wave)) / (k2 * k2)
+		       * alignment * alignment * std::exp(-k2 * smallest_wave * smallest_wave);
+		if (alignment < 0.0f)
+			p *= 0.07f;
+		return p;
+	}
+}
+
+eda221::ocean_simulation::ocean_simulation(ocean_settings const& settings) : _settings(settings),
+	_twiddles(), _bit_reversal(), _h0(), _h0_minus_conj(), _omegas(), _grids(), _transposed()
+{
+	if (!is_power_of_two(_settings.resolution) || _settings.resolution < 2u) {
+		LogWarning("Ocean resolution %u is not a power of two; using 256", _settings.resolution);
+		_settings.resolution = 256u;
+	}
+	auto const n = _settings.resolution;
+	auto const texels_nb = static_cast<size_t>(n) * n;
+
+	_twiddles.resize(n / 2u);
+	for (unsigned int k = 0u; k < n / 2u; ++k) {
+		auto const angle = 2.0f * bonobo::pi * static_cast<float>(k) / static_cast<float>(n);
+		_twiddles[k] = complex(std::cos(angle), std::sin(angle));
+	}
+	auto bits = 0u;
+	while ((1u << bits) < n)
+		++bits;
+	_bit_reversal.resize(n);
+	for (unsigned int i = 0u; i < n; ++i) {
+		auto reversed = 0u;
+		for (auto b = 0u; b < bits; ++b)
+			reversed |= ((i >> b) & 1u) << (bits - 1u - b);
+		_bit_reversal[i] = reversed;
+	}
+
+	// The spectrum is stored with kx along the rows, so that the FFTs
+	// along z come first and the output ends up with rows along z. Wave
+	// vector (i, j) is 2 pi / patch_size * (i - n / 2, j - n / 2); the
+	// Nyquist frequencies (i or j = 0) are left out, which keeps the
+	// spectrum Hermitian and the heightfield real.
+	auto engine = std::mt19937(_settings.seed);
+	auto gaussian = std::normal_distribution<float>(0.0f, 1.0f);
+	auto const dk = 2.0f * bonobo::pi / _settings.patch_size;
+	auto const wave_vector = [n, dk](unsigned int i, unsigned int j) {
+		return dk * glm::vec2(static_cast<float>(i) - static_cast<float>(n / 2u),
+		                      static_cast<float>(j) - static_cast<float>(n / 2u));
+	};
+	_h0.assign(texels_nb, complex(0.0f, 0.0f));
+	_omegas.assign(texels_nb, 0.0f);
+	for (unsigned int i = 1u; i < n; ++i) {
+		for (unsigned int j = 1u; j < n; ++j) {
+			auto const k = wave_vector(i, j);
+			auto const xi = complex(gaussian(engine), gaussian(engine));
+			_h0[i * n + j] = xi * std::sqrt(0.5f * phillips(k, _settings));
+			_omegas[i * n + j] = std::sqrt(gravity * glm::length(k));
+		}
+	}
+	_h0_minus_conj.assign(texels_nb, complex(0.0f, 0.0f));
+	for (unsigned int i = 1u; i < n; ++i)
+		for (unsigned int j = 1u; j < n; ++j)
+			_h0_minus_conj[i * n + j] = std::conj(_h0[(n - i) * n + (n - j)]);
+
+	for (auto& grid : _grids)
+		grid.resize(texels_nb);
+	for (auto& grid : _transposed)
+		grid.resize(texels_nb);
+}
+
+void
+eda221::ocean_simulation::simulate(float time, ocean_maps& maps)
+{
+	auto const n = static_cast<size_t>(_settings.resolution);
+	auto const dk = 2.0f * bonobo::pi / _settings.patch_size;
+	auto const min_rows_per_thread = std::max<size_t>(min_texels_per_thread / n, 1u);
+
+	// The five real fields (height, x and z displacements, x and z slopes)
+	// have Hermitian spectra; pairing them as a + ib yields a and b as the
+	// real and imaginary parts of one inverse FFT:
+	//   grid 0: height + i x displacement
+	//   grid 1: z displacement + i x slope
+	//   grid 2: z slope
+	parallelFor(n, min_rows_per_thread, [&](size_t begin, size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			auto const kx = dk * (static_cast<float>(i) - static_cast<float>(n / 2u));
+			for (size_t j = 0u; j < n; ++j) {
+				auto const kz = dk * (static_cast<float>(j) - static_cast<float>(n / 2u));
+				auto const index = i * n + j;
+				auto const phase = _omegas[index] * time;
+				auto const rotation = complex(std::cos(phase), std::sin(phase));
+				auto const h = multiply(_h0[index], rotation) + multiply(_h0_minus_conj[index], std::conj(rotation));
+
+				auto const k_length = std::sqrt(kx * kx + kz * kz);
+				auto const inverse_length = k_length > 1.0e-6f ? 1.0f / k_length : 0.0f;
+				// -i k / |k| h and i k h
+				auto const minus_i_h = complex(h.imag(), -h.real());
+				auto const dx = minus_i_h * (kx * inverse_length);
+				auto const dz = minus_i_h * (kz * inverse_length);
+				auto const sx = -minus_i_h * kx;
+				auto const sz = -minus_i_h * kz;
+
+				_grids[0][index] = complex(h.real() - dx.imag(), h.imag() + dx.real());
+				_grids[1][index] = complex(dz.real() - sx.imag(), dz.imag() + sx.real());
+				_grids[2][index] = sz;
+			}
+			for (auto& grid : _grids)
+				inverse_fft(grid.data() + i * n, _twiddles, _bit_reversal);
+		}
+	});
+
+	parallelFor(n, min_rows_per_thread, [&](size_t begin, size_t end) {
+		for (size_t g = 0u; g < _grids.size(); ++g)
+			for (auto z = begin; z < end; ++z)
+				for (size_t x = 0u; x < n; ++x)
+					_transposed[g][z * n + x] = _grids[g][x * n + z];
+	});
+
+	maps.displacements.resize(n * n);
+	maps.normals.resize(n * n);
+	auto const choppiness = _settings.choppiness;
+	parallelFor(n, min_rows_per_thread, [&](size_t begin, size_t end) {
+		for (auto z = begin; z < end; ++z) {
+			for (auto& grid : _transposed)
+				inverse_fft(grid.data() + z * n, _twiddles, _bit_reversal);
+			for (size_t x = 0u; x < n; ++x) {
+				auto const index = z * n + x;
+				// The spectrum is centred on k = 0, which shifts the
+				// output by (-1)^(x + z).
+				auto const sign = ((x + z) & 1u) != 0u ? -1.0f : 1.0f;
+				auto const g0 = _transposed[0][index] * sign;
+				auto const g1 = _transposed[1][index] * sign;
+				auto const g2 = _transposed[2][index] * sign;
+				maps.displacements[index] = glm::vec4(choppiness * g0.imag(), g0.real(), choppiness * g1.real(), 0.0f);
+				maps.normals[index] = glm::vec4(glm::normalize(glm::vec3(-g1.imag(), 1.0f, -g2.real())), 0.0f);
+			}
+		}
+	});
+}
+
+eda221::ocean_surface::ocean_surface(ocean_settings const& settings) : _simulation(settings), _maps(),
+	_pending(), _pending_maps(0u), _displacement_textures(), _normal_textures(), _current(0u),
+	_last_time(0.0f), _simulation_ms(0.0)
+{
+	auto const n = static_cast<GLsizei>(_simulation.get_settings().resolution);
+	auto const create_texture = [n](GLenum internal_format) {
+		GLuint texture = 0u;
+		glGenTextures(1, &texture);
+		assert(texture != 0u);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, n, n, 0, GL_RGBA, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		return texture;
+	};
+	for (size_t i = 0u; i < 2u; ++i) {
+		_displacement_textures[i] = create_texture(GL_RGBA32F);
+		_normal_textures[i] = create_texture(GL_RGBA16F);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0u);
+}
+
+eda221::ocean_surface::~ocean_surface()
+{
+	if (_pending.valid())
+		_pending.wait();
+	glDeleteTextures(2, _displacement_textures.data());
+	glDeleteTextures(2, _normal_textures.data());
+}
+
+void
+eda221::ocean_surface::update(float time)
+{
+	if (!_pending.valid()) {
+		start_simulation(time);
+		_last_time = time;
+	}
+	_simulation_ms = _pending.get();
+
+	// The other pair of textures was last read by the previous frame.
+	auto const n = static_cast<GLsizei>(_simulation.get_settings().resolution);
+	auto const& maps = _maps[_pending_maps];
+	_current = 1u - _current;
+	glBindTexture(GL_TEXTURE_2D, _displacement_textures[_current]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, maps.displacements.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, _normal_textures[_current]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, maps.normals.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0u);
+
+	start_simulation(time + std::max(time - _last_time, 0.0f));
+	_last_time = time;
+}
+
+void
+eda221::ocean_surface::start_simulation(float time)
+{
+	// Write to the maps that were not just uploaded.
+	_pending_maps = 1u - _pending_maps;
+	auto& maps = _maps[_pending_maps];
+	_pending = std::async(std::launch::async, [this, time, &maps]() {
+		auto const start = std::chrono::high_resolution_clock::now();
+		_simulation.simulate(time, maps);
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	});
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <array>
+#include <complex>
+#include <future>
+#include <vector>
+
+//
+// Tessendorf-style ocean: a Phillips spectrum is animated in the
+// frequency domain and brought back to a tileable heightfield by inverse
+// FFTs, computed on the CPU on several threads.
+//
+// See "Simulating Ocean Water", J. Tessendorf.
+//
+
+namespace eda221
+{
+	//! \brief Parameters of an ocean.
+	struct ocean_settings {
+		unsigned int resolution; //!< samples along each side of the patch;
+		                         //!< a power of two, such as 256 or 512
+		float patch_size;        //!< world-space size of a side of the
+		                         //!< patch, which tiles the whole ocean
+		glm::vec2 wind;          //!< wind velocity, in units per second
+		float amplitude;         //!< scale of the Phillips spectrum
+		float choppiness;        //!< scale of the horizontal displacements
+		unsigned int seed;       //!< seed of the random initial spectrum
+	};
+
+	//! \brief Maps produced by an ocean simulation, in row-major order
+	//!        (rows along z), `resolution` x `resolution` texels each.
+	struct ocean_maps {
+		std::vector<glm::vec4> displacements; //!< (x offset, height, z offset, unused)
+		std::vector<glm::vec4> normals;       //!< (normal, unused)
+	};
+
+	//! \brief Evaluates an ocean patch at any time; does not use OpenGL.
+	class ocean_simulation
+	{
+	public:
+		//! \brief Generate the initial spectrum.
+		explicit ocean_simulation(ocean_settings const& settings);
+
+		//! \brief Compute the maps of the ocean at a given time.
+		//!
+		//! Runs three inverse 2D FFTs, whose rows are split across
+		//! threads. Not reentrant: scratch grids are shared by all calls.
+		//!
+		//! @param [in] time in seconds
+		//! @param [out] maps resized as needed and filled
+		void simulate(float time, ocean_maps& maps);
+
+		ocean_settings const& get_settings() const { return _settings; }
+
+	private:
+		using complex = std::complex<float>;
+
+		ocean_settings _settings;
+		std::vector<complex> _twiddles;        // exp(2 i pi k / resolution), k < resolution / 2
+		std::vector<unsigned int> _bit_reversal;
+		std::vector<complex> _h0;              // initial amplitudes, h0(k)
+		std::vector<complex> _h0_minus_conj;   // conj(h0(-k))
+		std::vector<float> _omegas;            // dispersion, sqrt(g |k|)
+		std::array<std::vector<complex>, 3> _grids;
+		std::array<std::vector<complex>, 3> _transposed;
+	};
+
+	//! \brief Runs an `ocean_simulation` on a worker thread, one frame
+	//!        ahead of rendering, and streams its maps to textures.
+	//!
+	//! While frame N is rendered from one pair of textures, the maps of
+	//! frame N+1 are computed in the background; `update()` then uploads
+	//! them to the other pair of textures, which the GPU is done reading.
+	//! Textures use GL_REPEAT, as the patch tiles, and have mipmaps.
+	class ocean_surface
+	{
+	public:
+		//! \brief Create the simulation and the textures.
+		explicit ocean_surface(ocean_settings const& settings);
+
+		//! \brief Wait for the pending simulation, and delete the textures.
+		~ocean_surface();
+
+		ocean_surface(ocean_surface const&) = delete;
+		ocean_surface& operator=(ocean_surface const&) = delete;
+
+		//! \brief Upload the maps simulated for this frame, and start
+		//!        simulating the next one.
+		//!
+		//! The next frame is assumed to come after as long as the last
+		//! one did; the first call simulates `time` synchronously.
+		//!
+		//! @param [in] time in seconds
+		void update(float time);
+
+		//! \brief Get the texture holding the displacements of the
+		//!        current frame; it changes at every `update()`.
+		GLuint get_displacement_texture() const { return _displacement_textures[_current]; }
+
+		//! \brief Get the texture holding the normals of the current
+		//!        frame; it changes at every `update()`.
+		GLuint get_normal_texture() const { return _normal_textures[_current]; }
+
+		//! \brief Get the time spent by the latest simulation, in
+		//!        milliseconds, on the worker thread.
+		double get_simulation_milliseconds() const { return _simulation_ms; }
+
+		ocean_settings const& get_settings() const { return _simulation.get_settings(); }
+
+	private:
+		void start_simulation(float time);
+
+		ocean_simulation _simulation;
+		std::array<ocean_maps, 2> _maps;
+		std::future<double> _pending;
+		size_t _pending_maps;
+		std::array<GLuint, 2> _displacement_textures;
+		std::array<GLuint, 2> _normal_textures;
+		size_t _current;
+		float _last_time;
+		double _simulation_ms;
+	};
+}
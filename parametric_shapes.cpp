@@ -1,462 +1,259 @@
 #include "parametric_shapes.hpp"
+#include "parametric_surface.hpp"
+#include "vertex_layout.hpp"
 #include "core/utils.h"
 
 #include <glm/glm.hpp>
 
-#include <array>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <iostream>
 #include <vector>
 
-eda221::mesh_data
-parametric_shapes::createQuad(unsigned int res_width, unsigned int res_height ,unsigned int width, unsigned int height)
+namespace
 {
-	auto const vertices_nb = res_width * res_height;
-
-	//! \todo Fill in the blanks
-	auto vertices = std::vector<glm::vec3>(vertices_nb);
-	auto normals = std::vector<glm::vec3>(vertices_nb);
-	auto texcoords = std::vector<glm::vec3>(vertices_nb);
-	auto tangents = std::vector<glm::vec3>(vertices_nb);
-	auto binormals = std::vector<glm::vec3>(vertices_nb);
-
-	float w = 0.0f,
-		dw = width / (static_cast<float>(res_width) - 1.0f);
-	float h = 0.0f,
-		dh = height / (static_cast<float>(res_height) - 1.0f);
-	
-	size_t index = 0u;
-	for (unsigned int i = 0; i < res_height; i++) {
-		w = 0.0f;
-		for (unsigned int j = 0; j < res_width; j++) {
-			// vertex
-			vertices[index] = glm::vec3(w,0,h);
-
-			//texture coordinates
-			texcoords[index] = glm::vec3(static_cast<float>(j) / (static_cast<float>(res_width) - 1.0f),
-				static_cast<float>(i) / (static_cast<float>(res_height) - 1.0f),
-				0.0f);
-
-			// tangent
-			auto t = glm::vec3(0.0f, 0.0f, 1.0f);
-			t = glm::normalize(t);
-			tangents[index] = t;
-
-			// binormal
-			auto b = glm::vec3(1.0f, 0.0f, 0.0f);
-			b = glm::normalize(b);
-			binormals[index] = b;
-
-			// normal
-			auto const n = glm::cross(t, b);
-			normals[index] = n;
-			
-			++index;
-			w += dw;
-		}
-		h += dh;
-
-	}
+	struct sincos {
+		float sin;
+		float cos;
+	};
 
-
-	auto indices = std::vector<glm::uvec3>(2u * (res_width - 1u) * (res_height - 1u));
-
-	index = 0u;
-	for (unsigned int i = 0u; i < res_height - 1u; ++i)
+	sincos
+	make_sincos(float angle)
 	{
-		for (unsigned int j = 0u; j < res_width - 1u; ++j)
-		{
-			indices[index] = glm::uvec3(res_width * i + j,
-				res_width * i + j + 1u,
-				res_width * i + j + 1u + res_width);
-			++index;
-
-			indices[index] = glm::uvec3(res_width * i + j,
-				res_width * i + j + res_width + 1u,
-				res_width * i + j + res_width);
-			++index;
-		}
+		return sincos{ std::sin(angle), std::cos(angle) };
 	}
 
-
-	eda221::mesh_data data;
-
-	//
-	// NOTE:
+	// Quad in the y = 0 plane, with u along x and v along z. Its tangent
+	// follows v and its binormal u, so that the normal points up.
 	//
-	// Only the values preceeded by a `\todo` tag should be changed, the
-	// other ones are correct!
-	//
-
-	// Create a Vertex Array Object: it will remember where we stored the
-	// data on the GPU, and  which part corresponds to the vertices, which
-	// one for the normals, etc.
-	//
-	// The following function will create new Vertex Arrays, and pass their
-	// name in the given array (second argument). Since we only need one,
-	// pass a pointer to `data.vao`.
-	glGenVertexArrays(1, &data.vao);
-	assert(data.vao != 0u);
-	// To be able to store information, the Vertex Array has to be bound
-	// first.
-	glBindVertexArray(data.vao);
-
-	// To store the data, we need to allocate buffers on the GPU. Let's
-	// allocate a first one for the vertices.
-	//
-	// The following function's syntax is similar to `glGenVertexArray()`:
-	// it will create multiple OpenGL objects, in this case buffers, and
-	// return their names in an array. Have the buffer's name stored into
-	// `data.bo`.
-	glGenBuffers(1, &data.bo);
-	assert(data.bo != 0u);
-	// Similar to the Vertex Array, we need to bind it first before storing
-	// anything in it. The data stored in it can be interpreted in
-	// different ways. Here, we will say that it is just a simple 1D-array
-	// and therefore bind the buffer to the corresponding target.
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-
-	auto const vertices_offset = 0u;
-	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	auto const normals_offset = vertices_size;
-	auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-	auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		+ normals_size
-		+ texcoords_size
-		+ tangents_size
-		+ binormals_size
-		);
-
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-	data.indices_nb = indices.size() * 3u;
-	glGenBuffers(1, &data.ibo);
-	assert(data.ibo != 0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-	glBindVertexArray(0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-
-	return data;
-}
-
-eda221::mesh_data
-parametric_shapes::createSphere(unsigned int const res_theta,
-	unsigned int const res_phi, float const radius)
-{
-	//! \todo Implement this function
-	auto const vertices_nb = res_phi * res_theta;
-
-	auto vertices = std::vector<glm::vec3>(vertices_nb);
-	auto normals = std::vector<glm::vec3>(vertices_nb);
-	auto texcoords = std::vector<glm::vec3>(vertices_nb);
-	auto tangents = std::vector<glm::vec3>(vertices_nb);
-	auto binormals = std::vector<glm::vec3>(vertices_nb);
-
-	float theta = 0.0f,
-		dtheta = 2.0f*bonobo::pi / (static_cast<float>(res_theta) - 1.0f);
-	float phi = 0.0f,
-		dphi = bonobo::pi / (static_cast<float>(res_phi) - 1.0f);
-
-	// generate vertices iteratively
-	size_t index = 0u;
-	for (unsigned int i = 0u; i < res_theta; ++i) {
-		float cos_theta = std::cos(theta),
-			sin_theta = std::sin(theta);
-
-		phi = 0.0f;
-
-		for (unsigned int j = 0u; j < res_phi; ++j) {
-			// vertex
-			float cos_phi = std::cos(phi),
-				sin_phi = std::sin(phi);
-			vertices[index] = glm::vec3(radius * sin_theta*sin_phi,
-				-radius*cos(phi),
-				radius*cos_theta*sin_phi);
-
-			//texture coordinates
-			texcoords[index] = glm::vec3(static_cast<float>(i) / (static_cast<float>(res_theta) - 1.0f), static_cast<float>(j) / (static_cast<float>(res_phi) - 1.0f),
-				0.0f);
-
-			// tangent
-			auto t = glm::vec3(radius*cos_theta*(sin_phi + 0.01f), 0.0f, -radius*sin_theta*(sin_phi + 0.01f));
-			t = glm::normalize(t);
-			tangents[index] = t;
-
-			// binormal
-			auto b = glm::vec3(radius*sin_theta*cos_phi, radius*sin_phi, radius*cos_theta*cos_phi);
-			b = glm::normalize(b);
-			binormals[index] = b;
-
-			// normal
-			auto const n = glm::cross(t, b);
-			normals[index] = n;
-
-			phi += dphi;
-			++index;
+	// All shapes provide their frame analytically; the finite differences
+	// of `parametric_shapes::generateSurface()` are for new surfaces.
+	struct quad_surface {
+		static constexpr bool rows_along_u = false;
+		float width;
+		float height;
+
+		parametric_shapes::surface_domain domain() const { return { 0.0f, width, 0.0f, height }; }
+		glm::vec3 position(float u, float v) const { return glm::vec3(u, 0.0f, v); }
+		glm::vec3 tangent(float, float) const { return glm::vec3(0.0f, 0.0f, 1.0f); }
+		glm::vec3 binormal(float, float) const { return glm::vec3(1.0f, 0.0f, 0.0f); }
+		glm::vec3 normal(float, float) const { return glm::vec3(0.0f, 1.0f, 0.0f); }
+	};
+
+	// Sphere with u = theta around the y axis, and v = phi going from the
+	// bottom pole to the top one.
+	struct sphere_surface {
+		static constexpr bool rows_along_u = true;
+		float radius;
+
+		parametric_shapes::surface_domain domain() const { return { 0.0f, 2.0f * bonobo::pi, 0.0f, bonobo::pi }; }
+		sincos prepare_u(float theta) const { return make_sincos(theta); }
+		sincos prepare_v(float phi) const { return make_sincos(phi); }
+		glm::vec3 position(sincos theta, sincos phi) const
+		{
+			return radius * glm::vec3(theta.sin * phi.sin, -phi.cos, theta.cos * phi.sin);
 		}
-
-		theta += dtheta;
-	}
-
-	// create index array
-	auto indices = std::vector<glm::uvec3>(2u * (res_theta - 1u) * (res_phi - 1u));
-
-	// generate indices iteratively
-	index = 0u;
-	for (unsigned int i = 0u; i < res_theta - 1u; ++i)
-	{
-		for (unsigned int j = 0u; j < res_phi - 1u; ++j)
+		// The derivative along theta vanishes at the poles; its direction
+		// does not.
+		glm::vec3 tangent(sincos theta, sincos) const { return glm::vec3(theta.cos, 0.0f, -theta.sin); }
+		glm::vec3 binormal(sincos theta, sincos phi) const
 		{
-			indices[index] = glm::uvec3(res_phi * i + j,
-				res_phi * i + j + 1u,
-				res_phi * i + j + 1u + res_phi);
-			++index;
-
-			indices[index] = glm::uvec3(res_phi * i + j,
-				res_phi * i + j + res_phi + 1u,
-				res_phi * i + j + res_phi);
-			++index;
+			return glm::vec3(theta.sin * phi.cos, phi.sin, theta.cos * phi.cos);
 		}
-	}
-
-	eda221::mesh_data data;
-	glGenVertexArrays(1, &data.vao);
-	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
-
-	auto const vertices_offset = 0u;
-	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	auto const normals_offset = vertices_size;
-	auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-	auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		+ normals_size
-		+ texcoords_size
-		+ tangents_size
-		+ binormals_size
-		);
-	glGenBuffers(1, &data.bo);
-	assert(data.bo != 0u);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
+		glm::vec3 normal(sincos theta, sincos phi) const
+		{
+			return glm::vec3(theta.sin * phi.sin, -phi.cos, theta.cos * phi.sin);
+		}
+	};
+
+	// Torus around the y axis, with u = theta going around the tube and
+	// v = phi around the axis.
+	struct torus_surface {
+		static constexpr bool rows_along_u = true;
+		float major_radius;
+		float minor_radius;
+
+		parametric_shapes::surface_domain domain() const { return { 0.0f, 2.0f * bonobo::pi, 0.0f, 2.0f * bonobo::pi }; }
+		sincos prepare_u(float theta) const { return make_sincos(theta); }
+		sincos prepare_v(float phi) const { return make_sincos(phi); }
+		glm::vec3 position(sincos theta, sincos phi) const
+		{
+			auto const distance = major_radius + minor_radius * theta.cos;
+			return glm::vec3(distance * phi.sin, -minor_radius * theta.sin, distance * phi.cos);
+		}
+		glm::vec3 tangent(sincos theta, sincos phi) const
+		{
+			return glm::vec3(-theta.sin * phi.sin, -theta.cos, -theta.sin * phi.cos);
+		}
+		glm::vec3 binormal(sincos, sincos phi) const { return glm::vec3(phi.cos, 0.0f, -phi.sin); }
+		glm::vec3 normal(sincos theta, sincos phi) const
+		{
+			return glm::vec3(theta.cos * phi.sin, -theta.sin, theta.cos * phi.cos);
+		}
+	};
 
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
+	// Ring in the z = 0 plane, with u = radius and v = theta.
+	struct circle_ring_surface {
+		static constexpr bool rows_along_u = false;
+		float inner_radius;
+		float outer_radius;
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		parametric_shapes::surface_domain domain() const { return { inner_radius, outer_radius, 0.0f, 2.0f * bonobo::pi }; }
+		sincos prepare_v(float theta) const { return make_sincos(theta); }
+		glm::vec3 position(float radius, sincos theta) const
+		{
+			return glm::vec3(radius * theta.cos, radius * theta.sin, 0.0f);
+		}
+		glm::vec3 tangent(float, sincos theta) const { return glm::vec3(theta.cos, theta.sin, 0.0f); }
+		glm::vec3 binormal(float, sincos theta) const { return glm::vec3(-theta.sin, theta.cos, 0.0f); }
+		glm::vec3 normal(float, sincos) const { return glm::vec3(0.0f, 0.0f, 1.0f); }
+	};
+}
 
-	data.indices_nb = indices.size() * 3u;
-	glGenBuffers(1, &data.ibo);
-	assert(data.ibo != 0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
+std::vector<glm::uvec3>
+parametric_shapes::generateGridIndices(unsigned int rows_nb, unsigned int columns_nb)
+{
+	auto indices = std::vector<glm::uvec3>(2u * (rows_nb - 1u) * (columns_nb - 1u));
+	auto const min_rows_per_thread = std::max<size_t>(detail::min_vertices_per_thread / columns_nb, 1u);
+	eda221::parallelFor(rows_nb - 1u, min_rows_per_thread, [&indices, columns_nb](size_t begin, size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			auto cell_indices = indices.data() + 2u * i * (columns_nb - 1u);
+			auto const row = static_cast<unsigned int>(i) * columns_nb;
+			for (unsigned int j = 0u; j < columns_nb - 1u; ++j) {
+				cell_indices[2u * j]      = glm::uvec3(row + j, row + j + 1u, row + j + 1u + columns_nb);
+				cell_indices[2u * j + 1u] = glm::uvec3(row + j, row + j + columns_nb + 1u, row + j + columns_nb);
+			}
+		}
+	});
+	return indices;
+}
 
-	glBindVertexArray(0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+parametric_shapes::shape_data
+parametric_shapes::generateQuad(unsigned int res_width, unsigned int res_height, unsigned int width, unsigned int height)
+{
+	return generateSurface(quad_surface{ static_cast<float>(width), static_cast<float>(height) }, res_width, res_height);
+}
 
-	return data;
+parametric_shapes::shape_data
+parametric_shapes::generateSphere(unsigned int const res_theta,
+	unsigned int const res_phi, float const radius)
+{
+	return generateSurface(sphere_surface{ radius }, res_theta, res_phi);
 }
 
-eda221::mesh_data
-parametric_shapes::createTorus(unsigned int const res_theta,
+parametric_shapes::shape_data
+parametric_shapes::generateTorus(unsigned int const res_theta,
 	unsigned int const res_phi, float const rA,
 	float const rB)
 {
-	//! \todo (Optional) Implement this function
-	return eda221::mesh_data{ 0u, 0u, 0u, 0u };
+	return generateSurface(torus_surface{ 0.5f * (rA + rB), 0.5f * (rB - rA) }, res_theta, res_phi);
 }
 
-eda221::mesh_data
-parametric_shapes::createCircleRing(unsigned int const res_radius,
+parametric_shapes::shape_data
+parametric_shapes::generateCircleRing(unsigned int const res_radius,
 	unsigned int const res_theta,
 	float const inner_radius,
 	float const outer_radius)
 {
-	auto const vertices_nb = res_radius * res_theta;
-
-	auto vertices = std::vector<glm::vec3>(vertices_nb);
-	auto normals = std::vector<glm::vec3>(vertices_nb);
-	auto texcoords = std::vector<glm::vec3>(vertices_nb);
-	auto tangents = std::vector<glm::vec3>(vertices_nb);
-	auto binormals = std::vector<glm::vec3>(vertices_nb);
-
-	float theta = 0.0f,                                                        // 'stepping'-variable for theta: will go 0 - 2PI
-		dtheta = 2.0f * bonobo::pi / (static_cast<float>(res_theta) - 1.0f); // step size, depending on the resolution
-
-	float radius = 0.0f,                                                                     // 'stepping'-variable for radius: will go inner_radius - outer_radius
-		dradius = (outer_radius - inner_radius) / (static_cast<float>(res_radius) - 1.0f); // step size, depending on the resolution
-
-																						   // generate vertices iteratively
-	size_t index = 0u;
-	for (unsigned int i = 0u; i < res_theta; ++i) {
-		float cos_theta = std::cos(theta),
-			sin_theta = std::sin(theta);
-
-		radius = inner_radius;
-
-		for (unsigned int j = 0u; j < res_radius; ++j) {
-			// vertex
-			vertices[index] = glm::vec3(radius * cos_theta,
-				radius * sin_theta,
-				0.0f);
-
-			// texture coordinates
-			texcoords[index] = glm::vec3(static_cast<float>(j) / (static_cast<float>(res_radius) - 1.0f),
-				static_cast<float>(i) / (static_cast<float>(res_theta) - 1.0f),
-				0.0f);
-
-			// tangent
-			auto t = glm::vec3(cos_theta, sin_theta, 0.0f);
-			t = glm::normalize(t);
-			tangents[index] = t;
-
-			// binormal
-			auto b = glm::vec3(-sin_theta, cos_theta, 0.0f);
-			b = glm::normalize(b);
-			binormals[index] = b;
+	return generateSurface(circle_ring_surface{ inner_radius, outer_radius }, res_radius, res_theta);
+}
 
-			// normal
-			auto const n = glm::cross(t, b);
-			normals[index] = n;
+eda221::packed_mesh
+parametric_shapes::packShape(shape_data const& shape)
+{
+	return eda221::packMesh(eda221::getDefaultVertexLayout(), shape.vertices.size(),
+	                        shape.vertices.data(), shape.normals.data(), shape.texcoords.data(),
+	                        shape.tangents.data(), shape.binormals.data(),
+	                        reinterpret_cast<GLuint const*>(shape.indices.data()), shape.indices.size() * 3u);
+}
 
-			radius += dradius;
-			++index;
-		}
+eda221::mesh_data
+parametric_shapes::uploadShape(shape_data const& shape)
+{
+	return eda221::uploadMeshData(packShape(shape));
+}
 
-		theta += dtheta;
-	}
+eda221::mesh_data
+parametric_shapes::createQuad(unsigned int res_width, unsigned int res_height, unsigned int width, unsigned int height)
+{
+	return uploadShape(generateQuad(res_width, res_height, width, height));
+}
 
-	// create index array
-	auto indices = std::vector<glm::uvec3>(2u * (res_theta - 1u) * (res_radius - 1u));
+eda221::mesh_data
+parametric_shapes::createSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius)
+{
+	return uploadShape(generateSphere(res_theta, res_phi, radius));
+}
 
-	// generate indices iteratively
-	index = 0u;
-	for (unsigned int i = 0u; i < res_theta - 1u; ++i)
-	{
-		for (unsigned int j = 0u; j < res_radius - 1u; ++j)
-		{
-			indices[index] = glm::uvec3(res_radius * i + j,
-				res_radius * i + j + 1u,
-				res_radius * i + j + 1u + res_radius);
-			++index;
+eda221::mesh_data
+parametric_shapes::createTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB)
+{
+	return uploadShape(generateTorus(res_theta, res_phi, rA, rB));
+}
 
-			indices[index] = glm::uvec3(res_radius * i + j,
-				res_radius * i + j + res_radius + 1u,
-				res_radius * i + j + res_radius);
-			++index;
-		}
-	}
+eda221::mesh_data
+parametric_shapes::createCircleRing(unsigned int const res_radius, unsigned int const res_theta,
+                                    float const inner_radius, float const outer_radius)
+{
+	return uploadShape(generateCircleRing(res_radius, res_theta, inner_radius, outer_radius));
+}
 
+eda221::mesh_data
+parametric_shapes::createProceduralGrid(unsigned int res_width, unsigned int res_height)
+{
+	// The core profile needs a Vertex Array Object to draw, even without
+	// any attribute.
 	eda221::mesh_data data;
+	data.vao = 0u;
 	glGenVertexArrays(1, &data.vao);
 	assert(data.vao != 0u);
-	glBindVertexArray(data.vao);
-
-	auto const vertices_offset = 0u;
-	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	auto const normals_offset = vertices_size;
-	auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-	auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		+ normals_size
-		+ texcoords_size
-		+ tangents_size
-		+ binormals_size
-		);
-	glGenBuffers(1, &data.bo);
-	assert(data.bo != 0u);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(eda221::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(eda221::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
+	data.bo = 0u;
+	data.ibo = 0u;
+	data.indices_nb = getProceduralGridVerticesNb(res_width, res_height);
+	data.indices_type = GL_NONE;
+	data.mode = GL_TRIANGLE_STRIP;
+	return data;
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+size_t
+parametric_shapes::getProceduralGridVerticesNb(unsigned int res_width, unsigned int res_height)
+{
+	if (res_width < 2u || res_height < 2u)
+		return 0u;
+	// Each row of cells takes two vertices per column, plus two to jump
+	// to the next row.
+	auto const row_vertices_nb = 2u * static_cast<size_t>(res_width) + 2u;
+	return (res_height - 1u) * row_vertices_nb - 2u;
+}
 
-	data.indices_nb = indices.size() * 3u;
-	glGenBuffers(1, &data.ibo);
-	assert(data.ibo != 0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
+eda221::mesh_data
+parametric_shapes::createClipmap(clipmap_layout const& layout)
+{
+	// Same empty VAO and strip as a grid, only the vertices count differs.
+	auto data = createProceduralGrid(2u, 2u);
+	data.indices_nb = getClipmapVerticesNb(layout);
+	return data;
+}
 
-	glBindVertexArray(0u);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+size_t
+parametric_shapes::getClipmapVerticesNb(clipmap_layout const& layout)
+{
+	if (layout.ring_width == 0u || layout.levels_nb == 0u)
+		return 0u;
+	// Each block (the finest grid, then 4 tiles per coarser level) also
+	// has two vertices to jump to the next one, except for the last.
+	auto const m = static_cast<size_t>(layout.ring_width);
+	auto const finest_vertices_nb = getProceduralGridVerticesNb(4u * layout.ring_width + 1u, 4u * layout.ring_width + 1u) + 2u;
+	auto const tile_vertices_nb = getProceduralGridVerticesNb(3u * layout.ring_width + 1u, layout.ring_width + 1u) + 2u;
+	assert(finest_vertices_nb == 4u * m * (8u * m + 4u));
+	assert(tile_vertices_nb == m * (6u * m + 4u));
+	(void)m; // only read by the asserts
+	return finest_vertices_nb + 4u * (layout.levels_nb - 1u) * tile_vertices_nb - 2u;
+}
 
-	return data;
+glm::vec2
+parametric_shapes::getClipmapCenter(clipmap_layout const& layout, glm::vec2 const& viewer)
+{
+	auto const coarsest_cell_size = layout.cell_size * static_cast<float>(1u << (layout.levels_nb - 1u));
+	return glm::floor(viewer / coarsest_cell_size + 0.5f) * coarsest_cell_size;
 }
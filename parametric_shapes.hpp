@@ -1,11 +1,57 @@
 #pragma once
 
 #include "helpers.hpp"
+#include "vertex_layout.hpp"
+
+#include <glm/glm.hpp>
 
 #include <cstdint>
+#include <vector>
 
 namespace parametric_shapes
 {
+	//! \brief Geometry of a shape, as generated on the CPU and not yet
+	//!        packed nor uploaded.
+	struct shape_data {
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec3> texcoords;
+		std::vector<glm::vec3> tangents;
+		std::vector<glm::vec3> binormals;
+		std::vector<glm::uvec3> indices;
+	};
+
+	//! \brief Generate the geometry of a quad; see `createQuad()`.
+	//!
+	//! This does not use OpenGL.
+	shape_data generateQuad(unsigned int res_width, unsigned int res_height, unsigned int width, unsigned int height);
+
+	//! \brief Generate the geometry of a sphere; see `createSphere()`.
+	//!
+	//! This does not use OpenGL.
+	shape_data generateSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius);
+
+	//! \brief Generate the geometry of a torus; see `createTorus()`.
+	//!
+	//! This does not use OpenGL.
+	shape_data generateTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB);
+
+	//! \brief Generate the geometry of a circle ring; see
+	//!        `createCircleRing()`.
+	//!
+	//! This does not use OpenGL.
+	shape_data generateCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius);
+
+	//! \brief Pack a generated shape with the default vertex layout, see
+	//!        `eda221::packMesh()`; this does not use OpenGL.
+	eda221::packed_mesh packShape(shape_data const& shape);
+
+	//! \brief Pack a generated shape and make it available to OpenGL.
+	//!
+	//! @return wrapper around OpenGL objects' name containing the geometry
+	//!         data
+	eda221::mesh_data uploadShape(shape_data const& shape);
+
 	//! \brief Create a quad consisting of two triangles and make it
 	//!        available to OpenGL.
 	//!
@@ -46,4 +92,72 @@ namespace parametric_shapes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	eda221::mesh_data createCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius);
+
+	//! \brief Create a grid whose vertices are computed by the vertex
+	//!        shader, without any vertex nor index buffer.
+	//!
+	//! The grid is drawn as a single triangle strip, row after row,
+	//! consecutive rows being joined by two degenerate triangles. The
+	//! vertex shader derives the position and texture coordinates of
+	//! each vertex from `gl_VertexID`, given the resolution of the grid
+	//! (see `strip_grid_vertex()` in `water.vert`). The resolution can thus be changed at any time
+	//! by updating that shader input along with the number of vertices
+	//! drawn, see `getProceduralGridVerticesNb()`.
+	//!
+	//! @param res_width number of vertices along the x axis
+	//! @param res_height number of vertices along the z axis
+	//! @return wrapper around an empty Vertex Array Object, drawing
+	//!         `indices_nb` vertices without indices
+	eda221::mesh_data createProceduralGrid(unsigned int res_width, unsigned int res_height);
+
+	//! \brief Get the number of vertices to draw for a grid created by
+	//!        `createProceduralGrid()`.
+	//!
+	//! @param res_width number of vertices along the x axis
+	//! @param res_height number of vertices along the z axis
+	//! @return the number of vertices of the triangle strip
+	size_t getProceduralGridVerticesNb(unsigned int res_width, unsigned int res_height);
+
+	//! \brief Levels of detail of a geometry clipmap.
+	struct clipmap_layout {
+		unsigned int ring_width; //!< width of each ring, in cells; the
+		                         //!<   finest level is a grid of
+		                         //!<   4 x `ring_width` cells per side
+		unsigned int levels_nb;  //!< number of levels, the finest included
+		float cell_size;         //!< size of the cells of the finest level;
+		                         //!<   each level doubles it
+	};
+
+	//! \brief Create a geometry clipmap whose vertices are computed by the
+	//!        vertex shader, without any vertex nor index buffer.
+	//!
+	//! The finest level is a square grid centered on the viewer. Each
+	//! coarser level is a ring around the previous one, with cells twice
+	//! as large, made of four 3m x m cells tiles (m being the ring width).
+	//! All levels are drawn as a single triangle strip, as for
+	//! `createProceduralGrid()`, the vertex shader deriving the level,
+	//! tile and position of each vertex from `gl_VertexID`; it also
+	//! stitches the outer edge of each level to the next one (see
+	//! `clipmap_vertex()` in `water.vert`).
+	//!
+	//! @param layout the levels of the clipmap
+	//! @return wrapper around an empty Vertex Array Object, drawing
+	//!         `indices_nb` vertices without indices
+	eda221::mesh_data createClipmap(clipmap_layout const& layout);
+
+	//! \brief Get the number of vertices to draw for a clipmap created by
+	//!        `createClipmap()`.
+	size_t getClipmapVerticesNb(clipmap_layout const& layout);
+
+	//! \brief Get where to center a clipmap so that it follows a viewer.
+	//!
+	//! The center is snapped to the cells of the coarsest level, so that
+	//! the vertices of all levels keep the same positions as the viewer
+	//! moves, rather than swimming.
+	//!
+	//! @param layout the levels of the clipmap
+	//! @param viewer position of the viewer, projected on the clipmap
+	//!        plane
+	//! @return the center of the clipmap, in the same space as `viewer`
+	glm::vec2 getClipmapCenter(clipmap_layout const& layout, glm::vec2 const& viewer);
 }
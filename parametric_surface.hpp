@@ -0,0 +1,206 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "parametric_shapes.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace parametric_shapes
+{
+	//! \brief Range of the parameters `u` and `v` of a surface.
+	struct surface_domain {
+		float u_min;
+		float u_max;
+		float v_min;
+		float v_max;
+	};
+
+	//! \brief Generate the triangle indices of a grid of `rows_nb` rows of
+	//!        `columns_nb` vertices each, with two triangles per cell.
+	std::vector<glm::uvec3> generateGridIndices(unsigned int rows_nb, unsigned int columns_nb);
+
+	//! \brief Generate the geometry of a parametric surface, sampled on a
+	//!        regular grid of its domain.
+	//!
+	//! `Surface` describes the surface with:
+	//!
+	//!   - `static constexpr bool rows_along_u`: whether vertices sharing
+	//!     the same `u` are stored contiguously;
+	//!   - `surface_domain domain() const`;
+	//!   - `glm::vec3 position(U u, V v) const`.
+	//!
+	//! and, optionally:
+	//!
+	//!   - `U prepare_u(float u) const` and `V prepare_v(float v) const`,
+	//!     evaluating what only depends on `u` (resp. `v`), such as its
+	//!     sine and cosine, once per grid line rather than per vertex; `U`
+	//!     and `V` default to `float`, the parameter itself;
+	//!   - `glm::vec3 tangent(U u, V v) const` and
+	//!     `glm::vec3 binormal(U u, V v) const`, returning unit vectors;
+	//!     they default to the normalised finite differences of `position`
+	//!     along `u` and `v` respectively;
+	//!   - `glm::vec3 normal(U u, V v) const`, returning a unit vector; it
+	//!     defaults to the normalised cross product of the tangent and
+	//!     binormal.
+	//!
+	//! Texture coordinates go from 0 to 1 along `u` and `v`. Large grids
+	//! are generated on several threads.
+	//!
+	//! @param [in] surface the surface to sample
+	//! @param [in] res_u number of vertices along `u`
+	//! @param [in] res_v number of vertices along `v`
+	//! @return the generated geometry
+	template<typename Surface>
+	shape_data generateSurface(Surface const& surface, unsigned int res_u, unsigned int res_v);
+
+	//! \brief Generate a parametric surface and make it available to
+	//!        OpenGL; see `generateSurface()`.
+	template<typename Surface>
+	eda221::mesh_data createSurface(Surface const& surface, unsigned int res_u, unsigned int res_v)
+	{
+		return uploadShape(generateSurface(surface, res_u, res_v));
+	}
+
+	namespace detail
+	{
+		// Rows are split across threads once a shape has that many vertices
+		// per thread; below that, starting threads costs more than it saves.
+		size_t const min_vertices_per_thread = 16384u;
+
+		// Overload ranks: the `preferred` overload is picked when it is
+		// well-formed, that is when the surface provides the member.
+		struct fallback {};
+		struct preferred : fallback {};
+
+		template<typename Surface>
+		auto prepare_u(Surface const& surface, float u, preferred) -> decltype(surface.prepare_u(u))
+		{
+			return surface.prepare_u(u);
+		}
+
+		template<typename Surface>
+		float prepare_u(Surface const&, float u, fallback)
+		{
+			return u;
+		}
+
+		template<typename Surface>
+		auto prepare_v(Surface const& surface, float v, preferred) -> decltype(surface.prepare_v(v))
+		{
+			return surface.prepare_v(v);
+		}
+
+		template<typename Surface>
+		float prepare_v(Surface const&, float v, fallback)
+		{
+			return v;
+		}
+
+		// The `float` parameters, and the domain, are only used by the
+		// finite differences; likewise, the tangent and binormal are only
+		// used by the default normal.
+		template<typename Surface, typename U, typename V>
+		auto tangent(Surface const& surface, U const& pu, V const& pv, float, surface_domain const&, preferred)
+			-> decltype(surface.tangent(pu, pv))
+		{
+			return surface.tangent(pu, pv);
+		}
+
+		template<typename Surface, typename U, typename V>
+		glm::vec3 tangent(Surface const& surface, U const&, V const& pv, float u, surface_domain const& domain, fallback)
+		{
+			auto const h = 1.0e-3f * (domain.u_max - domain.u_min);
+			return glm::normalize(surface.position(prepare_u(surface, std::min(u + h, domain.u_max), preferred()), pv)
+			                    - surface.position(prepare_u(surface, std::max(u - h, domain.u_min), preferred()), pv));
+		}
+
+		template<typename Surface, typename U, typename V>
+		auto binormal(Surface const& surface, U const& pu, V const& pv, float, surface_domain const&, preferred)
+			-> decltype(surface.binormal(pu, pv))
+		{
+			return surface.binormal(pu, pv);
+		}
+
+		template<typename Surface, typename U, typename V>
+		glm::vec3 binormal(Surface const& surface, U const& pu, V const&, float v, surface_domain const& domain, fallback)
+		{
+			auto const h = 1.0e-3f * (domain.v_max - domain.v_min);
+			return glm::normalize(surface.position(pu, prepare_v(surface, std::min(v + h, domain.v_max), preferred()))
+			                    - surface.position(pu, prepare_v(surface, std::max(v - h, domain.v_min), preferred())));
+		}
+
+		template<typename Surface, typename U, typename V>
+		auto normal(Surface const& surface, U const& pu, V const& pv, glm::vec3 const&, glm::vec3 const&, preferred)
+			-> decltype(surface.normal(pu, pv))
+		{
+			return surface.normal(pu, pv);
+		}
+
+		template<typename Surface, typename U, typename V>
+		glm::vec3 normal(Surface const&, U const&, V const&, glm::vec3 const& t, glm::vec3 const& b, fallback)
+		{
+			return glm::normalize(glm::cross(t, b));
+		}
+	}
+}
+
+template<typename Surface>
+parametric_shapes::shape_data
+parametric_shapes::generateSurface(Surface const& surface, unsigned int res_u, unsigned int res_v)
+{
+	auto const domain = surface.domain();
+	auto const du = (domain.u_max - domain.u_min) / (static_cast<float>(res_u) - 1.0f);
+	auto const dv = (domain.v_max - domain.v_min) / (static_cast<float>(res_v) - 1.0f);
+	auto const dtexcoord_u = 1.0f / (static_cast<float>(res_u) - 1.0f);
+	auto const dtexcoord_v = 1.0f / (static_cast<float>(res_v) - 1.0f);
+
+	using u_type = decltype(detail::prepare_u(surface, 0.0f, detail::preferred()));
+	using v_type = decltype(detail::prepare_v(surface, 0.0f, detail::preferred()));
+	auto us = std::vector<u_type>();
+	us.reserve(res_u);
+	for (unsigned int i = 0u; i < res_u; ++i)
+		us.push_back(detail::prepare_u(surface, domain.u_min + static_cast<float>(i) * du, detail::preferred()));
+	auto vs = std::vector<v_type>();
+	vs.reserve(res_v);
+	for (unsigned int j = 0u; j < res_v; ++j)
+		vs.push_back(detail::prepare_v(surface, domain.v_min + static_cast<float>(j) * dv, detail::preferred()));
+
+	auto const rows_nb = Surface::rows_along_u ? res_u : res_v;
+	auto const columns_nb = Surface::rows_along_u ? res_v : res_u;
+	auto const vertices_nb = static_cast<size_t>(rows_nb) * columns_nb;
+	auto shape = shape_data();
+	shape.vertices.resize(vertices_nb);
+	shape.normals.resize(vertices_nb);
+	shape.texcoords.resize(vertices_nb);
+	shape.tangents.resize(vertices_nb);
+	shape.binormals.resize(vertices_nb);
+
+	auto const min_rows_per_thread = std::max<size_t>(detail::min_vertices_per_thread / columns_nb, 1u);
+	eda221::parallelFor(rows_nb, min_rows_per_thread, [&](size_t begin, size_t end) {
+		for (auto row = begin; row < end; ++row) {
+			for (unsigned int column = 0u; column < columns_nb; ++column) {
+				auto const i = Surface::rows_along_u ? row : column;
+				auto const j = Surface::rows_along_u ? column : row;
+				auto const u = domain.u_min + static_cast<float>(i) * du;
+				auto const v = domain.v_min + static_cast<float>(j) * dv;
+				auto const t = detail::tangent(surface, us[i], vs[j], u, domain, detail::preferred());
+				auto const b = detail::binormal(surface, us[i], vs[j], v, domain, detail::preferred());
+
+				auto const index = row * columns_nb + column;
+				shape.vertices[index] = surface.position(us[i], vs[j]);
+				shape.texcoords[index] = glm::vec3(static_cast<float>(i) * dtexcoord_u,
+				                                   static_cast<float>(j) * dtexcoord_v, 0.0f);
+				shape.tangents[index] = t;
+				shape.binormals[index] = b;
+				shape.normals[index] = detail::normal(surface, us[i], vs[j], t, b, detail::preferred());
+			}
+		}
+	});
+
+	shape.indices = generateGridIndices(rows_nb, columns_nb);
+	return shape;
+}
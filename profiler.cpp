@@ -0,0 +1,322 @@
+#include "profiler.hpp"
+
+#include "core/Log.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+	// Queries generated at once, when a frame needs more.
+	size_t const queries_batch_size = 32u;
+
+	// File written by the export button of the profiler window.
+	char const* const trace_path = "profile_trace.json";
+
+	struct statistics {
+		float min;
+		float average;
+		float p99;
+	};
+
+	statistics
+	compute_statistics(float const* samples, size_t samples_nb)
+	{
+		if (samples_nb == 0u)
+			return { 0.0f, 0.0f, 0.0f };
+
+		auto sorted = std::vector<float>(samples, samples + samples_nb);
+		std::sort(sorted.begin(), sorted.end());
+		float sum = 0.0f;
+		for (auto const sample : sorted)
+			sum += sample;
+		auto const p99_index = static_cast<size_t>(std::ceil(0.99f * static_cast<float>(samples_nb))) - 1u;
+		return { sorted.front(), sum / static_cast<float>(samples_nb), sorted[p99_index] };
+	}
+
+	ImU32
+	get_scope_colour(char const* name)
+	{
+		// Same name, same colour, from one frame to the next.
+		unsigned int hash = 2166136261u;
+		for (auto c = name; *c != '\0'; ++c)
+			hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+		float r, g, b;
+		ImGui::ColorConvertHSVtoRGB(static_cast<float>(hash % 360u) / 360.0f, 0.5f, 0.7f, r, g, b);
+		return ImGui::ColorConvertFloat4ToU32(ImVec4(r, g, b, 1.0f));
+	}
+
+	void
+	write_json_string(std::ostream& stream, char const* text)
+	{
+		stream << '"';
+		for (auto c = text; *c != '\0'; ++c) {
+			if (*c == '"' || *c == '\\')
+				stream << '\\';
+			stream << *c;
+		}
+		stream << '"';
+	}
+
+	float
+	to_milliseconds(std::int64_t nanoseconds)
+	{
+		return static_cast<float>(static_cast<double>(nanoseconds) / 1.0e6);
+	}
+}
+
+eda221::profiler::profiler() : _epoch(clock::now()), _gpu_to_cpu(0), _frames(), _frame(0u), _is_in_frame(false),
+	_open_scopes(), _completed(), _histories(), _dropped_frames_nb(0u)
+{
+	for (auto& frame : _frames)
+		frame.is_pending = false;
+
+	// Both clocks are in nanoseconds: only their origins differ.
+	GLint64 gpu_now = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+	_gpu_to_cpu = now() - static_cast<std::int64_t>(gpu_now);
+}
+
+eda221::profiler::~profiler()
+{
+	for (auto& frame : _frames)
+		if (!frame.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+}
+
+void
+eda221::profiler::begin_frame()
+{
+	if (_is_in_frame)
+		end_frame();
+
+	auto& frame = _frames[_frame];
+	if (frame.is_pending)
+		collect(frame);
+	frame.scopes.clear();
+
+	_is_in_frame = true;
+	begin_scope("frame");
+}
+
+void
+eda221::profiler::end_frame()
+{
+	if (!_is_in_frame)
+		return;
+
+	if (_open_scopes.size() > 1u)
+		LogWarning("%u profiler scopes were left open", static_cast<unsigned int>(_open_scopes.size() - 1u));
+	while (!_open_scopes.empty())
+		end_scope();
+
+	_frames[_frame].is_pending = true;
+	_frame = (_frame + 1u) % frames_nb;
+	_is_in_frame = false;
+}
+
+void
+eda221::profiler::begin_scope(char const* name)
+{
+	if (!_is_in_frame)
+		return;
+
+	auto& frame = _frames[_frame];
+	auto const index = frame.scopes.size();
+	if (frame.queries.size() < 2u * (index + 1u)) {
+		auto const first = frame.queries.size();
+		frame.queries.resize(first + queries_batch_size);
+		glGenQueries(static_cast<GLsizei>(queries_batch_size), frame.queries.data() + first);
+	}
+
+	glQueryCounter(frame.queries[2u * index], GL_TIMESTAMP);
+	frame.scopes.push_back({ name, static_cast<unsigned int>(_open_scopes.size()), now(), 0, 0, 0 });
+	_open_scopes.push_back(index);
+}
+
+void
+eda221::profiler::end_scope()
+{
+	if (_open_scopes.empty())
+		return;
+
+	auto& frame = _frames[_frame];
+	auto const index = _open_scopes.back();
+	_open_scopes.pop_back();
+	frame.scopes[index].cpu_end = now();
+	glQueryCounter(frame.queries[2u * index + 1u], GL_TIMESTAMP);
+}
+
+std::int64_t
+eda221::profiler::now() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _epoch).count();
+}
+
+void
+eda221::profiler::collect(frame_samples& frame)
+{
+	frame.is_pending = false;
+	if (frame.scopes.empty())
+		return;
+
+	// The frame scope is the last one to end, and queries complete in the
+	// order they were issued.
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE) {
+		++_dropped_frames_nb;
+		return;
+	}
+
+	for (size_t i = 0u; i < frame.scopes.size(); ++i) {
+		GLuint64 begin = 0u, end = 0u;
+		glGetQueryObjectui64v(frame.queries[2u * i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[2u * i + 1u], GL_QUERY_RESULT, &end);
+		frame.scopes[i].gpu_begin = static_cast<std::int64_t>(begin) + _gpu_to_cpu;
+		frame.scopes[i].gpu_end = static_cast<std::int64_t>(end) + _gpu_to_cpu;
+	}
+	record(frame.scopes);
+}
+
+void
+eda221::profiler::record(std::vector<scope_sample> const& scopes)
+{
+	_completed.push_back(scopes);
+	if (_completed.size() > history_size)
+		_completed.pop_front();
+
+	auto const paths = get_paths(scopes);
+	for (size_t i = 0u; i < scopes.size(); ++i) {
+		auto& history = _histories[paths[i]];
+		history.cpu_ms[history.next] = to_milliseconds(scopes[i].cpu_end - scopes[i].cpu_begin);
+		history.gpu_ms[history.next] = to_milliseconds(scopes[i].gpu_end - scopes[i].gpu_begin);
+		history.next = (history.next + 1u) % history_size;
+		history.samples_nb = std::min<size_t>(history.samples_nb + 1u, size_t(history_size));
+	}
+}
+
+std::vector<std::string>
+eda221::profiler::get_paths(std::vector<scope_sample> const& scopes)
+{
+	auto paths = std::vector<std::string>();
+	paths.reserve(scopes.size());
+	auto parents = std::vector<size_t>();
+	for (auto const& scope : scopes) {
+		parents.resize(scope.depth);
+		paths.push_back(parents.empty() ? scope.name : paths[parents.back()] + "/" + scope.name);
+		parents.push_back(paths.size() - 1u);
+	}
+	return paths;
+}
+
+void
+eda221::profiler::show_window() const
+{
+	bool const opened = ImGui::Begin("Profiler", nullptr, ImVec2(560, 360), -1.0f, 0);
+	if (opened) {
+		if (ImGui::Button("Export Chrome trace") && export_chrome_trace(trace_path))
+			LogInfo("Wrote %u frames to %s", static_cast<unsigned int>(_completed.size()), trace_path);
+		if (_dropped_frames_nb != 0u) {
+			ImGui::SameLine();
+			ImGui::Text("%u frames dropped", static_cast<unsigned int>(_dropped_frames_nb));
+		}
+
+		if (_completed.empty()) {
+			ImGui::Text("Waiting for the first results...");
+		} else {
+			show_flame_graph("CPU", false);
+			show_flame_graph("GPU", true);
+
+			// Statistics over the kept frames, in the order of the latest
+			// one.
+			auto const& scopes = _completed.back();
+			auto const paths = get_paths(scopes);
+			ImGui::Text("%-24s %-23s %-23s", "Scope", "CPU min/avg/p99 (ms)", "GPU min/avg/p99 (ms)");
+			for (size_t i = 0u; i < scopes.size(); ++i) {
+				auto const history = _histories.find(paths[i]);
+				if (history == _histories.end())
+					continue;
+				auto const cpu = compute_statistics(history->second.cpu_ms.data(), history->second.samples_nb);
+				auto const gpu = compute_statistics(history->second.gpu_ms.data(), history->second.samples_nb);
+				auto const indent = static_cast<int>(std::min(2u * scopes[i].depth, 12u));
+				ImGui::Text("%*s%-*s %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f", indent, "", 24 - indent, scopes[i].name,
+				            cpu.min, cpu.average, cpu.p99, gpu.min, gpu.average, gpu.p99);
+			}
+		}
+	}
+	ImGui::End();
+}
+
+void
+eda221::profiler::show_flame_graph(char const* label, bool is_gpu) const
+{
+	auto const& scopes = _completed.back();
+	auto const get_begin = [is_gpu](scope_sample const& scope) { return is_gpu ? scope.gpu_begin : scope.cpu_begin; };
+	auto const get_end = [is_gpu](scope_sample const& scope) { return is_gpu ? scope.gpu_end : scope.cpu_end; };
+
+	// The frame scope spans the whole graph.
+	auto const frame_begin = get_begin(scopes.front());
+	auto const frame_duration = std::max<std::int64_t>(get_end(scopes.front()) - frame_begin, 1);
+	ImGui::Text("%s: %.3f ms", label, to_milliseconds(frame_duration));
+
+	unsigned int max_depth = 0u;
+	for (auto const& scope : scopes)
+		max_depth = std::max(max_depth, scope.depth);
+
+	auto const origin = ImGui::GetCursorScreenPos();
+	auto const width = ImGui::GetWindowContentRegionMax().x - ImGui::GetWindowContentRegionMin().x;
+	auto const row_height = ImGui::GetTextLineHeightWithSpacing();
+	auto const mouse = ImGui::GetIO().MousePos;
+	auto const text_colour = ImGui::ColorConvertFloat4ToU32(ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
+	auto draw_list = ImGui::GetWindowDrawList();
+	for (auto const& scope : scopes) {
+		auto const begin = static_cast<float>(get_begin(scope) - frame_begin) / static_cast<float>(frame_duration);
+		auto const end = static_cast<float>(get_end(scope) - frame_begin) / static_cast<float>(frame_duration);
+		auto const x0 = origin.x + width * begin;
+		auto const x1 = std::max(origin.x + width * end, x0 + 1.0f);
+		auto const y0 = origin.y + row_height * static_cast<float>(scope.depth);
+		auto const y1 = y0 + row_height - 1.0f;
+		draw_list->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), get_scope_colour(scope.name));
+		if (ImGui::CalcTextSize(scope.name).x + 4.0f < x1 - x0)
+			draw_list->AddText(ImVec2(x0 + 2.0f, y0), text_colour, scope.name);
+		if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+			ImGui::SetTooltip("%s: %.3f ms", scope.name, to_milliseconds(get_end(scope) - get_begin(scope)));
+	}
+	ImGui::Dummy(ImVec2(width, row_height * static_cast<float>(max_depth + 1u)));
+}
+
+bool
+eda221::profiler::export_chrome_trace(std::string const& path) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		LogError("Failed to open %s for writing", path.c_str());
+		return false;
+	}
+
+	// Timestamps and durations are in microseconds; the CPU and GPU
+	// timelines are shown as two threads.
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (auto const& scopes : _completed)
+		for (auto const& scope : scopes) {
+			for (int tid = 1; tid <= 2; ++tid) {
+				auto const begin = tid == 1 ? scope.cpu_begin : scope.gpu_begin;
+				auto const end = tid == 1 ? scope.cpu_end : scope.gpu_end;
+				file << ",\n{\"name\":";
+				write_json_string(file, scope.name);
+				file << ",\"ph\":\"X\",\"ts\":" << static_cast<double>(begin) / 1.0e3
+				     << ",\"dur\":" << static_cast<double>(end - begin) / 1.0e3
+				     << ",\"pid\":1,\"tid\":" << tid << "}";
+			}
+		}
+	file << "\n]}\n";
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Measures nested scopes of each frame, both on the CPU and on
+	//!        the GPU.
+	//!
+	//! CPU times come from a steady clock, and GPU times from GL_TIMESTAMP
+	//! queries issued at both ends of each scope. The queries of a frame
+	//! are only read `frames_nb` frames later, and only if they are all
+	//! available by then, so that profiling never stalls the pipeline;
+	//! otherwise, that frame is dropped.
+	//!
+	//! Scopes are opened between `begin_frame()` and `end_frame()`,
+	//! preferably through `eda221::profile_scope`. The last
+	//! `history_size` frames feed the statistics of `show_window()`, and
+	//! can be exported with `export_chrome_trace()`.
+	class profiler
+	{
+	public:
+		//! \brief Number of frames whose queries can be in flight.
+		static constexpr size_t frames_nb = 3u;
+
+		//! \brief Number of completed frames kept.
+		static constexpr size_t history_size = 128u;
+
+		//! \brief Create an empty profiler.
+		profiler();
+
+		//! \brief Delete the queries.
+		~profiler();
+
+		profiler(profiler const&) = delete;
+		profiler& operator=(profiler const&) = delete;
+
+		//! \brief Collect the results of an older frame, and open the
+		//!        `frame` scope of a new one.
+		void begin_frame();
+
+		//! \brief Close all scopes still open, including `frame`.
+		void end_frame();
+
+		//! \brief Open a scope, nested in the currently open one.
+		//!
+		//! @param [in] name of the scope; it has to outlive the profiler,
+		//!             as string literals do
+		void begin_scope(char const* name);
+
+		//! \brief Close the innermost open scope.
+		void end_scope();
+
+		//! \brief Show the latest completed frame as CPU and GPU flame
+		//!        graphs, along with the min, average and 99th percentile
+		//!        of each scope over the kept frames.
+		//!
+		//! It has to be called between `ImGui_ImplGlfwGL3_NewFrame()` and
+		//! `ImGui::Render()`.
+		void show_window() const;
+
+		//! \brief Write the kept frames in the Chrome trace event format,
+		//!        to be opened with chrome://tracing.
+		//!
+		//! @param [in] path of the JSON file to write
+		//! @return whether the file could be written
+		bool export_chrome_trace(std::string const& path) const;
+
+		//! \brief Get how many frames were dropped, as their queries were
+		//!        not available in time.
+		size_t get_dropped_frames_nb() const { return _dropped_frames_nb; }
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct scope_sample {
+			char const* name;
+			unsigned int depth;
+			std::int64_t cpu_begin; // in nanoseconds since _epoch
+			std::int64_t cpu_end;
+			std::int64_t gpu_begin; // same, once converted from the GPU clock
+			std::int64_t gpu_end;
+		};
+
+		struct frame_samples {
+			std::vector<scope_sample> scopes;
+			std::vector<GLuint> queries; // two per scope, kept across frames
+			bool is_pending;
+		};
+
+		struct scope_history {
+			std::array<float, history_size> cpu_ms;
+			std::array<float, history_size> gpu_ms;
+			size_t samples_nb;
+			size_t next;
+		};
+
+		std::int64_t now() const;
+		void collect(frame_samples& frame);
+		void record(std::vector<scope_sample> const& scopes);
+		void show_flame_graph(char const* label, bool is_gpu) const;
+
+		// Path of each scope from the frame scope, such as `frame/render`;
+		// statistics are gathered by path.
+		static std::vector<std::string> get_paths(std::vector<scope_sample> const& scopes);
+
+		clock::time_point _epoch;
+		std::int64_t _gpu_to_cpu;
+		std::array<frame_samples, frames_nb> _frames;
+		size_t _frame;
+		bool _is_in_frame;
+		std::vector<size_t> _open_scopes;
+		std::deque<std::vector<scope_sample>> _completed;
+		std::unordered_map<std::string, scope_history> _histories;
+		size_t _dropped_frames_nb;
+	};
+
+	//! \brief Profiles the lifetime of a C++ scope.
+	class profile_scope
+	{
+	public:
+		//! \brief Open a scope of `p`.
+		//!
+		//! @param [in] p the profiler to use
+		//! @param [in] name of the scope; see `profiler::begin_scope()`
+		profile_scope(profiler& p, char const* name) : _profiler(p) { _profiler.begin_scope(name); }
+
+		//! \brief Close the scope.
+		~profile_scope() { _profiler.end_scope(); }
+
+		profile_scope(profile_scope const&) = delete;
+		profile_scope& operator=(profile_scope const&) = delete;
+
+	private:
+		profiler& _profiler;
+	};
+}
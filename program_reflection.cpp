@@ -0,0 +1,107 @@
+#include "program_reflection.hpp"
+
+#include "core/Log.h"
+
+#include <vector>
+
+namespace
+{
+	char const* const known_names[] = {
+		"has_textures",
+		"has_diffuse_texture"
+	};
+	static_assert(sizeof(known_names) / sizeof(known_names[0]) == static_cast<size_t>(eda221::uniform::count),
+	              "Every well-known uniform needs a name");
+
+	size_t name_lookups_nb = 0u;
+
+	std::unordered_map<GLuint, eda221::program_reflection>& registry()
+	{
+		static std::unordered_map<GLuint, eda221::program_reflection> programs;
+		return programs;
+	}
+}
+
+eda221::program_reflection::program_reflection() : _program(0u), _known_locations(), _locations()
+{
+	_known_locations.fill(-1);
+}
+
+eda221::program_reflection::program_reflection(GLuint program) : program_reflection()
+{
+	_program = program;
+	if (program == 0u)
+		return;
+
+	GLint uniforms_nb = 0, max_name_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniforms_nb);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+	auto name = std::vector<GLchar>(static_cast<size_t>(max_name_length) + 1u);
+	for (GLint i = 0; i < uniforms_nb; ++i) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+		auto uniform_name = std::string(name.data(), static_cast<size_t>(length));
+		// Arrays are reported as `name[0]`; also make them available
+		// under their plain name.
+		auto const bracket = uniform_name.find('[');
+		if (bracket != std::string::npos)
+			uniform_name.erase(bracket);
+
+		auto const location = glGetUniformLocation(program, uniform_name.c_str());
+		++name_lookups_nb;
+		if (location < 0) // uniforms living in a block have no location
+			continue;
+		_locations.emplace(uniform_name, location);
+	}
+
+	for (size_t i = 0u; i < _known_locations.size(); ++i) {
+		auto const it = _locations.find(known_names[i]);
+		if (it != _locations.end())
+			_known_locations[i] = it->second;
+	}
+}
+
+GLint
+eda221::program_reflection::get_location(std::string const& name) const
+{
+	++name_lookups_nb;
+	auto const it = _locations.find(name);
+	return it != _locations.end() ? it->second : -1;
+}
+
+size_t
+eda221::program_reflection::get_name_lookups_nb()
+{
+	return name_lookups_nb;
+}
+
+void
+eda221::program_reflection::reset_name_lookups_nb()
+{
+	name_lookups_nb = 0u;
+}
+
+void
+eda221::registerProgramReflection(GLuint program)
+{
+	if (program == 0u) {
+		LogWarning("Trying to reflect an invalid program");
+		return;
+	}
+	// Assign in place, so that references handed out for a previous
+	// program using the same name stay valid.
+	registry()[program] = program_reflection(program);
+}
+
+eda221::program_reflection const&
+eda221::getProgramReflection(GLuint program)
+{
+	static program_reflection const empty_reflection;
+
+	auto const& programs = registry();
+	auto const it = programs.find(program);
+	return it != programs.end() ? it->second : empty_reflection;
+}
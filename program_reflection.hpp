@@ -0,0 +1,87 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+namespace eda221
+{
+	//! \brief Per-draw uniforms shared by most of the EDA221 shaders;
+	//!        their locations are resolved once, when the program is
+	//!        linked, and can then be retrieved without any string lookup.
+	//!
+	//! Transforms, per-frame and per-material values live in uniform
+	//! blocks instead; see `eda221::object_block`, `eda221::frame_block`
+	//! and `eda221::material_block`.
+	enum class uniform : unsigned int {
+		has_textures = 0u,   //!< = 0, whether any texture is bound
+		has_diffuse_texture, //!< = 1, whether `diffuse_texture` is bound
+		count                //!< number of well-known uniforms
+	};
+
+	//! \brief Locations of all the active uniforms and samplers of an
+	//!        OpenGL shader program.
+	//!
+	//! The reflection is built once, by `eda221::createProgram()`, right
+	//! after the program has been linked. Well-known uniforms (see
+	//! `eda221::uniform`) are then accessed through an integer handle,
+	//! while other names (such as sampler names) should be resolved once,
+	//! outside of the render loop, and their location kept around.
+	class program_reflection
+	{
+	public:
+		//! \brief Create an empty reflection, where every location is -1.
+		program_reflection();
+
+		//! \brief Query all active uniforms of a linked program.
+		//!
+		//! @param [in] program OpenGL shader program to reflect
+		explicit program_reflection(GLuint program);
+
+		//! \brief Get the location of a well-known uniform.
+		//!
+		//! @param [in] u the uniform to look for
+		//! @return its location, or -1 if the program does not use it
+		GLint operator[](uniform u) const { return _known_locations[static_cast<size_t>(u)]; }
+
+		//! \brief Get the location of any active uniform, by name.
+		//!
+		//! This performs a string lookup, and is counted as such: avoid
+		//! calling it from within the render loop.
+		//!
+		//! @param [in] name of the uniform, as written in the shader
+		//! @return its location, or -1 if the program does not use it
+		GLint get_location(std::string const& name) const;
+
+		//! \brief Return the name of the reflected OpenGL program.
+		GLuint get_program() const { return _program; }
+
+		//! \brief Return how many name lookups were performed since the
+		//!        last call to `reset_name_lookups_nb()`.
+		static size_t get_name_lookups_nb();
+
+		//! \brief Reset the name lookups counter, typically once per frame.
+		static void reset_name_lookups_nb();
+
+	private:
+		GLuint _program;
+		std::array<GLint, static_cast<size_t>(uniform::count)> _known_locations;
+		std::unordered_map<std::string, GLint> _locations;
+	};
+
+	//! \brief Build and store the reflection of a freshly linked program.
+	//!
+	//! @param [in] program OpenGL shader program to reflect
+	void registerProgramReflection(GLuint program);
+
+	//! \brief Retrieve the reflection of a program.
+	//!
+	//! @param [in] program OpenGL shader program, as returned by
+	//!             `eda221::createProgram()`
+	//! @return the reflection of that program, or an empty reflection if
+	//!         the program was never registered; the returned reference
+	//!         stays valid for the whole lifetime of the application
+	program_reflection const& getProgramReflection(GLuint program);
+}
@@ -0,0 +1,258 @@
+#include "render_queue.hpp"
+#include "helpers.hpp"
+#include "program_reflection.hpp"
+#include "stream_buffer.hpp"
+#include "uniform_buffers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+	// Texture units tracked while flushing; further units are always
+	// rebound.
+	size_t const tracked_texture_units_nb = 16u;
+
+	// Bits of the sorting key, from most to least significant.
+	unsigned int const key_program_bits = 12u;
+	unsigned int const key_textures_bits = 16u;
+	unsigned int const key_vao_bits = 12u;
+	unsigned int const key_depth_bits = 24u;
+	static_assert(key_program_bits + key_textures_bits + key_vao_bits + key_depth_bits == 64u,
+	              "The sorting key should use exactly 64 bits");
+
+	std::uint64_t
+	mask(std::uint64_t value, unsigned int bits)
+	{
+		return value & ((std::uint64_t(1) << bits) - 1u);
+	}
+
+	std::uint64_t
+	hash_textures(eda221::texture_bindings const* textures)
+	{
+		if (textures == nullptr)
+			return 0u;
+
+		// FNV-1a over the texture ids, as bindings with the same name can
+		// use different textures
+		std::uint64_t hash = 14695981039346656037ull;
+		for (auto const& texture : *textures) {
+			hash ^= static_cast<std::uint64_t>(std::get<1>(texture));
+			hash *= 1099511628211ull;
+		}
+		// Fold to the number of bits available in the key.
+		return mask(hash ^ (hash >> 32u) ^ (hash >> 16u), key_textures_bits);
+	}
+
+	size_t
+	align(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1u) & ~(alignment - 1u);
+	}
+
+	void
+	bind_instance_transforms(GLuint instances_bo, GLintptr offset)
+	{
+		// A mat4 attribute takes four consecutive locations, one per
+		// column.
+		auto const first_location = static_cast<GLuint>(eda221::shader_bindings::instance_transforms);
+		glBindBuffer(GL_ARRAY_BUFFER, instances_bo);
+		for (GLuint column = 0u; column < 4u; ++column) {
+			glEnableVertexAttribArray(first_location + column);
+			glVertexAttribPointer(first_location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<GLvoid const*>(offset + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(first_location + column, 1u);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	}
+
+	void
+	unbind_instance_transforms()
+	{
+		// Leave the VAO, which can be shared with non-instanced draws, as
+		// it was.
+		auto const first_location = static_cast<GLuint>(eda221::shader_bindings::instance_transforms);
+		for (GLuint column = 0u; column < 4u; ++column) {
+			glVertexAttribDivisor(first_location + column, 0u);
+			glDisableVertexAttribArray(first_location + column);
+		}
+	}
+}
+
+eda221::render_queue::render_queue() : _world_to_clip(), _packets(), _sorted(), _stats(), _fallback_object_ubo(0u)
+{
+	reset_stats();
+}
+
+eda221::render_queue::~render_queue()
+{
+	if (_fallback_object_ubo != 0u)
+		glDeleteBuffers(1, &_fallback_object_ubo);
+}
+
+void
+eda221::render_queue::set_world_to_clip(glm::mat4 const& world_to_clip)
+{
+	_world_to_clip = world_to_clip;
+}
+
+void
+eda221::render_queue::submit(draw_packet const& packet)
+{
+	if (packet.vao == 0u || packet.program == 0u || packet.reflection == nullptr)
+		return;
+	if (packet.instances_bo != 0u && packet.instances_nb == 0)
+		return;
+
+	_packets.push_back({ compute_key(packet), packet });
+}
+
+std::uint64_t
+eda221::render_queue::compute_key(draw_packet const& packet) const
+{
+	// Sort opaque objects front to back, using the depth of their origin.
+	auto const clip = _world_to_clip * packet.world[3];
+	auto depth = clip.w != 0.0f ? (clip.z / clip.w) * 0.5f + 0.5f : 0.0f;
+	depth = glm::clamp(depth, 0.0f, 1.0f);
+	auto const max_depth = static_cast<float>((std::uint64_t(1) << key_depth_bits) - 1u);
+
+	auto key = mask(packet.program, key_program_bits);
+	key = (key << key_textures_bits) | hash_textures(packet.textures);
+	key = (key << key_vao_bits) | mask(packet.vao, key_vao_bits);
+	key = (key << key_depth_bits) | static_cast<std::uint64_t>(depth * max_depth);
+	return key;
+}
+
+void
+eda221::render_queue::flush()
+{
+	if (_packets.empty())
+		return;
+
+	_sorted.clear();
+	_sorted.reserve(_packets.size());
+	for (auto const& queued : _packets)
+		_sorted.push_back(&queued);
+	std::stable_sort(_sorted.begin(), _sorted.end(),
+	                 [](queued_packet const* a, queued_packet const* b) { return a->key < b->key; });
+
+	// Write the transforms of all non-instanced packets, in the order they
+	// are issued.
+	auto& stream = getStreamBuffer();
+	auto const object_stride = align(sizeof(object_block), stream.get_uniform_alignment());
+	auto const objects_nb = static_cast<size_t>(std::count_if(_sorted.begin(), _sorted.end(),
+	                                                          [](queued_packet const* queued) { return queued->packet.instances_bo == 0u; }));
+	auto objects = stream_allocation{ 0u, 0, nullptr };
+	if (objects_nb != 0u) {
+		objects = stream.allocate(objects_nb * object_stride, stream.get_uniform_alignment());
+		if (objects.data != nullptr) {
+			auto destination = static_cast<unsigned char*>(objects.data);
+			for (auto const queued : _sorted) {
+				if (queued->packet.instances_bo != 0u)
+					continue;
+				object_block const block = { queued->packet.world, queued->packet.normal_world };
+				std::memcpy(destination, &block, sizeof(block));
+				destination += object_stride;
+			}
+		} else if (_fallback_object_ubo == 0u) {
+			// The stream buffer grows before the next frame; until then,
+			// each draw uploads its own ObjectBlock.
+			glGenBuffers(1, &_fallback_object_ubo);
+			glBindBuffer(GL_UNIFORM_BUFFER, _fallback_object_ubo);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(object_block), nullptr, GL_STREAM_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		}
+	}
+	auto const is_streamed = objects.data != nullptr;
+	// Also covers the instance transforms streamed by the submitters.
+	stream.flush();
+	auto object_offset = objects.offset;
+
+	GLuint current_program = 0u;
+	GLuint current_vao = 0u;
+	material const* current_material = nullptr;
+	auto bound_textures = std::array<std::pair<GLenum, GLuint>, tracked_texture_units_nb>();
+	bound_textures.fill(std::make_pair(GL_NONE, 0u));
+
+	for (auto const queued : _sorted) {
+		auto const& packet = queued->packet;
+		auto const& locations = *packet.reflection;
+
+		if (packet.program != current_program) {
+			glUseProgram(packet.program);
+			current_program = packet.program;
+			++_stats.program_switches;
+		}
+		if (packet.material != nullptr && packet.material != current_material) {
+			packet.material->bind();
+			current_material = packet.material;
+			++_stats.material_binds;
+		}
+
+		if (packet.set_uniforms != nullptr && *packet.set_uniforms)
+			(*packet.set_uniforms)(packet.program);
+
+		if (packet.instances_bo == 0u && is_streamed) {
+			glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(uniform_block_bindings::object), objects.buffer, object_offset, sizeof(object_block));
+			object_offset += static_cast<GLintptr>(object_stride);
+		} else if (packet.instances_bo == 0u) {
+			// Orphan the previous content, which earlier draws may still read.
+			object_block const block = { packet.world, packet.normal_world };
+			glBindBuffer(GL_UNIFORM_BUFFER, _fallback_object_ubo);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+			glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(uniform_block_bindings::object), _fallback_object_ubo, 0, sizeof(block));
+		}
+
+		auto const textures_nb = packet.textures != nullptr ? packet.textures->size() : 0u;
+		glUniform1i(locations[eda221::uniform::has_textures], textures_nb != 0u);
+		glUniform1i(locations[eda221::uniform::has_diffuse_texture], packet.has_diffuse_texture);
+		for (size_t i = 0u; i < textures_nb; ++i) {
+			auto const& texture = (*packet.textures)[i];
+			auto const binding = std::make_pair(std::get<2>(texture), std::get<1>(texture));
+			if (i >= tracked_texture_units_nb || bound_textures[i] != binding) {
+				glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+				glBindTexture(binding.first, binding.second);
+				if (i < tracked_texture_units_nb)
+					bound_textures[i] = binding;
+				++_stats.texture_binds;
+			}
+			glUniform1i(std::get<3>(texture), static_cast<GLint>(i));
+		}
+
+		if (packet.vao != current_vao) {
+			glBindVertexArray(packet.vao);
+			current_vao = packet.vao;
+			++_stats.vao_switches;
+		}
+
+		auto const is_indexed = packet.indices_type != GL_NONE;
+		if (packet.instances_bo != 0u) {
+			bind_instance_transforms(packet.instances_bo, packet.instances_offset);
+			if (is_indexed)
+				glDrawElementsInstanced(packet.mode, packet.indices_nb, packet.indices_type, reinterpret_cast<GLvoid const*>(0x0), packet.instances_nb);
+			else
+				glDrawArraysInstanced(packet.mode, 0, packet.indices_nb, packet.instances_nb);
+			unbind_instance_transforms();
+		} else if (is_indexed) {
+			glDrawElements(packet.mode, packet.indices_nb, packet.indices_type, reinterpret_cast<GLvoid const*>(0x0));
+		} else {
+			glDrawArrays(packet.mode, 0, packet.indices_nb);
+		}
+		++_stats.draws;
+	}
+
+	glBindVertexArray(0u);
+	glUseProgram(0u);
+
+	_packets.clear();
+}
+
+void
+eda221::render_queue::reset_stats()
+{
+	_stats.program_switches = 0u;
+	_stats.texture_binds = 0u;
+	_stats.material_binds = 0u;
+	_stats.vao_switches = 0u;
+	_stats.draws = 0u;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eda221
+{
+	class material;
+	class program_reflection;
+
+	//! \brief Textures used by a draw, as (sampler name, texture name,
+	//!        target, sampler location).
+	using texture_bindings = std::vector<std::tuple<std::string, GLuint, GLenum, GLint>>;
+
+	//! \brief Everything needed to issue one draw call.
+	//!
+	//! Pointed-to data (reflection, uniforms callback, textures) is owned
+	//! by the submitter and has to outlive the next `render_queue::flush()`.
+	struct draw_packet {
+		GLuint program;                                 //!< OpenGL shader program
+		program_reflection const* reflection;           //!< uniform locations of `program`
+		std::function<void (GLuint)> const* set_uniforms; //!< custom uniforms setup; can be null
+		texture_bindings const* textures;               //!< textures to bind; can be null
+		bool has_diffuse_texture;                       //!< whether `textures` contains `diffuse_texture`
+		eda221::material const* material;               //!< bound to `MaterialBlock`; can be null
+		GLuint vao;                                     //!< OpenGL Vertex Array Object
+		GLsizei indices_nb;                             //!< number of indices to draw
+		GLenum indices_type;                            //!< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT; GL_NONE
+		                                                //!< to draw `indices_nb` vertices without indices
+		GLenum mode;                                    //!< primitive type, such as GL_TRIANGLES
+		GLuint instances_bo;                            //!< per-instance transforms; 0 if not instanced
+		GLintptr instances_offset;                      //!< offset of the first transform in `instances_bo`
+		GLsizei instances_nb;                           //!< number of instances, when instanced
+		glm::mat4 world;                                //!< model-space to world-space
+		glm::mat4 normal_world;                         //!< inverse-transpose of `world`
+	};
+
+	//! \brief Number of state changes and draws issued by a render queue.
+	struct render_stats {
+		size_t program_switches; //!< calls to glUseProgram
+		size_t texture_binds;    //!< calls to glBindTexture
+		size_t material_binds;   //!< calls to `material::bind()`
+		size_t vao_switches;     //!< calls to glBindVertexArray
+		size_t draws;            //!< draw calls
+	};
+
+	//! \brief Collects draw packets, sorts them to minimise OpenGL state
+	//!        changes, and issues them.
+	//!
+	//! Packets are sorted by a 64-bit key made of, from most to least
+	//! significant, the program, the set of textures, the VAO, and the
+	//! depth of the object (front to back). When issuing the packets, only
+	//! the state that differs from the previous packet is changed.
+	//!
+	//! The transforms of all non-instanced packets are written at once to
+	//! the shared stream buffer (see `eda221::getStreamBuffer()`), and each
+	//! draw binds its own `ObjectBlock` range. Should the stream buffer be
+	//! full, each draw uploads its `ObjectBlock` instead, until the buffer
+	//! grows at the next frame.
+	class render_queue
+	{
+	public:
+		//! \brief Default constructor.
+		render_queue();
+
+		//! \brief Release the fallback `ObjectBlock` buffer, if any.
+		~render_queue();
+
+		render_queue(render_queue const&) = delete;
+		render_queue& operator=(render_queue const&) = delete;
+
+		//! \brief Set the matrix used by the packets submitted afterwards.
+		//!
+		//! Shaders read the world-to-clip matrix from the `FrameBlock`
+		//! (see `eda221::setFrameBlock()`); the queue only uses it to
+		//! compute sorting depths.
+		//!
+		//! @param [in] world_to_clip Matrix transforming from world-space
+		//!             to clip-space
+		void set_world_to_clip(glm::mat4 const& world_to_clip);
+
+		//! \brief Add a draw to the queue.
+		//!
+		//! @param [in] packet the draw to add; packets without a VAO or a
+		//!             program are ignored
+		void submit(draw_packet const& packet);
+
+		//! \brief Sort and issue all the packets submitted since the last
+		//!        flush, then empty the queue.
+		void flush();
+
+		//! \brief Get the statistics accumulated since the last reset.
+		render_stats const& get_stats() const { return _stats; }
+
+		//! \brief Reset the statistics, typically once per frame.
+		void reset_stats();
+
+	private:
+		struct queued_packet {
+			std::uint64_t key;
+			draw_packet packet;
+		};
+
+		std::uint64_t compute_key(draw_packet const& packet) const;
+
+		glm::mat4 _world_to_clip;
+		std::vector<queued_packet> _packets;
+		std::vector<queued_packet const*> _sorted;
+		render_stats _stats;
+		GLuint _fallback_object_ubo; // created the first time the stream buffer is full
+	};
+}
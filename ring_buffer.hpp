@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Sequence pushed at its front and popped at its back, both
+	//!        in O(1), stored in a circular array of slots.
+	//!
+	//! Elements keep their slot until they are popped, so that data
+	//! mirrored slot by slot elsewhere (such as GPU instance transforms)
+	//! only has to be updated for the pushed element. The live slots are
+	//! contiguous, modulo `capacity()`: they start at the slot of the
+	//! oldest element, `get_slot(size() - 1)`.
+	//!
+	//! When full, a push doubles the capacity and moves the elements to
+	//! slots `[0, size())`, from oldest to newest; `push_front()` reports
+	//! it, as every mirrored slot is then outdated.
+	template<typename T>
+	class ring_buffer
+	{
+	public:
+		//! \brief Create an empty buffer.
+		//!
+		//! @param [in] capacity number of slots to start with; at least 1
+		explicit ring_buffer(size_t capacity = 16u) : _slots(capacity > 0u ? capacity : 1u), _newest(0u), _size(0u)
+		{
+		}
+
+		//! \brief Add a new newest element.
+		//!
+		//! @param [in] value the element to add
+		//! @return whether the slots were reallocated
+		bool push_front(T const& value)
+		{
+			auto const reallocated = _size == _slots.size();
+			if (reallocated)
+				grow();
+			_newest = (_newest + 1u) % _slots.size();
+			_slots[_newest] = value;
+			++_size;
+			return reallocated;
+		}
+
+		//! \brief Remove the oldest element; the buffer has to be non-empty.
+		void pop_back()
+		{
+			assert(_size != 0u);
+			--_size;
+		}
+
+		//! \brief Remove all elements, keeping the slots.
+		void clear() { _size = 0u; }
+
+		//! \brief Get the number of elements.
+		size_t size() const { return _size; }
+
+		//! \brief Whether there is no element.
+		bool empty() const { return _size == 0u; }
+
+		//! \brief Get the number of slots.
+		size_t capacity() const { return _slots.size(); }
+
+		//! \brief Get the slot holding an element.
+		//!
+		//! @param [in] index of the element, 0 being the newest; it has to
+		//!             be less than `size()`
+		//! @return its slot, in `[0, capacity())`
+		size_t get_slot(size_t index) const
+		{
+			assert(index < _size);
+			return (_newest + _slots.size() - index) % _slots.size();
+		}
+
+		//! \brief Get the index of the element in a slot, the inverse of
+		//!        `get_slot()`.
+		//!
+		//! @param [in] slot in `[0, capacity())`
+		//! @return the index, 0 being the newest; it is at least `size()`
+		//!         if the slot is not live
+		size_t get_index(size_t slot) const
+		{
+			assert(slot < _slots.size());
+			return (_newest + _slots.size() - slot) % _slots.size();
+		}
+
+		//! \brief Access an element, 0 being the newest.
+		T const& operator[](size_t index) const { return _slots[get_slot(index)]; }
+
+		//! \brief Access the content of a slot, live or not.
+		T const& get_slot_value(size_t slot) const { return _slots[slot]; }
+
+	private:
+		void grow()
+		{
+			auto slots = std::vector<T>(2u * _slots.size());
+			for (size_t i = 0u; i < _size; ++i)
+				slots[i] = std::move(_slots[get_slot(_size - 1u - i)]);
+			_slots.swap(slots);
+			_newest = _size - 1u;
+		}
+
+		std::vector<T> _slots;
+		size_t _newest;
+		size_t _size;
+	};
+}
@@ -1,10 +1,21 @@
 #version 410
 
 layout (location = 0) in vec3 vertex;
-layout (location = 4) in vec3 binormal;
-
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+layout (location = 1) in vec3 normal;
+layout (location = 3) in vec4 tangent; // w: binormal sign
+
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
 
 out VS_OUT {
 	vec3 binormal;
@@ -13,6 +24,7 @@ out VS_OUT {
 
 void main()
 {
+	vec3 binormal = cross(normal, tangent.xyz) * tangent.w;
 	vs_out.binormal = binormal;
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
@@ -3,7 +3,18 @@
 
 uniform sampler2D myBumpMap;
 uniform sampler2D thisTex;
-uniform mat4 normal_model_to_world;
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
+// See eda221::material_block.
+layout(std140) uniform MaterialBlock {
+	vec3 ambient;
+	float shininess;
+	vec3 diffuse;
+	vec3 specular;
+};
 in VS_OUT{
 	vec3 fN;
 	vec3 fT;
@@ -15,16 +26,20 @@ in VS_OUT{
 
 out vec4 frag_color;
 
+// Normal maps may be stored with only two channels (BC5): rebuild z.
+vec3 decode_normal(vec4 texel)
+{
+	vec2 xy = 2.0 * texel.xy - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
 void main(){
-	vec3 ambient = vec3(0.0,0.0,0.0);
-	vec3 specular = vec3(1.0,1.0,1.0);
-	float shininess = 100.0;
 	vec3 N = normalize(fs_in.fN);
 	vec3 T = normalize(fs_in.fT);
 	vec3 B = normalize(fs_in.fB);
 	vec3 V = normalize(fs_in.fV);
 	vec3 L = normalize(fs_in.fL);
-	vec3 normal = 2.0 * texture(myBumpMap,fs_in.fTex).rgb - 1;
+	vec3 normal = decode_normal(texture(myBumpMap,fs_in.fTex));
 	normal = normalize(normal);
 	mat3 vector_transform;
 	vector_transform[0] = T;
@@ -36,6 +51,6 @@ void main(){
 	vec4 texColor = texture(thisTex,fs_in.fTex);
 	float dif = max(dot(normal,L),0.0);
 	vec3 spec = specular*pow(max(dot(V,R),0.0),shininess);
-	frag_color.xyz = ambient + (dif * texColor.rgb) + spec ;
+	frag_color.xyz = ambient + (dif * diffuse * texColor.rgb) + spec ;
 	frag_color.w = 0;
 }
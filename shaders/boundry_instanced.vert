@@ -0,0 +1,42 @@
+#version 410
+//vert
+// Instanced variant of boundry.vert: the model-to-world transform comes from
+// a per-instance attribute instead of the ObjectBlock uniform block.
+// Instances are only translated (and uniformly scaled), so the upper 3x3
+// part of that transform can be used for normals, tangents and binormals.
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 texcoord;
+layout (location = 3) in vec4 tangent; // w: binormal sign
+layout (location = 5) in mat4 instance_model_to_world;
+
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
+out VS_OUT{
+	vec3 fN;
+	vec3 fT;
+	vec3 fB;
+	vec2 fTex;
+	vec3 fV;
+	vec3 fL;
+} vs_out;
+
+
+void main(){
+	vec3 binormal = cross(normal, tangent.xyz) * tangent.w;
+	mat3 normal_model_to_world = mat3(instance_model_to_world);
+	vec3 worldPos = (instance_model_to_world * vec4(vertex,1.0)).xyz;
+	vs_out.fN = normalize(normal_model_to_world * normal);
+	vs_out.fT = normalize(normal_model_to_world * tangent.xyz);
+	vs_out.fB = normalize(normal_model_to_world * binormal);
+	vs_out.fV = camera_position - worldPos;
+	vs_out.fL = light_position - worldPos;
+	vs_out.fTex = vec2(texcoord.x,texcoord.y);
+	gl_Position = vertex_world_to_clip * vec4(worldPos, 1.0);
+}
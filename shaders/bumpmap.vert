@@ -4,14 +4,20 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
-layout (location = 4) in vec3 binormal;
+layout (location = 3) in vec4 tangent; // w: binormal sign
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
-uniform vec3 light_position;
-uniform vec3 camera_position;
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
 out VS_OUT{
 	vec3 fN;
 	vec3 fT;
@@ -23,9 +29,10 @@ out VS_OUT{
 
 
 void main(){
+	vec3 binormal = cross(normal, tangent.xyz) * tangent.w;
 	vec3 worldPos = (vertex_model_to_world * vec4(vertex,1.0)).xyz;
 	vs_out.fN = normalize((normal_model_to_world * vec4(normal,1.0)).xyz);
-	vs_out.fT = normalize((normal_model_to_world * vec4(tangent,1.0)).xyz);
+	vs_out.fT = normalize((normal_model_to_world * vec4(tangent.xyz,1.0)).xyz);
 	vs_out.fB = normalize((normal_model_to_world * vec4(binormal,1.0)).xyz);
 	vs_out.fV = camera_position - worldPos;
 	vs_out.fL = light_position - worldPos;
@@ -1,6 +1,12 @@
 #version 410
 
-uniform vec3 light_position;
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
 
 in VS_OUT {
 	vec3 vertex;
@@ -1,4 +1,11 @@
 #version 410
+// See eda221::material_block.
+layout(std140) uniform MaterialBlock {
+	vec3 ambient;
+	float shininess;
+	vec3 diffuse;
+	vec3 specular;
+};
 
 in VS_OUT {
 	vec3 fN;
@@ -8,10 +15,6 @@ in VS_OUT {
 out vec4 frag_color;
 
 void main(){
-	vec3 ambient = vec3(0.0,0.0,0.0);
-	vec3 diffuse = vec3(0.8,0.6,0.2);
-	vec3 specular = vec3(0.3,0.3,0.3);
-	float shininess = 100;
 	vec3 N = normalize(fs_in.fN);
 	vec3 V = normalize(fs_in.fV);
 	vec3 L = normalize(fs_in.fL);
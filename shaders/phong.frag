@@ -1,8 +1,11 @@
 #version 410
-uniform vec3 ambient;
-uniform vec3 diffuse;
-uniform vec3 specular;
-uniform float shininess;
+// See eda221::material_block.
+layout(std140) uniform MaterialBlock {
+	vec3 ambient;
+	float shininess;
+	vec3 diffuse;
+	vec3 specular;
+};
 
 in VS_OUT {
 	vec3 fN;
@@ -3,8 +3,18 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 3) in vec3 tangent;
 
-uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
 
 out VS_OUT {
 	vec3 tangent;
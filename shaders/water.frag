@@ -2,8 +2,18 @@
 //frag
 uniform sampler2D bumpTex;
 uniform samplerCube cubeTex;
-uniform float time;
-uniform mat4 normal_model_to_world;
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
 
 in VS_OUT{
 	vec3 fN; //Normal
@@ -19,6 +29,13 @@ in VS_OUT{
 
 out vec4 frag_color;
 
+// Normal maps may be stored with only two channels (BC5): rebuild z.
+vec3 decode_normal(vec4 texel)
+{
+	vec2 xy = 2.0 * texel.xy - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
 void main(){
 	vec3 N = normalize(fs_in.fN);
 	vec3 T = normalize(fs_in.fT);
@@ -41,9 +58,9 @@ void main(){
 	vec2 bumpCoord0 = texCoord.xy*texScale + bumpTime*bumpSpeed;
 	vec2 bumpCoord1 = texCoord.xy*texScale*2 + bumpTime*bumpSpeed*4;
 	vec2 bumpCoord2 = texCoord.xy*texScale*4 + bumpTime*bumpSpeed*8;
-	vec3 n0 = 2.0 * texture(bumpTex,bumpCoord0).xyz - 1;
-	vec3 n1 = 2.0 * texture(bumpTex,bumpCoord1).xyz - 1;
-	vec3 n2 = 2.0 * texture(bumpTex,bumpCoord2).xyz - 1;
+	vec3 n0 = decode_normal(texture(bumpTex,bumpCoord0));
+	vec3 n1 = decode_normal(texture(bumpTex,bumpCoord1));
+	vec3 n2 = decode_normal(texture(bumpTex,bumpCoord2));
 	vec3 normal = normalize(n0 + n1 + n2);
 	mat3 vector_transform;
 	vector_transform[0] = B;
@@ -1,18 +1,34 @@
 #version 410
 //vert
 
-layout (location = 0) in vec3 vertex;
-layout (location = 1) in vec3 normal;
-layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
-layout (location = 4) in vec3 binormal;
-
-uniform mat4 vertex_model_to_world;
-uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
-uniform vec3 light_position;
-uniform vec3 camera_position;
-uniform float time;
+// The water has no vertex attributes: it is a geometry clipmap, whose
+// vertices are all derived from gl_VertexID; see clipmap_vertex().
+uniform int clipmap_ring_width;  // width of each ring, in cells
+uniform int clipmap_levels_nb;   // number of levels, the finest included
+uniform float clipmap_cell_size; // size of the cells of the finest level
+uniform vec2 clipmap_center;     // model-space center of all levels
+uniform vec4 clipmap_bounds;     // model-space extent of the water, as
+                                 // (min x, min z, max x, max z)
+
+// Transforms of the current draw, see eda221::object_block.
+layout(std140) uniform ObjectBlock {
+	mat4 vertex_model_to_world;
+	mat4 normal_model_to_world;
+};
+// Shared by all draws of a frame, see eda221::frame_block.
+layout(std140) uniform FrameBlock {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+	float time;
+	vec3 light_position;
+};
+
+// FFT ocean, see eda221::ocean_surface; the maps tile every
+// `ocean_patch_size` world units.
+uniform bool ocean_enabled;
+uniform float ocean_patch_size;
+uniform sampler2D ocean_displacements; // (x offset, height, z offset)
+uniform sampler2D ocean_normals;
 
 out VS_OUT{
 	vec3 fN;
@@ -26,21 +42,151 @@ out VS_OUT{
 	vec3 sB;
 } vs_out;
 
+// Position of vertex `id` of a grid drawn as a triangle strip, `columns`
+// vertices wide: each row of cells alternates between the vertices of
+// its two rows, then two degenerate triangles repeat the last vertex of
+// the row and the first one of the next row.
+// See parametric_shapes::createProceduralGrid().
+ivec2 strip_grid_vertex(int id, int columns)
+{
+	int row_length = 2 * columns + 2;
+	int row = id / row_length;
+	int k = id - row * row_length;
+	if (k == row_length - 2) {
+		k = row_length - 3;
+	} else if (k == row_length - 1) {
+		row = row + 1;
+		k = 0;
+	}
+	return ivec2(k / 2, row + 1 - (k & 1));
+}
+
+// The clipmap is made of blocks drawn one after the other in the same
+// strip, see parametric_shapes::createClipmap(). With m the ring width:
+//   - block 0 is the finest level, a 4m x 4m cells grid;
+//   - each following level is a ring of 4 tiles of 3m x m cells, laid
+//     out as a pinwheel around the 2m x 2m hole left for the previous,
+//     twice finer, level.
+// Each block ends with two degenerate vertices leading to the next one.
+//
+// Returns the model-space position of the vertex, and the size of the
+// cells of its level. The outer vertices of
+// a level that fall in the middle of an edge of the next, coarser, level
+// would leave cracks; for those, `stitch` is set to the offset to their
+// two neighbours along the edge, and is zero otherwise.
+vec2 clipmap_vertex(out vec2 stitch, out float cell_size)
+{
+	int m = clipmap_ring_width;
+	int center_length = 4 * m * (8 * m + 4);
+	int tile_length = m * (6 * m + 4);
+
+	int block = 0;
+	int id = gl_VertexID;
+	int block_length = center_length;
+	if (id >= center_length) {
+		block = 1 + (id - center_length) / tile_length;
+		id = (id - center_length) - (block - 1) * tile_length;
+		block_length = tile_length;
+	}
+	if (id == block_length - 1) {
+		block = block + 1;
+		id = 0;
+	}
+
+	// Position in cells of the block's level, relative to the center.
+	int level = 0;
+	ivec2 cell;
+	if (block == 0) {
+		cell = strip_grid_vertex(id, 4 * m + 1) - ivec2(2 * m);
+	} else {
+		level = 1 + (block - 1) / 4;
+		cell = strip_grid_vertex(id, 3 * m + 1) + ivec2(-2 * m, m);
+		for (int side = (block - 1) % 4; side > 0; --side)
+			cell = ivec2(cell.y, -cell.x);
+	}
+
+	cell_size = clipmap_cell_size * float(1 << level);
+	stitch = vec2(0.0);
+	if (level < clipmap_levels_nb - 1) {
+		if (abs(cell.x) == 2 * m && (cell.y & 1) != 0)
+			stitch = vec2(0.0, cell_size);
+		else if (abs(cell.y) == 2 * m && (cell.x & 1) != 0)
+			stitch = vec2(cell_size, 0.0);
+	}
+	return clipmap_center + vec2(cell) * cell_size;
+}
+
+// Waves of the surface, see eda221::wave_system. The terms shared by all
+// vertices are computed on the CPU:
+//   - direction_phase: (frequency * direction, phase, amplitude);
+//   - shape: (sharpness - 1, 0.5 * sharpness * amplitude, unused, unused).
+struct wave_terms {
+	vec4 direction_phase;
+	vec4 shape;
+};
+
+layout(std140) uniform WaveBlock {
+	int waves_nb;
+	wave_terms waves[32];
+};
+
+// Displace a model-space point of the water plane by the ocean and the
+// waves; returns its displaced world-space position, and the slopes of
+// the surface. The ocean maps are filtered down to `cell_size`.
+vec4 water_surface(vec2 xz, float cell_size, out float dhdx, out float dhdz)
+{
+	vec3 vertex = vec3(clamp(xz, clipmap_bounds.xy, clipmap_bounds.zw), 0.0).xzy;
+	vec4 world = vertex_model_to_world * vec4(vertex, 1.0);
+
+	float height = 0.0;
+	vec2 slope = vec2(0.0);
+	for (int i = 0; i < waves_nb; ++i) {
+		vec4 dp = waves[i].direction_phase;
+		vec4 shape = waves[i].shape;
+		float theta = dot(dp.xy, world.xz) + time * dp.z;
+		float crest = sin(theta) * 0.5 + 0.5;
+		// crest^(sharpness - 1) is shared by the height and the slope;
+		// pow(0, 0) is undefined.
+		float crest_k1 = pow(max(crest, 1.0e-6), shape.x);
+		height += dp.w * crest_k1 * crest;
+		slope += shape.y * crest_k1 * cos(theta) * dp.xy;
+	}
+
+	if (ocean_enabled) {
+		vec2 uv = world.xz / ocean_patch_size;
+		float texels_per_cell = cell_size * float(textureSize(ocean_displacements, 0).x) / ocean_patch_size;
+		float lod = max(log2(texels_per_cell), 0.0);
+		world.xyz += textureLod(ocean_displacements, uv, lod).xyz;
+		vec3 n = textureLod(ocean_normals, uv, lod).xyz;
+		slope -= n.xz / n.y;
+	}
+
+	dhdx = slope.x;
+	dhdz = slope.y;
+	world.y += height;
+	return world;
+}
 
 void main(){
-	//first wave
-	float a1 = 1.0;
-	float f1 = 0.1;
-	float p1 = 0.5;
-	float k1 = 2.0;
-	vec3 dir1 = vec3(-1.0,0.0,0.0);
-
-	//second wave
-	float a2 = 0.5;
-	float f2 = 0.2;
-	float p2 = 1.3;
-	float k2 = 4.0;
-	vec3 dir2 = vec3(-0.7,0.0,0.7);
+	vec2 stitch;
+	float cell_size;
+	vec2 xz = clipmap_vertex(stitch, cell_size);
+	vec3 vertex = vec3(clamp(xz, clipmap_bounds.xy, clipmap_bounds.zw), 0.0).xzy;
+	vec2 texcoord = (vertex.xz - clipmap_bounds.xy) / (clipmap_bounds.zw - clipmap_bounds.xy);
+	vec3 normal = vec3(0.0, 1.0, 0.0);
+	vec3 tangent = vec3(0.0, 0.0, 1.0);
+	vec3 binormal = vec3(1.0, 0.0, 0.0);
+
+	// Stitched vertices lie on the straight edge between their two
+	// neighbours, as seen from the coarser level, filtered like it.
+	float dhdx, dhdz;
+	vec4 h = water_surface(xz, cell_size, dhdx, dhdz);
+	if (stitch != vec2(0.0)) {
+		float dhdx_a, dhdz_a, dhdx_b, dhdz_b;
+		h = 0.5 * (water_surface(xz - stitch, 2.0 * cell_size, dhdx_a, dhdz_a) + water_surface(xz + stitch, 2.0 * cell_size, dhdx_b, dhdz_b));
+		dhdx = 0.5 * (dhdx_a + dhdx_b);
+		dhdz = 0.5 * (dhdz_a + dhdz_b);
+	}
 
 	vec3 worldPos = (vertex_model_to_world * vec4(vertex,1.0)).xyz;
 	vs_out.sN = (vec4(normal,1.0)).xyz;
@@ -49,24 +195,11 @@ void main(){
 	vs_out.fV = camera_position - worldPos;
 	vs_out.fL = light_position - worldPos;
 	vs_out.fTex = vec2(texcoord.x,texcoord.y);
-	
-	vec4 g1 = vertex_model_to_world * vec4(vertex, 1.0);
-	g1.y = g1.y + a1 * pow((sin((dir1.x*g1.x + dir1.z*g1.z)*f1 + time*p1) * 0.5 + 0.5),k1);
-	float dg1x = 0.5*k1*f1*a1*pow((sin((dir1.x * g1.x + dir1.z * g1.z)*f1 + time*p1)*0.5 + 0.5),k1-1)*cos((dir1.x*g1.x + dir1.z * g1.z)*f1 + time * p1) * dir1.x;
-	float dg1z = 0.5*k1*f1*a1*pow((sin((dir1.x * g1.x + dir1.z * g1.z)*f1 + time*p1)*0.5 + 0.5),k1-1)*cos((dir1.x*g1.x + dir1.z * g1.z)*f1 + time * p1) * dir1.z;
-
-	vec4 g2 = vertex_model_to_world * vec4(vertex, 1.0);
-	g2.y = g2.y + a2 * pow((sin((dir2.x*g2.x + dir2.z*g2.z)*f2 + time*p2) * 0.5 + 0.5),k2);
-	float dg2x = 0.5*k2*f2*a2*pow((sin((dir2.x * g2.x + dir2.z * g2.z)*f2 + time*p2)*0.5 + 0.5),k2-1)*cos((dir2.x*g2.x + dir2.z * g2.z)*f2 + time * p2) * dir2.x;
-	float dg2z = 0.5*k2*f2*a2*pow((sin((dir2.x * g2.x + dir2.z * g2.z)*f2 + time*p2)*0.5 + 0.5),k2-1)*cos((dir2.x*g2.x + dir2.z * g2.z)*f2 + time * p2) * dir2.z;
-
-	vec4 h = g1 + g2;
-	float dhdx = dg1x + dg2x;
-	float dhdz = dg1z + dg2z;
+
 	vs_out.fN = vec3(-dhdx,1,-dhdz);
 	vs_out.fB = vec3(1.0,dhdx,0.0);
 	vs_out.fT = vec3(0.0,dhdz,1.0);
- 
+
 
 	gl_Position = vertex_world_to_clip * h;
 }
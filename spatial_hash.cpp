@@ -0,0 +1,123 @@
+#include "spatial_hash.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	size_t const min_buckets_nb = 64u;
+
+	size_t
+	next_power_of_two(size_t value)
+	{
+		auto power = min_buckets_nb;
+		while (power < value)
+			power *= 2u;
+		return power;
+	}
+}
+
+eda221::spatial_hash::spatial_hash(float cell_size, size_t expected_nb) : _cell_size(cell_size), _inverse_cell_size(1.0f / cell_size), _max_radius(0.0f), _size(0u), _entries(), _buckets(next_power_of_two(expected_nb))
+{
+	assert(cell_size > 0.0f);
+	_entries.reserve(expected_nb);
+}
+
+void
+eda221::spatial_hash::insert(std::uint32_t id, glm::vec3 const& position, float radius)
+{
+	assert(id != no_id);
+	if (id >= _entries.size())
+		_entries.resize(static_cast<size_t>(id) + 1u, entry{ glm::vec3(0.0f), 0.0f, glm::ivec3(0), 0u, 0u, false });
+
+	auto& e = _entries[id];
+	auto const cell = get_cell(position);
+	e.position = position;
+	e.radius = radius;
+	_max_radius = std::max(_max_radius, radius);
+	if (e.is_live && e.cell == cell)
+		return;
+
+	if (e.is_live) {
+		unlink(id);
+	} else {
+		e.is_live = true;
+		++_size;
+	}
+	e.cell = cell;
+	if (_size > _buckets.size())
+		rehash(2u * _buckets.size()); // links id along with the others
+	else
+		link(id);
+}
+
+void
+eda221::spatial_hash::remove(std::uint32_t id)
+{
+	if (!contains(id))
+		return;
+	unlink(id);
+	_entries[id].is_live = false;
+	--_size;
+}
+
+void
+eda221::spatial_hash::clear()
+{
+	for (auto& bucket : _buckets)
+		bucket.clear();
+	for (auto& e : _entries)
+		e.is_live = false;
+	_size = 0u;
+	_max_radius = 0.0f;
+}
+
+glm::ivec3
+eda221::spatial_hash::get_cell(glm::vec3 const& position) const
+{
+	return glm::ivec3(glm::floor(position * _inverse_cell_size));
+}
+
+std::uint32_t
+eda221::spatial_hash::get_bucket(glm::ivec3 const& cell) const
+{
+	// Teschner et al., "Optimized Spatial Hashing for Collision Detection
+	// of Deformable Objects", 2003.
+	auto const hash = (static_cast<std::uint32_t>(cell.x) * 73856093u)
+	                ^ (static_cast<std::uint32_t>(cell.y) * 19349663u)
+	                ^ (static_cast<std::uint32_t>(cell.z) * 83492791u);
+	return hash & static_cast<std::uint32_t>(_buckets.size() - 1u);
+}
+
+void
+eda221::spatial_hash::link(std::uint32_t id)
+{
+	auto& e = _entries[id];
+	e.bucket = get_bucket(e.cell);
+	auto& bucket = _buckets[e.bucket];
+	e.bucket_index = static_cast<std::uint32_t>(bucket.size());
+	bucket.push_back(id);
+}
+
+void
+eda221::spatial_hash::unlink(std::uint32_t id)
+{
+	auto const& e = _entries[id];
+	auto& bucket = _buckets[e.bucket];
+	assert(bucket[e.bucket_index] == id);
+	// Swap with the last id of the bucket, to remove in O(1).
+	auto const moved = bucket.back();
+	bucket[e.bucket_index] = moved;
+	_entries[moved].bucket_index = e.bucket_index;
+	bucket.pop_back();
+}
+
+void
+eda221::spatial_hash::rehash(size_t buckets_nb)
+{
+	_buckets.assign(buckets_nb, std::vector<std::uint32_t>());
+	for (std::uint32_t id = 0u; id < _entries.size(); ++id)
+		if (_entries[id].is_live)
+			link(id);
+}
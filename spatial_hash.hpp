@@ -0,0 +1,164 @@
+#pragma once
+
+#include "collision.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Broadphase for sphere overlap queries, over a uniform grid
+	//!        whose cells are hashed into a fixed number of buckets.
+	//!
+	//! Each object is identified by a small integer chosen by the caller,
+	//! such as the slot of a snake segment in its `ring_buffer`, and is
+	//! filed under the cell holding its centre. Inserting, moving and
+	//! removing an object are O(1); a query visits the cells its sphere
+	//! overlaps, grown by the largest radius inserted so far, which is
+	//! O(1) in expectation as long as the cells are about the size of the
+	//! objects and the buckets outnumber the objects.
+	class spatial_hash
+	{
+	public:
+		//! \brief Returned by `find_overlap()` when nothing overlaps.
+		static std::uint32_t const no_id = std::numeric_limits<std::uint32_t>::max();
+
+		//! \brief Create an empty hash.
+		//!
+		//! @param [in] cell_size side of a cell, in world units; about
+		//!             twice the radius of the objects works best
+		//! @param [in] expected_nb number of objects to size the buckets
+		//!             for; they are doubled whenever outnumbered anyway
+		explicit spatial_hash(float cell_size, size_t expected_nb = 0u);
+
+		//! \brief Add an object, or move it if `id` is already in.
+		//!
+		//! @param [in] id of the object
+		//! @param [in] position of its centre
+		//! @param [in] radius of its bounding sphere
+		void insert(std::uint32_t id, glm::vec3 const& position, float radius);
+
+		//! \brief Remove an object, if it is in.
+		void remove(std::uint32_t id);
+
+		//! \brief Remove all objects, keeping the buckets.
+		void clear();
+
+		bool contains(std::uint32_t id) const { return id < _entries.size() && _entries[id].is_live; }
+
+		size_t size() const { return _size; }
+
+		float get_cell_size() const { return _cell_size; }
+
+		//! \brief Find an object whose sphere overlaps a query sphere,
+		//!        that is, whose centre is closer than the sum of the radii,
+		//!        and that `accept` agrees with.
+		//!
+		//! @param [in] center of the query sphere
+		//! @param [in] radius of the query sphere
+		//! @param [in] accept called with the id of each overlapping
+		//!             object until it returns true
+		//! @return the id of the accepted object, or `no_id`
+		template<typename F>
+		std::uint32_t find_overlap(glm::vec3 const& center, float radius, F const& accept) const;
+
+		//! \brief Find any object overlapping a query sphere.
+		std::uint32_t find_overlap(glm::vec3 const& center, float radius) const
+		{
+			return find_overlap(center, radius, [](std::uint32_t) { return true; });
+		}
+
+		//! \brief Find the object a sphere touches first when swept along
+		//!        a segment, among those `accept` agrees with.
+		//!
+		//! @param [in] from centre of the sphere at time 0
+		//! @param [in] to centre of the sphere at time 1
+		//! @param [in] radius of the sphere
+		//! @param [in] accept called with the id of each object touched
+		//! @param [out] hit_time see `sweepSphereSphere()`
+		//! @return the id of the object touched first, or `no_id`
+		template<typename F>
+		std::uint32_t find_first_hit(glm::vec3 const& from, glm::vec3 const& to, float radius, F const& accept, float& hit_time) const;
+
+		//! \brief Find the object a swept sphere touches first.
+		std::uint32_t find_first_hit(glm::vec3 const& from, glm::vec3 const& to, float radius, float& hit_time) const
+		{
+			return find_first_hit(from, to, radius, [](std::uint32_t) { return true; }, hit_time);
+		}
+
+	private:
+		struct entry {
+			glm::vec3 position;
+			float radius;
+			glm::ivec3 cell;
+			std::uint32_t bucket;
+			std::uint32_t bucket_index; // position of the id in its bucket
+			bool is_live;
+		};
+
+		glm::ivec3 get_cell(glm::vec3 const& position) const;
+		std::uint32_t get_bucket(glm::ivec3 const& cell) const;
+		void link(std::uint32_t id);
+		void unlink(std::uint32_t id);
+		void rehash(size_t buckets_nb);
+
+		float _cell_size;
+		float _inverse_cell_size;
+		float _max_radius;
+		size_t _size;
+		std::vector<entry> _entries;                    // indexed by id
+		std::vector<std::vector<std::uint32_t>> _buckets; // ids; a power of two of them
+	};
+}
+
+template<typename F>
+std::uint32_t
+eda221::spatial_hash::find_overlap(glm::vec3 const& center, float radius, F const& accept) const
+{
+	if (_size == 0u)
+		return no_id;
+
+	auto const reach = glm::vec3(radius + _max_radius);
+	auto const min_cell = get_cell(center - reach);
+	auto const max_cell = get_cell(center + reach);
+	for (auto z = min_cell.z; z <= max_cell.z; ++z)
+		for (auto y = min_cell.y; y <= max_cell.y; ++y)
+			for (auto x = min_cell.x; x <= max_cell.x; ++x) {
+				auto const cell = glm::ivec3(x, y, z);
+				for (auto const id : _buckets[get_bucket(cell)]) {
+					auto const& e = _entries[id];
+					// Other cells may share the bucket; they get their turn.
+					if (e.cell != cell)
+						continue;
+					auto const offset = e.position - center;
+					auto const distance = e.radius + radius;
+					if (glm::dot(offset, offset) < distance * distance && accept(id))
+						return id;
+				}
+			}
+	return no_id;
+}
+
+template<typename F>
+std::uint32_t
+eda221::spatial_hash::find_first_hit(glm::vec3 const& from, glm::vec3 const& to, float radius, F const& accept, float& hit_time) const
+{
+	// Gather the candidates around the whole sweep, keeping the earliest.
+	auto first = no_id;
+	auto first_time = 2.0f;
+	find_overlap(0.5f * (from + to), radius + 0.5f * glm::length(to - from), [&](std::uint32_t id) {
+		auto const& e = _entries[id];
+		auto t = 0.0f;
+		if (sweepSphereSphere(from, to, radius, e.position, e.radius, t) && t < first_time && accept(id)) {
+			first = id;
+			first_time = t;
+		}
+		return false;
+	});
+	if (first != no_id)
+		hit_time = first_time;
+	return first;
+}
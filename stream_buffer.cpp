@@ -0,0 +1,197 @@
+#include "stream_buffer.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+#	define EDA221_HAS_BUFFER_STORAGE 1
+#endif
+
+namespace
+{
+	// Regions start on a multiple of this, so that aligning an offset
+	// within a region also aligns it within the buffer.
+	size_t const min_region_alignment = 256u;
+
+	// Longest single wait for a fence, in nanoseconds; waiting resumes
+	// after it expires.
+	GLuint64 const fence_timeout = 1000000000u;
+
+	std::unique_ptr<eda221::stream_buffer> shared_stream_buffer;
+
+	size_t
+	align(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1u) & ~(alignment - 1u);
+	}
+}
+
+eda221::stream_buffer::stream_buffer(size_t frame_size) : _bo(0u), _frame_size(0u), _uniform_alignment(min_region_alignment), _mapping(nullptr), _shadow(), _persistent(hasBufferStorage()), _fences(), _frame(0u), _head(0u), _flushed(0u), _required_size(0u), _stalls_nb(0u)
+{
+	_fences.fill(nullptr);
+
+	GLint uniform_alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+	if (uniform_alignment > 0)
+		_uniform_alignment = static_cast<size_t>(uniform_alignment);
+
+	create(frame_size);
+}
+
+eda221::stream_buffer::~stream_buffer()
+{
+	release();
+}
+
+void
+eda221::stream_buffer::begin_frame()
+{
+	if (_required_size > _frame_size) {
+		LogInfo("Growing the stream buffer from %u to %u bytes per frame", static_cast<unsigned int>(_frame_size), static_cast<unsigned int>(_required_size));
+		// Deleting a buffer the GPU still reads from is fine: OpenGL keeps
+		// its storage alive until those reads complete.
+		release();
+		create(std::max(2u * _frame_size, _required_size));
+	}
+	_required_size = 0u;
+
+	auto& fence = _fences[_frame];
+	if (fence != nullptr) {
+		auto status = glClientWaitSync(fence, 0, 0u);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			++_stalls_nb;
+			do {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fence_timeout);
+			} while (status == GL_TIMEOUT_EXPIRED);
+		}
+		if (status == GL_WAIT_FAILED)
+			LogError("Failed to wait for the GPU to release a stream buffer region");
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	_head = 0u;
+	_flushed = 0u;
+}
+
+eda221::stream_allocation
+eda221::stream_buffer::allocate(size_t size, size_t alignment)
+{
+	assert(alignment != 0u && (alignment & (alignment - 1u)) == 0u);
+
+	auto const base = _frame * _frame_size;
+	auto const offset = align(base + _head, alignment);
+	auto const end = offset + size - base;
+	if (end > _frame_size) {
+		// Remember how much this frame wanted, to grow before the next one.
+		if (_required_size == 0u)
+			LogWarning("The stream buffer is full (%u bytes per frame)", static_cast<unsigned int>(_frame_size));
+		_required_size = std::max(_required_size, _head) + size + alignment;
+		return { _bo, 0, nullptr };
+	}
+
+	_head = end;
+	auto const data = _persistent ? _mapping + offset : _shadow.data() + (offset - base);
+	return { _bo, static_cast<GLintptr>(offset), data };
+}
+
+void
+eda221::stream_buffer::flush()
+{
+	if (_persistent || _flushed == _head)
+		return;
+
+	auto const base = _frame * _frame_size;
+	glBindBuffer(GL_UNIFORM_BUFFER, _bo);
+	glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(base + _flushed), static_cast<GLsizeiptr>(_head - _flushed), _shadow.data() + _flushed);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+	_flushed = _head;
+}
+
+void
+eda221::stream_buffer::end_frame()
+{
+	flush();
+	if (_persistent) {
+		assert(_fences[_frame] == nullptr);
+		_fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	_frame = (_frame + 1u) % frames_nb;
+	_head = 0u;
+	_flushed = 0u;
+}
+
+void
+eda221::stream_buffer::create(size_t frame_size)
+{
+	_frame_size = align(std::max(frame_size, min_region_alignment), std::max(min_region_alignment, _uniform_alignment));
+	auto const size = static_cast<GLsizeiptr>(frames_nb * _frame_size);
+	glGenBuffers(1, &_bo);
+	assert(_bo != 0u);
+	glBindBuffer(GL_UNIFORM_BUFFER, _bo);
+
+#if defined(EDA221_HAS_BUFFER_STORAGE)
+	if (_persistent) {
+		auto const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+		_mapping = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+		if (_mapping == nullptr) {
+			LogWarning("Failed to persistently map the stream buffer; uploading each frame instead");
+			_persistent = false;
+			glDeleteBuffers(1, &_bo);
+			glGenBuffers(1, &_bo);
+			glBindBuffer(GL_UNIFORM_BUFFER, _bo);
+		}
+	}
+#else
+	_persistent = false;
+#endif
+
+	if (!_persistent) {
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		_shadow.resize(_frame_size);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+}
+
+void
+eda221::stream_buffer::release()
+{
+	for (auto& fence : _fences) {
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if (_bo == 0u)
+		return;
+	if (_mapping != nullptr) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _bo);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		_mapping = nullptr;
+	}
+	glDeleteBuffers(1, &_bo);
+	_bo = 0u;
+	_shadow.clear();
+	_head = 0u;
+	_flushed = 0u;
+}
+
+eda221::stream_buffer&
+eda221::getStreamBuffer()
+{
+	if (shared_stream_buffer == nullptr)
+		shared_stream_buffer.reset(new stream_buffer());
+	return *shared_stream_buffer;
+}
+
+void
+eda221::releaseStreamBuffer()
+{
+	shared_stream_buffer.reset();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Range of a `stream_buffer`, to be filled by the CPU.
+	struct stream_allocation {
+		GLuint buffer;   //!< OpenGL buffer holding the range
+		GLintptr offset; //!< offset of the range within `buffer`, in bytes
+		void* data;      //!< where to write the content of the range; null
+		                 //!< if the allocation failed
+	};
+
+	//! \brief Ring buffer for data rewritten every frame, such as
+	//!        per-draw transforms, per-frame constants or instance arrays.
+	//!
+	//! The buffer is split in `frames_nb` regions, one per frame in flight.
+	//! When OpenGL 4.4 or GL_ARB_buffer_storage is available, it is mapped
+	//! once and for all: allocations are written in place, without any
+	//! driver-side copy, and a fence placed at the end of each frame
+	//! prevents overwriting a region the GPU still reads from. Otherwise,
+	//! allocations are written to a CPU-side copy of the region, uploaded
+	//! by `flush()`.
+	//!
+	//! Data is bound by offset, for example with `glBindBufferRange()` or
+	//! `glVertexAttribPointer()`, and is only valid until the end of the
+	//! frame it was allocated in.
+	class stream_buffer
+	{
+	public:
+		//! \brief Number of frames the GPU can lag behind the CPU.
+		static size_t const frames_nb = 3u;
+
+		//! \brief Create the buffer and, if possible, map it.
+		//!
+		//! @param [in] frame_size size available to each frame, in bytes
+		explicit stream_buffer(size_t frame_size = 1024u * 1024u);
+
+		//! \brief Release the buffer and its fences.
+		~stream_buffer();
+
+		stream_buffer(stream_buffer const&) = delete;
+		stream_buffer& operator=(stream_buffer const&) = delete;
+
+		//! \brief Start writing to the next region, once the GPU is done
+		//!        reading it.
+		//!
+		//! If the previous frames ran out of space, the buffer is first
+		//! recreated large enough for them.
+		void begin_frame();
+
+		//! \brief Reserve a range of the current region.
+		//!
+		//! Ranges have to be written before the next call to `flush()` or
+		//! `end_frame()`, and are not kept across frames. If the region is
+		//! full, the allocation fails with a warning, and the buffer grows
+		//! at the next `begin_frame()`.
+		//!
+		//! @param [in] size of the range, in bytes
+		//! @param [in] alignment of the offset of the range, in bytes; has
+		//!             to be a power of two, such as
+		//!             `get_uniform_alignment()` for uniform blocks
+		//! @return the allocated range
+		stream_allocation allocate(size_t size, size_t alignment = 16u);
+
+		//! \brief Make the ranges written so far visible to the GPU; call
+		//!        it before issuing draws reading them.
+		//!
+		//! This is a no-op when the buffer is persistently mapped.
+		void flush();
+
+		//! \brief Fence the current region, once all draws reading from
+		//!        it were issued.
+		void end_frame();
+
+		//! \brief Get the alignment of uniform block ranges.
+		//!
+		//! @return the value of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		size_t get_uniform_alignment() const { return _uniform_alignment; }
+
+		//! \brief Get how many bytes the current frame allocated.
+		size_t get_frame_usage() const { return _head; }
+
+		//! \brief Get how many bytes each frame can allocate.
+		size_t get_frame_size() const { return _frame_size; }
+
+		//! \brief Get how many times `begin_frame()` had to wait for the
+		//!        GPU.
+		size_t get_stalls_nb() const { return _stalls_nb; }
+
+		//! \brief Whether allocations are written directly to the buffer.
+		bool is_persistent() const { return _persistent; }
+
+	private:
+		void create(size_t frame_size);
+		void release();
+
+		GLuint _bo;
+		size_t _frame_size;
+		size_t _uniform_alignment;
+		unsigned char* _mapping;
+		std::vector<unsigned char> _shadow;
+		bool _persistent;
+		std::array<GLsync, frames_nb> _fences;
+		size_t _frame;
+		size_t _head;
+		size_t _flushed;
+		size_t _required_size;
+		size_t _stalls_nb;
+	};
+
+	//! \brief Get the stream buffer shared by the render queues and the
+	//!        frame uniforms; it is created on first use.
+	//!
+	//! `begin_frame()` and `end_frame()` should be called on it around
+	//! each frame.
+	stream_buffer& getStreamBuffer();
+
+	//! \brief Release the shared stream buffer, while the OpenGL context
+	//!        is still alive.
+	void releaseStreamBuffer();
+}
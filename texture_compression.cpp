@@ -0,0 +1,535 @@
+#include "texture_compression.hpp"
+#include "helpers.hpp"
+
+#include "config.hpp"
+#include "core/Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+	std::array<unsigned char, 12> const ktx_identifier = { { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' } };
+	std::uint32_t const ktx_endianness = 0x04030201u;
+
+	struct ktx_header {
+		std::uint32_t endianness;
+		std::uint32_t gl_type;
+		std::uint32_t gl_type_size;
+		std::uint32_t gl_format;
+		std::uint32_t gl_internal_format;
+		std::uint32_t gl_base_internal_format;
+		std::uint32_t pixel_width;
+		std::uint32_t pixel_height;
+		std::uint32_t pixel_depth;
+		std::uint32_t array_elements_nb;
+		std::uint32_t faces_nb;
+		std::uint32_t mipmap_levels_nb;
+		std::uint32_t key_value_data_size;
+	};
+
+	typedef std::array<unsigned char, 4> texel;
+
+	size_t
+	get_block_size(GLenum internal_format)
+	{
+		return internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8u : 16u;
+	}
+
+	size_t
+	get_image_size(GLenum internal_format, unsigned int width, unsigned int height)
+	{
+		return static_cast<size_t>((width + 3u) / 4u) * static_cast<size_t>((height + 3u) / 4u) * get_block_size(internal_format);
+	}
+
+	//
+	// Mip generation
+	//
+
+	std::vector<unsigned char>
+	downsample(std::vector<unsigned char> const& source, unsigned int width, unsigned int height, bool is_normal_map)
+	{
+		auto const new_width = std::max(width / 2u, 1u);
+		auto const new_height = std::max(height / 2u, 1u);
+		auto destination = std::vector<unsigned char>(static_cast<size_t>(new_width) * new_height * 4u);
+		for (unsigned int y = 0u; y < new_height; ++y)
+			for (unsigned int x = 0u; x < new_width; ++x) {
+				auto sum = glm::vec4(0.0f);
+				for (unsigned int dy = 0u; dy < 2u; ++dy)
+					for (unsigned int dx = 0u; dx < 2u; ++dx) {
+						auto const sx = std::min(2u * x + dx, width - 1u);
+						auto const sy = std::min(2u * y + dy, height - 1u);
+						auto const s = source.data() + (static_cast<size_t>(sy) * width + sx) * 4u;
+						sum += glm::vec4(s[0], s[1], s[2], s[3]);
+					}
+				auto average = sum / (4.0f * 255.0f);
+				if (is_normal_map) {
+					// Averaging shortens normals: make them unit again.
+					auto normal = glm::vec3(average) * 2.0f - 1.0f;
+					auto const length = glm::length(normal);
+					if (length > 0.0f)
+						normal /= length;
+					average = glm::vec4(normal * 0.5f + 0.5f, average.w);
+				}
+				auto d = destination.data() + (static_cast<size_t>(y) * new_width + x) * 4u;
+				for (int c = 0; c < 4; ++c)
+					d[c] = static_cast<unsigned char>(glm::clamp(average[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		return destination;
+	}
+
+	//
+	// Block encoders
+	//
+
+	// Gather a 4x4 block, repeating the last row and column of the image
+	// for blocks crossing its border.
+	std::array<texel, 16>
+	get_block(std::vector<unsigned char> const& image, unsigned int width, unsigned int height, unsigned int bx, unsigned int by)
+	{
+		std::array<texel, 16> block;
+		for (unsigned int y = 0u; y < 4u; ++y)
+			for (unsigned int x = 0u; x < 4u; ++x) {
+				auto const sx = std::min(bx * 4u + x, width - 1u);
+				auto const sy = std::min(by * 4u + y, height - 1u);
+				std::memcpy(block[y * 4u + x].data(), image.data() + (static_cast<size_t>(sy) * width + sx) * 4u, 4u);
+			}
+		return block;
+	}
+
+	std::uint16_t
+	to_565(glm::vec3 const& color)
+	{
+		auto const c = glm::clamp(color, 0.0f, 255.0f);
+		auto const r = static_cast<std::uint16_t>((c.x * 31.0f) / 255.0f + 0.5f);
+		auto const g = static_cast<std::uint16_t>((c.y * 63.0f) / 255.0f + 0.5f);
+		auto const b = static_cast<std::uint16_t>((c.z * 31.0f) / 255.0f + 0.5f);
+		return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	glm::vec3
+	from_565(std::uint16_t color)
+	{
+		auto const r = (color >> 11) & 0x1Fu;
+		auto const g = (color >> 5) & 0x3Fu;
+		auto const b = color & 0x1Fu;
+		return glm::vec3(static_cast<float>((r << 3) | (r >> 2)),
+		                 static_cast<float>((g << 2) | (g >> 4)),
+		                 static_cast<float>((b << 3) | (b >> 2)));
+	}
+
+	// Endpoints are taken at the extremes of the colours projected on their
+	// principal axis; always uses the four-colour mode, so that the block
+	// is also valid within BC3.
+	void
+	encode_bc1(std::array<texel, 16> const& block, unsigned char* output)
+	{
+		auto mean = glm::vec3(0.0f);
+		for (auto const& t : block)
+			mean += glm::vec3(t[0], t[1], t[2]);
+		mean /= 16.0f;
+
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (auto const& t : block) {
+			auto const d = glm::vec3(t[0], t[1], t[2]) - mean;
+			covariance[0] += d.x * d.x; covariance[1] += d.x * d.y; covariance[2] += d.x * d.z;
+			covariance[3] += d.y * d.y; covariance[4] += d.y * d.z; covariance[5] += d.z * d.z;
+		}
+		auto axis = glm::vec3(1.0f, 1.0f, 1.0f);
+		for (int i = 0; i < 4; ++i) {
+			axis = glm::vec3(covariance[0] * axis.x + covariance[1] * axis.y + covariance[2] * axis.z,
+			                 covariance[1] * axis.x + covariance[3] * axis.y + covariance[4] * axis.z,
+			                 covariance[2] * axis.x + covariance[4] * axis.y + covariance[5] * axis.z);
+			auto const length = glm::length(axis);
+			if (length < 1e-6f) {
+				axis = glm::vec3(0.0f);
+				break;
+			}
+			axis /= length;
+		}
+
+		auto min_t = 0.0f, max_t = 0.0f;
+		for (auto const& t : block) {
+			auto const projection = glm::dot(glm::vec3(t[0], t[1], t[2]) - mean, axis);
+			min_t = std::min(min_t, projection);
+			max_t = std::max(max_t, projection);
+		}
+
+		auto color0 = to_565(mean + axis * max_t);
+		auto color1 = to_565(mean + axis * min_t);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		std::uint32_t indices = 0u;
+		if (color0 != color1) {
+			auto const c0 = from_565(color0);
+			auto const c1 = from_565(color1);
+			glm::vec3 const palette[4] = { c0, c1, (2.0f * c0 + c1) / 3.0f, (c0 + 2.0f * c1) / 3.0f };
+			for (unsigned int i = 0u; i < 16u; ++i) {
+				auto const color = glm::vec3(block[i][0], block[i][1], block[i][2]);
+				std::uint32_t best = 0u;
+				auto best_distance = std::numeric_limits<float>::max();
+				for (std::uint32_t p = 0u; p < 4u; ++p) {
+					auto const d = color - palette[p];
+					auto const distance = glm::dot(d, d);
+					if (distance < best_distance) {
+						best_distance = distance;
+						best = p;
+					}
+				}
+				indices |= best << (2u * i);
+			}
+		}
+
+		output[0] = static_cast<unsigned char>(color0 & 0xFFu);
+		output[1] = static_cast<unsigned char>(color0 >> 8);
+		output[2] = static_cast<unsigned char>(color1 & 0xFFu);
+		output[3] = static_cast<unsigned char>(color1 >> 8);
+		for (unsigned int i = 0u; i < 4u; ++i)
+			output[4u + i] = static_cast<unsigned char>((indices >> (8u * i)) & 0xFFu);
+	}
+
+	// Encode one channel of the block, as used by BC3 alpha, and BC4/BC5.
+	void
+	encode_bc4(std::array<texel, 16> const& block, unsigned int channel, unsigned char* output)
+	{
+		unsigned char min_value = 255u, max_value = 0u;
+		for (auto const& t : block) {
+			min_value = std::min(min_value, t[channel]);
+			max_value = std::max(max_value, t[channel]);
+		}
+
+		// With value0 > value1, the palette has six interpolated values.
+		std::uint64_t indices = 0u;
+		if (max_value != min_value) {
+			float palette[8];
+			palette[0] = max_value;
+			palette[1] = min_value;
+			for (int i = 1; i < 7; ++i)
+				palette[i + 1] = (static_cast<float>(7 - i) * max_value + static_cast<float>(i) * min_value) / 7.0f;
+			for (unsigned int i = 0u; i < 16u; ++i) {
+				std::uint64_t best = 0u;
+				auto best_distance = std::numeric_limits<float>::max();
+				for (std::uint64_t p = 0u; p < 8u; ++p) {
+					auto const distance = std::abs(static_cast<float>(block[i][channel]) - palette[p]);
+					if (distance < best_distance) {
+						best_distance = distance;
+						best = p;
+					}
+				}
+				indices |= best << (3u * i);
+			}
+		}
+
+		output[0] = max_value;
+		output[1] = min_value;
+		for (unsigned int i = 0u; i < 6u; ++i)
+			output[2u + i] = static_cast<unsigned char>((indices >> (8u * i)) & 0xFFu);
+	}
+
+	void
+	compress_image(std::vector<unsigned char> const& image, unsigned int width, unsigned int height,
+	               eda221::texture_compression compression, unsigned char* output)
+	{
+		for (unsigned int by = 0u; by < (height + 3u) / 4u; ++by)
+			for (unsigned int bx = 0u; bx < (width + 3u) / 4u; ++bx) {
+				auto const block = get_block(image, width, height, bx, by);
+				switch (compression) {
+				case eda221::texture_compression::bc1:
+					encode_bc1(block, output);
+					output += 8;
+					break;
+				case eda221::texture_compression::bc3:
+					encode_bc4(block, 3u, output);
+					encode_bc1(block, output + 8);
+					output += 16;
+					break;
+				case eda221::texture_compression::bc5:
+					encode_bc4(block, 0u, output);
+					encode_bc4(block, 1u, output + 8);
+					output += 16;
+					break;
+				}
+			}
+	}
+
+	//
+	// Files
+	//
+
+	bool
+	has_transparency(std::vector<unsigned char> const& texels)
+	{
+		for (size_t i = 3u; i < texels.size(); i += 4u)
+			if (texels[i] != 255u)
+				return true;
+		return false;
+	}
+}
+
+eda221::texture_compression
+eda221::chooseTextureCompression(std::string const& filename, std::vector<unsigned char> const& texels)
+{
+	auto name = filename;
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	if (name.find("bump") != std::string::npos || name.find("normal") != std::string::npos)
+		return texture_compression::bc5;
+
+	// Tangent-space normal maps: almost all texels decode to unit vectors
+	// pointing away from the surface, and x and y average to about 0.
+	size_t normals_nb = 0u;
+	auto mean = glm::vec3(0.0f);
+	auto const texels_nb = texels.size() / 4u;
+	for (size_t i = 0u; i < texels_nb; ++i) {
+		auto const normal = glm::vec3(texels[4u * i], texels[4u * i + 1u], texels[4u * i + 2u]) / 127.5f - 1.0f;
+		mean += normal;
+		if (normal.z >= 0.0f && std::abs(glm::length(normal) - 1.0f) < 0.1f)
+			++normals_nb;
+	}
+	if (texels_nb > 0u) {
+		mean /= static_cast<float>(texels_nb);
+		if (normals_nb >= texels_nb * 95u / 100u && std::abs(mean.x) < 0.15f && std::abs(mean.y) < 0.15f && mean.z > 0.6f)
+			return texture_compression::bc5;
+	}
+
+	return has_transparency(texels) ? texture_compression::bc3 : texture_compression::bc1;
+}
+
+eda221::compressed_texture
+eda221::compressTexture(std::vector<std::vector<unsigned char>> const& faces,
+                        unsigned int width, unsigned int height,
+                        texture_compression compression)
+{
+	compressed_texture texture;
+	switch (compression) {
+	case texture_compression::bc1: texture.internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+	case texture_compression::bc3: texture.internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+	case texture_compression::bc5: texture.internal_format = GL_COMPRESSED_RG_RGTC2; break;
+	}
+	texture.width = static_cast<GLsizei>(width);
+	texture.height = static_cast<GLsizei>(height);
+	texture.faces_nb = static_cast<unsigned int>(faces.size());
+	texture.levels_nb = 1u;
+	for (auto size = std::max(width, height); size > 1u; size /= 2u)
+		++texture.levels_nb;
+
+	auto levels = faces;
+	auto level_width = width, level_height = height;
+	for (unsigned int level = 0u; level < texture.levels_nb; ++level) {
+		auto const size = get_image_size(texture.internal_format, level_width, level_height);
+		for (auto& image : levels) {
+			texture.offsets.push_back(texture.data.size());
+			texture.sizes.push_back(size);
+			texture.data.resize(texture.data.size() + size);
+			compress_image(image, level_width, level_height, compression, texture.data.data() + texture.offsets.back());
+			if (level + 1u < texture.levels_nb)
+				image = downsample(image, level_width, level_height, compression == texture_compression::bc5);
+		}
+		level_width = std::max(level_width / 2u, 1u);
+		level_height = std::max(level_height / 2u, 1u);
+	}
+
+	return texture;
+}
+
+bool
+eda221::saveKTX(std::string const& path, compressed_texture const& texture)
+{
+	auto const full_path = config::resources_path(path);
+	createParentFolders(full_path);
+	std::ofstream file(full_path, std::ios::binary);
+	if (!file) {
+		LogError("Couldn't open %s for writing", full_path.c_str());
+		return false;
+	}
+
+	ktx_header header;
+	header.endianness = ktx_endianness;
+	header.gl_type = 0u;
+	header.gl_type_size = 1u;
+	header.gl_format = 0u;
+	header.gl_internal_format = texture.internal_format;
+	header.gl_base_internal_format = texture.internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? GL_RGB
+	                               : texture.internal_format == GL_COMPRESSED_RG_RGTC2 ? GL_RG
+	                               : GL_RGBA;
+	header.pixel_width = static_cast<std::uint32_t>(texture.width);
+	header.pixel_height = static_cast<std::uint32_t>(texture.height);
+	header.pixel_depth = 0u;
+	header.array_elements_nb = 0u;
+	header.faces_nb = texture.faces_nb;
+	header.mipmap_levels_nb = texture.levels_nb;
+	header.key_value_data_size = 0u;
+	file.write(reinterpret_cast<char const*>(ktx_identifier.data()), ktx_identifier.size());
+	file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+	// Block sizes are multiples of 4 bytes, so no padding is needed.
+	for (unsigned int level = 0u; level < texture.levels_nb; ++level) {
+		auto const image_size = static_cast<std::uint32_t>(texture.sizes[level * texture.faces_nb]);
+		file.write(reinterpret_cast<char const*>(&image_size), sizeof(image_size));
+		for (unsigned int face = 0u; face < texture.faces_nb; ++face) {
+			auto const i = level * texture.faces_nb + face;
+			file.write(reinterpret_cast<char const*>(texture.data.data() + texture.offsets[i]), static_cast<std::streamsize>(texture.sizes[i]));
+		}
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool
+eda221::loadKTX(std::string const& path, compressed_texture& texture)
+{
+	std::ifstream file(config::resources_path(path), std::ios::binary);
+	if (!file)
+		return false;
+	texture.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	auto const header_size = ktx_identifier.size() + sizeof(ktx_header);
+	if (texture.data.size() < header_size
+	    || !std::equal(ktx_identifier.begin(), ktx_identifier.end(), texture.data.begin()))
+		return false;
+	ktx_header header;
+	std::memcpy(&header, texture.data.data() + ktx_identifier.size(), sizeof(header));
+	if (header.endianness != ktx_endianness || header.gl_type != 0u
+	    || (header.faces_nb != 1u && header.faces_nb != 6u) || header.mipmap_levels_nb == 0u)
+		return false;
+
+	texture.internal_format = header.gl_internal_format;
+	texture.width = static_cast<GLsizei>(header.pixel_width);
+	texture.height = static_cast<GLsizei>(header.pixel_height);
+	texture.faces_nb = header.faces_nb;
+	texture.levels_nb = header.mipmap_levels_nb;
+	texture.offsets.clear();
+	texture.sizes.clear();
+
+	auto offset = header_size + header.key_value_data_size;
+	for (unsigned int level = 0u; level < texture.levels_nb; ++level) {
+		std::uint32_t image_size = 0u;
+		if (offset + sizeof(image_size) > texture.data.size())
+			return false;
+		std::memcpy(&image_size, texture.data.data() + offset, sizeof(image_size));
+		offset += sizeof(image_size);
+		for (unsigned int face = 0u; face < texture.faces_nb; ++face) {
+			if (offset + image_size > texture.data.size())
+				return false;
+			texture.offsets.push_back(offset);
+			texture.sizes.push_back(image_size);
+			offset += (image_size + 3u) & ~3u;
+		}
+	}
+
+	return true;
+}
+
+void
+eda221::uploadCompressedTexture(compressed_texture const& texture, GLenum target,
+                                unsigned char const* data, unsigned int levels_nb)
+{
+	levels_nb = std::max(std::min(levels_nb, texture.levels_nb), 1u);
+	for (unsigned int level = 0u; level < levels_nb; ++level) {
+		auto const width = std::max(texture.width >> level, 1);
+		auto const height = std::max(texture.height >> level, 1);
+		for (unsigned int face = 0u; face < texture.faces_nb; ++face) {
+			auto const i = level * texture.faces_nb + face;
+			auto const image_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+			glCompressedTexImage2D(image_target, static_cast<GLint>(level), texture.internal_format, width, height, 0,
+			                       static_cast<GLsizei>(texture.sizes[i]), reinterpret_cast<GLvoid const*>(data + texture.offsets[i]));
+		}
+	}
+	// Only the uploaded levels are used, so that the texture is complete.
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels_nb - 1u));
+}
+
+std::string
+eda221::getTextureCachePath(std::string const& filename)
+{
+	return "cache/" + filename + ".ktx";
+}
+
+std::string
+eda221::getCubeMapCachePath(std::string const& posx)
+{
+	return "cache/" + posx + ".cube.ktx";
+}
+
+bool
+eda221::isTextureCacheFresh(std::string const& cache_path, std::vector<std::string> const& sources)
+{
+	file_status cache_status;
+	if (!getFileStatus(config::resources_path(cache_path), cache_status))
+		return false;
+	for (auto const& source : sources) {
+		file_status source_status;
+		// A missing source is fine: the cache may be shipped on its own.
+		if (getFileStatus(config::resources_path(source), source_status)
+		    && source_status.modification_time > cache_status.modification_time)
+			return false;
+	}
+	return true;
+}
+
+bool
+eda221::bakeTexture2D(std::string const& filename)
+{
+	auto const path = "textures/" + filename;
+	unsigned int width, height;
+	auto texels = loadImage(path, width, height, true);
+	if (texels.empty()) {
+		LogError("Couldn't load or decode image file %s", config::resources_path(path).c_str());
+		return false;
+	}
+
+	auto const compression = chooseTextureCompression(filename, texels);
+	auto const texture = compressTexture({ std::move(texels) }, width, height, compression);
+	if (!saveKTX(getTextureCachePath(path), texture))
+		return false;
+	LogInfo("Baked %s (%ux%u, BC%u, %u levels): %u bytes instead of %u",
+	        path.c_str(), width, height, compression == texture_compression::bc1 ? 1u : compression == texture_compression::bc3 ? 3u : 5u,
+	        texture.levels_nb, static_cast<unsigned int>(texture.data.size()), width * height * 4u * 4u / 3u);
+	return true;
+}
+
+bool
+eda221::bakeTextureCubeMap(std::string const& posx, std::string const& negx,
+                           std::string const& posy, std::string const& negy,
+                           std::string const& posz, std::string const& negz)
+{
+	// Same order as the GL_TEXTURE_CUBE_MAP_POSITIVE_X... face targets
+	std::string const paths[6] = { posx, negx, posy, negy, posz, negz };
+	std::vector<std::vector<unsigned char>> faces;
+	unsigned int width = 0u, height = 0u;
+	auto compression = texture_compression::bc1;
+	for (auto const& face : paths) {
+		auto const path = "cubemaps/" + face;
+		unsigned int face_width, face_height;
+		auto texels = loadImage(path, face_width, face_height, false);
+		if (texels.empty()) {
+			LogError("Couldn't load or decode image file %s", config::resources_path(path).c_str());
+			return false;
+		}
+		if (!faces.empty() && (face_width != width || face_height != height)) {
+			LogError("Cube map face %s is %ux%u, but the first face is %ux%u", path.c_str(), face_width, face_height, width, height);
+			return false;
+		}
+		width = face_width;
+		height = face_height;
+		if (has_transparency(texels))
+			compression = texture_compression::bc3;
+		faces.push_back(std::move(texels));
+	}
+
+	auto const texture = compressTexture(faces, width, height, compression);
+	if (!saveKTX(getCubeMapCachePath("cubemaps/" + posx), texture))
+		return false;
+	LogInfo("Baked cube map %s (%ux%u, BC%u, %u levels): %u bytes", ("cubemaps/" + posx).c_str(), width, height,
+	        compression == texture_compression::bc1 ? 1u : 3u, texture.levels_nb, static_cast<unsigned int>(texture.data.size()));
+	return true;
+}
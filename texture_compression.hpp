@@ -0,0 +1,131 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Only defined by loaders generated with EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#	define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#	define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace eda221
+{
+	//! \brief Block compression formats textures can be baked to.
+	enum class texture_compression : unsigned int {
+		bc1, //!< RGB, 4 bits per texel (DXT1)
+		bc3, //!< RGBA, 8 bits per texel (DXT5)
+		bc5  //!< two channels, 8 bits per texel (RGTC2); used for normal
+		     //!<   maps, whose z component is rebuilt in the shaders
+	};
+
+	//! \brief A block-compressed texture with all its mip levels, as
+	//!        stored in a KTX file.
+	struct compressed_texture {
+		GLenum internal_format;    //!< OpenGL compressed internal format
+		GLsizei width;             //!< width of the first level, in texels
+		GLsizei height;            //!< height of the first level, in texels
+		unsigned int faces_nb;     //!< 1 for 2D-textures, 6 for cube maps
+		unsigned int levels_nb;    //!< number of mip levels
+		std::vector<unsigned char> data; //!< all compressed images
+		//! Offset of each image in `data`, indexed by
+		//! `level * faces_nb + face`
+		std::vector<size_t> offsets;
+		//! Size of each image in `data`, indexed as `offsets`
+		std::vector<size_t> sizes;
+	};
+
+	//! \brief Pick a compression format for an image.
+	//!
+	//! Normal maps, detected from their name (containing "bump" or
+	//! "normal") or their content, use BC5; images with transparent texels
+	//! use BC3, the others BC1.
+	//!
+	//! @param [in] filename of the image
+	//! @param [in] texels RGBA texels of the image
+	texture_compression chooseTextureCompression(std::string const& filename,
+	                                             std::vector<unsigned char> const& texels);
+
+	//! \brief Generate the mip levels of an image, and block-compress
+	//!        them.
+	//!
+	//! This does not use OpenGL, and can be called from any thread.
+	//!
+	//! @param [in] faces RGBA texels of each face; all faces have the
+	//!             same size
+	//! @param [in] width of each face, in texels
+	//! @param [in] height of each face, in texels
+	//! @param [in] compression the format to compress to
+	//! @return the compressed texture, with a complete mip chain
+	compressed_texture compressTexture(std::vector<std::vector<unsigned char>> const& faces,
+	                                   unsigned int width, unsigned int height,
+	                                   texture_compression compression);
+
+	//! \brief Write a compressed texture to a KTX 1.1 file.
+	//!
+	//! @param [in] path of the file, relative to the `resources` folder;
+	//!             missing folders are created
+	//! @return whether the file could be written
+	bool saveKTX(std::string const& path, compressed_texture const& texture);
+
+	//! \brief Read a block-compressed texture from a KTX 1.1 file.
+	//!
+	//! This does not use OpenGL nor the log, and can be called from any
+	//! thread.
+	//!
+	//! @param [in] path of the file, relative to the `resources` folder
+	//! @param [out] texture the texture read
+	//! @return whether a valid compressed texture could be read
+	bool loadKTX(std::string const& path, compressed_texture& texture);
+
+	//! \brief Upload the mip levels of a compressed texture to the texture
+	//!        currently bound to `target`.
+	//!
+	//! @param [in] texture the texture to upload
+	//! @param [in] target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+	//! @param [in] data where `texture.data` is; when a buffer is bound to
+	//!             GL_PIXEL_UNPACK_BUFFER, this is the offset of that data
+	//!             within the buffer
+	//! @param [in] levels_nb how many levels to upload, at most
+	void uploadCompressedTexture(compressed_texture const& texture, GLenum target,
+	                             unsigned char const* data, unsigned int levels_nb);
+
+	//! \brief Get where the baked version of an image is stored.
+	//!
+	//! @param [in] filename of the image, relative to the `resources`
+	//!             folder, e.g. "textures/waves.png"
+	//! @return the path of the KTX file, relative to the `resources`
+	//!         folder
+	std::string getTextureCachePath(std::string const& filename);
+
+	//! \brief Get where the baked version of a cube map is stored.
+	//!
+	//! @param [in] posx filename of the first face, relative to the
+	//!             `resources` folder
+	std::string getCubeMapCachePath(std::string const& posx);
+
+	//! \brief Whether a baked file exists and is newer than all its
+	//!        sources; all paths are relative to the `resources` folder.
+	bool isTextureCacheFresh(std::string const& cache_path, std::vector<std::string> const& sources);
+
+	//! \brief Bake a PNG image into the texture cache.
+	//!
+	//! @param [in] filename of the PNG image, relative to the `textures`
+	//!             folder within the `resources` folder
+	//! @return whether the image could be read, compressed and written
+	bool bakeTexture2D(std::string const& filename);
+
+	//! \brief Bake six PNG images into a cube map in the texture cache.
+	//!
+	//! All paths are relative to the `res/cubemaps` folder.
+	//!
+	//! @return whether the images could be read, compressed and written
+	bool bakeTextureCubeMap(std::string const& posx, std::string const& negx,
+	                        std::string const& posy, std::string const& negy,
+	                        std::string const& posz, std::string const& negz);
+}
@@ -0,0 +1,387 @@
+#include "texture_loader.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+#	define EDA221_HAS_BUFFER_STORAGE 1
+#endif
+
+namespace
+{
+	// Smallest size of each half of the staging buffer, in bytes
+	size_t const min_staging_half_size = 4u * 1024u * 1024u;
+
+	size_t
+	get_texels_size(std::vector<unsigned char> const& texels)
+	{
+		// Keep every image 4-byte aligned within the staging buffer.
+		return (texels.size() + 3u) & ~static_cast<size_t>(3u);
+	}
+}
+
+eda221::texture_loader::texture_loader(unsigned int workers_nb) : _workers(), _jobs(), _stopping(false), _requests(), _states(), _staging_bo(0u), _staging_half_size(0u), _staging_mapping(nullptr), _persistent(eda221::hasBufferStorage()), _staging_fences(), _staging_half(0u)
+{
+	_staging_fences.fill(nullptr);
+
+	if (workers_nb == 0u)
+		workers_nb = std::max(std::thread::hardware_concurrency(), 1u);
+	_workers.reserve(workers_nb);
+	for (unsigned int i = 0u; i < workers_nb; ++i)
+		_workers.emplace_back(&texture_loader::run_worker, this);
+}
+
+eda221::texture_loader::~texture_loader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_jobs.clear();
+	}
+	_jobs_available.notify_all();
+	for (auto& worker : _workers)
+		worker.join();
+
+	release_staging();
+}
+
+GLuint
+eda221::texture_loader::load_texture_2D(std::string const& filename, glm::vec4 const& placeholder)
+{
+	auto const texture = create_placeholder(GL_TEXTURE_2D, placeholder);
+	auto const path = "textures/" + filename;
+	enqueue(texture, GL_TEXTURE_2D, true, true, { path }, getTextureCachePath(path));
+	return texture;
+}
+
+GLuint
+eda221::texture_loader::load_texture_cube_map(std::string const& posx, std::string const& negx,
+                                              std::string const& posy, std::string const& negy,
+                                              std::string const& posz, std::string const& negz,
+                                              bool generate_mipmap, glm::vec4 const& placeholder)
+{
+	auto const texture = create_placeholder(GL_TEXTURE_CUBE_MAP, placeholder);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+
+	// Same order as the GL_TEXTURE_CUBE_MAP_POSITIVE_X... face targets
+	enqueue(texture, GL_TEXTURE_CUBE_MAP, generate_mipmap, false,
+	        { "cubemaps/" + posx, "cubemaps/" + negx,
+	          "cubemaps/" + posy, "cubemaps/" + negy,
+	          "cubemaps/" + posz, "cubemaps/" + negz },
+	        getCubeMapCachePath("cubemaps/" + posx));
+	return texture;
+}
+
+size_t
+eda221::texture_loader::poll(size_t max_bytes)
+{
+	// Do not write to the half of the staging buffer that the GPU could
+	// still be reading from.
+	if (_persistent && _staging_fences[_staging_half] != nullptr) {
+		if (glClientWaitSync(_staging_fences[_staging_half], 0, 0) == GL_TIMEOUT_EXPIRED)
+			return 0u;
+		glDeleteSync(_staging_fences[_staging_half]);
+		_staging_fences[_staging_half] = nullptr;
+	}
+
+	std::vector<std::pair<GLuint, request>> uploads;
+	size_t total_size = 0u;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto it = _requests.begin(); it != _requests.end();) {
+			auto& texture_request = it->second;
+			if (texture_request.decoded_nb != texture_request.images.size()) {
+				++it;
+				continue;
+			}
+			if (texture_request.failed) {
+				LogWarning("Couldn't load or decode an image of texture %u; keeping its placeholder", it->first);
+				_states[it->first] = texture_state::failed;
+				it = _requests.erase(it);
+				continue;
+			}
+
+			size_t size = 0u;
+			for (auto const& decoded : texture_request.images)
+				size += get_texels_size(decoded.texels);
+			if (!uploads.empty() && total_size + size > max_bytes) {
+				++it;
+				continue;
+			}
+			total_size += size;
+			uploads.emplace_back(it->first, std::move(texture_request));
+			it = _requests.erase(it);
+		}
+	}
+	if (uploads.empty())
+		return 0u;
+
+	ensure_staging_capacity(total_size);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging_bo);
+
+	size_t base_offset = 0u;
+	unsigned char* destination = nullptr;
+	if (_persistent) {
+		base_offset = _staging_half * _staging_half_size;
+		destination = _staging_mapping + base_offset;
+	} else {
+		// Orphan the previous storage, which may still be in use.
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(total_size), nullptr, GL_STREAM_DRAW);
+		destination = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(total_size),
+		                                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	}
+	if (destination == nullptr) {
+		LogError("Failed to map the texture staging buffer");
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& pending : uploads)
+			_requests.emplace(pending.first, std::move(pending.second));
+		return 0u;
+	}
+
+	size_t offset = 0u;
+	for (auto const& pending : uploads)
+		for (auto const& decoded : pending.second.images) {
+			std::memcpy(destination + offset, decoded.texels.data(), decoded.texels.size());
+			offset += get_texels_size(decoded.texels);
+		}
+	if (!_persistent)
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	offset = base_offset;
+	for (auto const& pending : uploads) {
+		upload(pending.first, pending.second, offset);
+		for (auto const& decoded : pending.second.images)
+			offset += get_texels_size(decoded.texels);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+
+	if (_persistent) {
+		_staging_fences[_staging_half] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_staging_half = 1u - _staging_half;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto const& pending : uploads)
+		_states[pending.first] = texture_state::ready;
+	return uploads.size();
+}
+
+void
+eda221::texture_loader::wait_all()
+{
+	while (get_pending_nb() != 0u) {
+		if (poll(std::numeric_limits<size_t>::max()) != 0u)
+			continue;
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto const has_decoded_request = [this]() {
+			return _requests.empty() || std::any_of(_requests.begin(), _requests.end(),
+			                                        [](std::pair<GLuint const, request> const& r) { return r.second.decoded_nb == r.second.images.size(); });
+		};
+		if (has_decoded_request()) {
+			// A decoded request could not be uploaded: the staging buffer
+			// is still in use by the GPU.
+			lock.unlock();
+			glFinish();
+		} else {
+			_image_decoded.wait(lock, has_decoded_request);
+		}
+	}
+}
+
+eda221::texture_state
+eda221::texture_loader::get_state(GLuint texture) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto const it = _states.find(texture);
+	return it != _states.end() ? it->second : texture_state::unknown;
+}
+
+size_t
+eda221::texture_loader::get_pending_nb() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _requests.size();
+}
+
+GLuint
+eda221::texture_loader::create_placeholder(GLenum target, glm::vec4 const& placeholder)
+{
+	auto const color = glm::clamp(placeholder, 0.0f, 1.0f) * 255.0f + 0.5f;
+	unsigned char const texel[4] = {
+		static_cast<unsigned char>(color.r), static_cast<unsigned char>(color.g),
+		static_cast<unsigned char>(color.b), static_cast<unsigned char>(color.a)
+	};
+
+	GLuint texture = 0u;
+	glGenTextures(1, &texture);
+	assert(texture != 0u);
+	glBindTexture(target, texture);
+	if (target == GL_TEXTURE_CUBE_MAP) {
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		for (GLenum face = 0u; face < 6u; ++face)
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(texel));
+	} else {
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(texel));
+	}
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(target, 0u);
+
+	return texture;
+}
+
+void
+eda221::texture_loader::enqueue(GLuint texture, GLenum target, bool generate_mipmap, bool flip,
+                                std::vector<std::string> const& paths, std::string const& cache_path)
+{
+	// A baked texture holds all faces in a single file.
+	auto const use_cache = isTextureCacheFresh(cache_path, paths);
+	auto const& sources = use_cache ? std::vector<std::string>{ cache_path } : paths;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto& texture_request = _requests[texture];
+		texture_request.target = target;
+		texture_request.generate_mipmap = generate_mipmap;
+		texture_request.paths = sources;
+		texture_request.images.resize(sources.size());
+		texture_request.decoded_nb = 0u;
+		texture_request.failed = false;
+		_states[texture] = texture_state::loading;
+
+		for (size_t i = 0u; i < sources.size(); ++i)
+			_jobs.push_back(decode_job{ texture, i, sources[i], flip, use_cache });
+	}
+	_jobs_available.notify_all();
+}
+
+void
+eda221::texture_loader::run_worker()
+{
+	for (;;) {
+		decode_job job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobs_available.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+			if (_stopping)
+				return;
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		image decoded;
+		decoded.is_compressed = job.is_compressed;
+		if (job.is_compressed) {
+			// Keep the whole file, so that it can be copied at once to
+			// the staging buffer; the offsets of the levels stay valid.
+			if (loadKTX(job.path, decoded.compressed))
+				decoded.texels.swap(decoded.compressed.data);
+			decoded.width = static_cast<unsigned int>(decoded.compressed.width);
+			decoded.height = static_cast<unsigned int>(decoded.compressed.height);
+		} else {
+			decoded.texels = loadImage(job.path, decoded.width, decoded.height, job.flip);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto const it = _requests.find(job.texture);
+			assert(it != _requests.end());
+			if (decoded.texels.empty())
+				it->second.failed = true;
+			it->second.images[job.image_index] = std::move(decoded);
+			++it->second.decoded_nb;
+		}
+		_image_decoded.notify_all();
+	}
+}
+
+void
+eda221::texture_loader::upload(GLuint texture, request const& texture_request, size_t staging_offset) const
+{
+	glBindTexture(texture_request.target, texture);
+	if (!texture_request.images.empty() && texture_request.images.front().is_compressed) {
+		auto const& decoded = texture_request.images.front();
+		uploadCompressedTexture(decoded.compressed, texture_request.target, reinterpret_cast<unsigned char const*>(staging_offset),
+		                        texture_request.generate_mipmap ? decoded.compressed.levels_nb : 1u);
+		glBindTexture(texture_request.target, 0u);
+		return;
+	}
+	for (size_t i = 0u; i < texture_request.images.size(); ++i) {
+		auto const& decoded = texture_request.images[i];
+		auto const image_target = texture_request.target == GL_TEXTURE_CUBE_MAP
+		                        ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(i)
+		                        : texture_request.target;
+		// The source is the staging buffer bound to
+		// GL_PIXEL_UNPACK_BUFFER, so the last argument is an offset.
+		glTexImage2D(image_target, 0, GL_RGBA, static_cast<GLsizei>(decoded.width), static_cast<GLsizei>(decoded.height),
+		             0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(staging_offset));
+		staging_offset += get_texels_size(decoded.texels);
+	}
+	if (texture_request.generate_mipmap)
+		glGenerateMipmap(texture_request.target);
+	glBindTexture(texture_request.target, 0u);
+}
+
+void
+eda221::texture_loader::ensure_staging_capacity(size_t half_size)
+{
+	if (_staging_bo != 0u && half_size <= _staging_half_size)
+		return;
+
+	// Deleting a buffer the GPU still reads from is fine: OpenGL keeps
+	// its storage alive until those reads complete.
+	release_staging();
+	_staging_half_size = std::max(half_size, min_staging_half_size);
+	glGenBuffers(1, &_staging_bo);
+	assert(_staging_bo != 0u);
+
+#if defined(EDA221_HAS_BUFFER_STORAGE)
+	if (_persistent) {
+		auto const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		auto const size = static_cast<GLsizeiptr>(2u * _staging_half_size);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging_bo);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+		_staging_mapping = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		if (_staging_mapping == nullptr) {
+			LogWarning("Failed to persistently map the texture staging buffer; mapping it at each upload instead");
+			_persistent = false;
+			glDeleteBuffers(1, &_staging_bo);
+			glGenBuffers(1, &_staging_bo);
+		}
+	}
+#endif
+}
+
+void
+eda221::texture_loader::release_staging()
+{
+	for (auto& fence : _staging_fences) {
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	_staging_half = 0u;
+
+	if (_staging_bo == 0u)
+		return;
+	if (_staging_mapping != nullptr) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging_bo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		_staging_mapping = nullptr;
+	}
+	glDeleteBuffers(1, &_staging_bo);
+	_staging_bo = 0u;
+	_staging_half_size = 0u;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "texture_compression.hpp"
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Progress of a texture requested from a `texture_loader`.
+	enum class texture_state : unsigned int {
+		unknown = 0u, //!< the texture was not requested from this loader
+		loading,      //!< still decoding or waiting to be uploaded; the
+		              //!<   placeholder is used meanwhile
+		ready,        //!< the image is uploaded
+		failed        //!< an image could not be decoded; the placeholder
+		              //!<   is kept
+	};
+
+	//! \brief Decodes PNG images on worker threads, and uploads them to
+	//!        OpenGL textures from the render thread.
+	//!
+	//! Requesting a texture returns its OpenGL name right away, filled with
+	//! a 1x1 placeholder colour, so that it can be given to nodes directly.
+	//! Worker threads decode the images in parallel; `poll()`, called once
+	//! per frame from the thread owning the OpenGL context, then uploads
+	//! the decoded images through a pixel buffer object. Textures baked
+	//! into the compressed texture cache are read from there instead of
+	//! being decoded, and uploaded with their precomputed mip levels. When
+	//! GL_ARB_buffer_storage is available, that staging buffer is mapped
+	//! persistently and split into two halves used in turn, guarded by
+	//! fences; otherwise it is orphaned and mapped at each `poll()`.
+	class texture_loader
+	{
+	public:
+		//! \brief Start the worker threads.
+		//!
+		//! @param [in] workers_nb number of decoding threads; 0 uses one
+		//!             per hardware thread
+		explicit texture_loader(unsigned int workers_nb = 0u);
+
+		//! \brief Stop the worker threads, dropping pending requests, and
+		//!        release the staging buffer.
+		//!
+		//! The textures themselves are not deleted.
+		~texture_loader();
+
+		texture_loader(texture_loader const&) = delete;
+		texture_loader& operator=(texture_loader const&) = delete;
+
+		//! \brief Asynchronously load a PNG image into an OpenGL 2D-texture,
+		//!        with mipmaps.
+		//!
+		//! @param [in] filename of the PNG image, relative to the `textures`
+		//!             folder within the `resources` folder
+		//! @param [in] placeholder colour of the texture until it is ready
+		//! @return the name of the OpenGL 2D-texture
+		GLuint load_texture_2D(std::string const& filename,
+		                       glm::vec4 const& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+		//! \brief Asynchronously load six PNG images into an OpenGL
+		//!        cubemap-texture.
+		//!
+		//! The faces are decoded in parallel, and all uploaded during the
+		//! same `poll()`. Paths are the same as for
+		//! `eda221::loadTextureCubeMap()`.
+		//!
+		//! @return the name of the OpenGL cubemap-texture
+		GLuint load_texture_cube_map(std::string const& posx, std::string const& negx,
+		                             std::string const& posy, std::string const& negy,
+		                             std::string const& posz, std::string const& negz,
+		                             bool generate_mipmap = false,
+		                             glm::vec4 const& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+		//! \brief Upload the images decoded so far; has to be called from
+		//!        the thread owning the OpenGL context.
+		//!
+		//! It never waits for the GPU: if the staging memory is still in
+		//! use, uploads are postponed to a later call.
+		//!
+		//! @param [in] max_bytes approximate amount of texels to upload in
+		//!             this call, to bound the time spent per frame; a
+		//!             texture is always uploaded whole
+		//! @return the number of textures that became ready
+		size_t poll(size_t max_bytes = 64u * 1024u * 1024u);
+
+		//! \brief Block until every requested texture is ready or failed.
+		void wait_all();
+
+		//! \brief Get the progress of a texture returned by this loader.
+		texture_state get_state(GLuint texture) const;
+
+		//! \brief Whether a texture returned by this loader is uploaded.
+		bool is_ready(GLuint texture) const { return get_state(texture) == texture_state::ready; }
+
+		//! \brief Get the number of textures still loading.
+		size_t get_pending_nb() const;
+
+	private:
+		struct image {
+			unsigned int width;
+			unsigned int height;
+			//! RGBA texels, or the whole KTX file for compressed images
+			std::vector<unsigned char> texels;
+			//! Levels of a compressed image, with offsets into `texels`
+			compressed_texture compressed;
+			bool is_compressed;
+		};
+
+		struct request {
+			GLenum target;
+			bool generate_mipmap;
+			std::vector<std::string> paths;
+			std::vector<image> images;
+			size_t decoded_nb;
+			bool failed;
+		};
+
+		struct decode_job {
+			GLuint texture;
+			size_t image_index;
+			std::string path;
+			bool flip;
+			bool is_compressed;
+		};
+
+		GLuint create_placeholder(GLenum target, glm::vec4 const& placeholder);
+		void enqueue(GLuint texture, GLenum target, bool generate_mipmap, bool flip,
+		             std::vector<std::string> const& paths, std::string const& cache_path);
+		void run_worker();
+		void upload(GLuint texture, request const& texture_request, size_t staging_offset) const;
+		void ensure_staging_capacity(size_t half_size);
+		void release_staging();
+
+		// Worker threads and their jobs
+		std::vector<std::thread> _workers;
+		std::deque<decode_job> _jobs;
+		std::condition_variable _jobs_available;
+		bool _stopping;
+
+		// Requests and their decoded images, indexed by texture name;
+		// shared with the workers
+		mutable std::mutex _mutex;
+		std::unordered_map<GLuint, request> _requests;
+		std::unordered_map<GLuint, texture_state> _states;
+		std::condition_variable _image_decoded;
+
+		// Staging pixel buffer object; only used from the OpenGL thread
+		GLuint _staging_bo;
+		size_t _staging_half_size;
+		unsigned char* _staging_mapping;
+		bool _persistent;
+		std::array<GLsync, 2> _staging_fences;
+		size_t _staging_half;
+	};
+}
@@ -0,0 +1,100 @@
+#include "uniform_buffers.hpp"
+#include "helpers.hpp"
+#include "stream_buffer.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	static_assert(offsetof(eda221::frame_block, camera_position) == 64u
+	              && offsetof(eda221::frame_block, time) == 76u
+	              && offsetof(eda221::frame_block, light_position) == 80u
+	              && sizeof(eda221::frame_block) == 96u,
+	              "frame_block has to match the std140 layout of FrameBlock");
+	static_assert(offsetof(eda221::object_block, normal_model_to_world) == 64u
+	              && sizeof(eda221::object_block) == 128u,
+	              "object_block has to match the std140 layout of ObjectBlock");
+	static_assert(offsetof(eda221::material_block, shininess) == 12u
+	              && offsetof(eda221::material_block, diffuse) == 16u
+	              && offsetof(eda221::material_block, specular) == 32u
+	              && sizeof(eda221::material_block) == 48u,
+	              "material_block has to match the std140 layout of MaterialBlock");
+
+	struct block_binding {
+		char const* name;
+		eda221::uniform_block_bindings binding;
+	};
+
+	block_binding const block_bindings[] = {
+		{ "FrameBlock",    eda221::uniform_block_bindings::frame },
+		{ "MaterialBlock", eda221::uniform_block_bindings::material },
+		{ "WaveBlock",     eda221::uniform_block_bindings::waves },
+		{ "ObjectBlock",   eda221::uniform_block_bindings::object }
+	};
+
+	GLuint
+	create_uniform_buffer(GLsizeiptr size, void const* data)
+	{
+		GLuint ubo = 0u;
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		return ubo;
+	}
+}
+
+void
+eda221::setFrameBlock(frame_block const& block)
+{
+	auto& stream = getStreamBuffer();
+	auto const allocation = stream.allocate(sizeof(block), stream.get_uniform_alignment());
+	if (allocation.data == nullptr)
+		return;
+	std::memcpy(allocation.data, &block, sizeof(block));
+	stream.flush();
+	glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(uniform_block_bindings::frame), allocation.buffer, allocation.offset, sizeof(block));
+}
+
+eda221::material::material(material_block const& block) : _ubo(create_uniform_buffer(sizeof(material_block), &block)),
+	_block(block), _is_dirty(false)
+{
+}
+
+eda221::material::~material()
+{
+	glDeleteBuffers(1, &_ubo);
+	_ubo = 0u;
+}
+
+void
+eda221::material::set(material_block const& block)
+{
+	if (std::memcmp(&block, &_block, sizeof(block)) == 0)
+		return;
+	_block = block;
+	_is_dirty = true;
+}
+
+void
+eda221::material::bind() const
+{
+	if (_is_dirty) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(_block), &_block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		_is_dirty = false;
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(uniform_block_bindings::material), _ubo);
+}
+
+void
+eda221::bindUniformBlocks(GLuint program)
+{
+	for (auto const& block : block_bindings) {
+		auto const index = glGetUniformBlockIndex(program, block.name);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, static_cast<GLuint>(block.binding));
+	}
+}
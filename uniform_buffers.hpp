@@ -0,0 +1,81 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+namespace eda221
+{
+	//! \brief Content of the `FrameBlock` uniform block, shared by all
+	//!        draws of a frame; laid out as std140.
+	struct frame_block {
+		glm::mat4 vertex_world_to_clip; //!< world-space to clip-space matrix
+		glm::vec3 camera_position;      //!< world-space camera position
+		float time;                     //!< elapsed time in seconds
+		glm::vec3 light_position;       //!< world-space light position
+		float padding;
+	};
+
+	//! \brief Content of the `ObjectBlock` uniform block, holding the
+	//!        transforms of one draw; laid out as std140.
+	struct object_block {
+		glm::mat4 vertex_model_to_world; //!< model-space to world-space matrix
+		glm::mat4 normal_model_to_world; //!< inverse-transpose of the above
+	};
+
+	//! \brief Content of the `MaterialBlock` uniform block; laid out as
+	//!        std140.
+	struct material_block {
+		glm::vec3 ambient;  //!< ambient colour
+		float shininess;    //!< specular exponent
+		glm::vec3 diffuse;  //!< diffuse colour
+		float padding0;
+		glm::vec3 specular; //!< specular colour
+		float padding1;
+	};
+
+	//! \brief Write the `FrameBlock` of the current frame to the shared
+	//!        stream buffer, and bind it to `uniform_block_bindings::frame`.
+	//!
+	//! Call it once per frame, after `stream_buffer::begin_frame()`.
+	//!
+	//! @param [in] block the new content of `FrameBlock`
+	void setFrameBlock(frame_block const& block);
+
+	//! \brief Material parameters, kept in their own uniform buffer.
+	//!
+	//! The buffer is only uploaded when the parameters changed since it was
+	//! last bound; draws sharing a material share its buffer.
+	class material
+	{
+	public:
+		//! \brief Create the uniform buffer, holding `block`.
+		explicit material(material_block const& block);
+
+		//! \brief Release the uniform buffer.
+		~material();
+
+		material(material const&) = delete;
+		material& operator=(material const&) = delete;
+
+		//! \brief Change the parameters; they are uploaded by the next
+		//!        `bind()`, and only if they differ from the current ones.
+		void set(material_block const& block);
+
+		material_block const& get() const { return _block; }
+
+		//! \brief Upload the parameters if needed, and bind the buffer to
+		//!        `uniform_block_bindings::material`.
+		void bind() const;
+
+	private:
+		GLuint _ubo;
+		material_block _block;
+		mutable bool _is_dirty;
+	};
+
+	//! \brief Connect the uniform blocks of a program to the binding points
+	//!        of `eda221::uniform_block_bindings`.
+	//!
+	//! @param [in] program freshly linked OpenGL shader program
+	void bindUniformBlocks(GLuint program);
+}
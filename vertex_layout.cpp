@@ -0,0 +1,273 @@
+#include "vertex_layout.hpp"
+#include "mesh_optimizer.hpp"
+
+#include "core/Log.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	GLuint
+	get_format_size(eda221::attribute_format format)
+	{
+		switch (format) {
+		case eda221::attribute_format::none:             return 0u;
+		case eda221::attribute_format::float2:           return 2u * sizeof(float);
+		case eda221::attribute_format::float3:           return 3u * sizeof(float);
+		case eda221::attribute_format::float4:           return 4u * sizeof(float);
+		case eda221::attribute_format::half2:            return 2u * sizeof(std::uint16_t);
+		case eda221::attribute_format::snorm_10_10_10_2: return sizeof(std::uint32_t);
+		}
+		return 0u;
+	}
+
+	void
+	write_attribute(std::uint8_t* destination, eda221::attribute_format format, glm::vec4 const& value)
+	{
+		switch (format) {
+		case eda221::attribute_format::none:
+			break;
+		case eda221::attribute_format::float2:
+		case eda221::attribute_format::float3:
+		case eda221::attribute_format::float4:
+			std::memcpy(destination, &value[0], get_format_size(format));
+			break;
+		case eda221::attribute_format::half2:
+		{
+			auto const packed = glm::packHalf2x16(glm::vec2(value));
+			std::memcpy(destination, &packed, sizeof(packed));
+			break;
+		}
+		case eda221::attribute_format::snorm_10_10_10_2:
+		{
+			auto const packed = glm::packSnorm3x10_1x2(glm::clamp(value, -1.0f, 1.0f));
+			std::memcpy(destination, &packed, sizeof(packed));
+			break;
+		}
+		}
+	}
+
+	eda221::vertex_layout default_layout = eda221::getCompactVertexLayout();
+}
+
+eda221::vertex_layout
+eda221::createVertexLayout(attribute_format vertices, attribute_format normals,
+                           attribute_format texcoords, attribute_format tangents)
+{
+	assert(vertices != attribute_format::none);
+
+	vertex_layout layout;
+	layout.formats = { vertices, normals, texcoords, tangents };
+	layout.stride = 0;
+	for (size_t i = 0u; i < layout.formats.size(); ++i) {
+		layout.offsets[i] = static_cast<GLuint>(layout.stride);
+		layout.stride += static_cast<GLsizei>(get_format_size(layout.formats[i]));
+	}
+	return layout;
+}
+
+eda221::vertex_layout const&
+eda221::getCompactVertexLayout()
+{
+	static vertex_layout const layout = createVertexLayout(attribute_format::float3,
+	                                                       attribute_format::snorm_10_10_10_2,
+	                                                       attribute_format::half2,
+	                                                       attribute_format::snorm_10_10_10_2);
+	return layout;
+}
+
+eda221::vertex_layout const&
+eda221::getFullVertexLayout()
+{
+	static vertex_layout const layout = createVertexLayout(attribute_format::float3,
+	                                                       attribute_format::float3,
+	                                                       attribute_format::float2,
+	                                                       attribute_format::float4);
+	return layout;
+}
+
+eda221::vertex_layout const&
+eda221::getDefaultVertexLayout()
+{
+	return default_layout;
+}
+
+void
+eda221::setDefaultVertexLayout(vertex_layout const& layout)
+{
+	default_layout = layout;
+}
+
+std::vector<std::uint8_t>
+eda221::packVertices(vertex_layout const& layout, size_t vertices_nb,
+                     glm::vec3 const* vertices, glm::vec3 const* normals,
+                     glm::vec3 const* texcoords, glm::vec3 const* tangents,
+                     glm::vec3 const* binormals, GLuint const* order)
+{
+	auto data = std::vector<std::uint8_t>(vertices_nb * static_cast<size_t>(layout.stride), 0u);
+	auto const attributes = std::array<glm::vec3 const*, 4>{ { vertices, normals, texcoords, tangents } };
+	auto const tangents_index = static_cast<size_t>(shader_bindings::tangents);
+
+	for (size_t i_v = 0u; i_v < vertices_nb; ++i_v) {
+		auto vertex = data.data() + i_v * static_cast<size_t>(layout.stride);
+		auto const v = order != nullptr ? static_cast<size_t>(order[i_v]) : i_v;
+		for (size_t i = 0u; i < attributes.size(); ++i) {
+			if (layout.formats[i] == attribute_format::none || attributes[i] == nullptr)
+				continue;
+
+			auto w = 1.0f;
+			if (i == tangents_index && normals != nullptr && binormals != nullptr)
+				w = glm::dot(glm::cross(normals[v], tangents[v]), binormals[v]) < 0.0f ? -1.0f : 1.0f;
+			write_attribute(vertex + layout.offsets[i], layout.formats[i], glm::vec4(attributes[i][v], w));
+		}
+	}
+
+	return data;
+}
+
+void
+eda221::setupVertexAttributes(vertex_layout const& layout)
+{
+	for (size_t i = 0u; i < layout.formats.size(); ++i) {
+		auto const location = static_cast<GLuint>(i);
+		auto const offset = reinterpret_cast<GLvoid const*>(static_cast<size_t>(layout.offsets[i]));
+		switch (layout.formats[i]) {
+		case attribute_format::none:
+			glDisableVertexAttribArray(location);
+			continue;
+		case attribute_format::float2:
+			glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, layout.stride, offset);
+			break;
+		case attribute_format::float3:
+			glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, layout.stride, offset);
+			break;
+		case attribute_format::float4:
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, layout.stride, offset);
+			break;
+		case attribute_format::half2:
+			glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, offset);
+			break;
+		case attribute_format::snorm_10_10_10_2:
+			glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, layout.stride, offset);
+			break;
+		}
+		glEnableVertexAttribArray(location);
+	}
+}
+
+eda221::packed_mesh
+eda221::packMesh(vertex_layout const& layout, size_t vertices_nb,
+                 glm::vec3 const* vertices, glm::vec3 const* normals,
+                 glm::vec3 const* texcoords, glm::vec3 const* tangents,
+                 glm::vec3 const* binormals,
+                 GLuint const* indices, size_t indices_nb)
+{
+	assert(vertices != nullptr);
+
+	// Do not reserve space for attributes we have no data for.
+	auto const mesh_layout = createVertexLayout(layout.formats[0],
+	                                            normals != nullptr ? layout.formats[1] : attribute_format::none,
+	                                            texcoords != nullptr ? layout.formats[2] : attribute_format::none,
+	                                            tangents != nullptr ? layout.formats[3] : attribute_format::none);
+
+	auto mesh_indices = std::vector<GLuint>(indices, indices + indices_nb);
+	auto const& optimizations = getMeshOptimizationOptions();
+	auto const acmr_before = computeACMR(mesh_indices.data(), indices_nb, vertices_nb);
+	auto acmr_after = acmr_before;
+	if (optimizations.vertex_cache) {
+		auto optimized_indices = mesh_indices;
+		optimizeVertexCache(optimized_indices.data(), indices_nb, vertices_nb);
+		auto const acmr_optimized = computeACMR(optimized_indices.data(), indices_nb, vertices_nb);
+		// Small grids already fit in the cache in scanline order; only
+		// keep the new order if it is actually better.
+		if (acmr_optimized < acmr_before) {
+			mesh_indices.swap(optimized_indices);
+			acmr_after = acmr_optimized;
+		}
+	}
+	if (optimizations.overdraw) {
+		// Clusters follow the cache flushes of whichever order was kept.
+		optimizeOverdraw(mesh_indices.data(), indices_nb, vertices, vertices_nb);
+		acmr_after = computeACMR(mesh_indices.data(), indices_nb, vertices_nb);
+	}
+	auto vertices_order = std::vector<GLuint>();
+	if (optimizations.vertex_fetch)
+		vertices_order = optimizeVertexFetch(mesh_indices.data(), indices_nb, vertices_nb);
+	LogInfo("Mesh with %u vertices and %u triangles: ACMR %.3f -> %.3f",
+	        static_cast<unsigned int>(vertices_nb), static_cast<unsigned int>(indices_nb / 3u), acmr_before, acmr_after);
+
+	packed_mesh mesh;
+	mesh.layout = mesh_layout;
+	mesh.vertices_nb = vertices_nb;
+	mesh.vertex_data = packVertices(mesh_layout, vertices_nb, vertices, normals, texcoords, tangents, binormals,
+	                                vertices_order.empty() ? nullptr : vertices_order.data());
+	mesh.indices_nb = indices_nb;
+	if (vertices_nb <= static_cast<size_t>(std::numeric_limits<GLushort>::max()) + 1u) {
+		// Every index fits in 16 bits: halve the index buffer.
+		auto const short_indices = std::vector<GLushort>(mesh_indices.begin(), mesh_indices.end());
+		mesh.indices_type = GL_UNSIGNED_SHORT;
+		mesh.index_data.resize(indices_nb * sizeof(GLushort));
+		std::memcpy(mesh.index_data.data(), short_indices.data(), mesh.index_data.size());
+	} else {
+		mesh.indices_type = GL_UNSIGNED_INT;
+		mesh.index_data.resize(indices_nb * sizeof(GLuint));
+		std::memcpy(mesh.index_data.data(), mesh_indices.data(), mesh.index_data.size());
+	}
+
+	return mesh;
+}
+
+eda221::mesh_data
+eda221::uploadMeshData(vertex_layout const& layout, void const* vertex_data, size_t vertex_data_size,
+                       GLenum indices_type, void const* index_data, size_t indices_nb)
+{
+	mesh_data data;
+	data.vao = 0u;
+	glGenVertexArrays(1, &data.vao);
+	assert(data.vao != 0u);
+	glBindVertexArray(data.vao);
+
+	data.bo = 0u;
+	glGenBuffers(1, &data.bo);
+	assert(data.bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertex_data_size), reinterpret_cast<GLvoid const*>(vertex_data), GL_STATIC_DRAW);
+	setupVertexAttributes(layout);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	data.indices_nb = indices_nb;
+	data.indices_type = indices_type;
+	data.mode = GL_TRIANGLES;
+	data.ibo = 0u;
+	glGenBuffers(1, &data.ibo);
+	assert(data.ibo != 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
+	auto const index_size = indices_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices_nb * index_size), reinterpret_cast<GLvoid const*>(index_data), GL_STATIC_DRAW);
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+	return data;
+}
+
+eda221::mesh_data
+eda221::uploadMeshData(packed_mesh const& mesh)
+{
+	return uploadMeshData(mesh.layout, mesh.vertex_data.data(), mesh.vertex_data.size(),
+	                      mesh.indices_type, mesh.index_data.data(), mesh.indices_nb);
+}
+
+eda221::mesh_data
+eda221::createMeshData(vertex_layout const& layout, size_t vertices_nb,
+                       glm::vec3 const* vertices, glm::vec3 const* normals,
+                       glm::vec3 const* texcoords, glm::vec3 const* tangents,
+                       glm::vec3 const* binormals,
+                       GLuint const* indices, size_t indices_nb)
+{
+	return uploadMeshData(packMesh(layout, vertices_nb, vertices, normals, texcoords, tangents, binormals, indices, indices_nb));
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace eda221
+{
+	//! \brief Storage format of a single vertex attribute.
+	enum class attribute_format : unsigned int {
+		none = 0u,        //!< attribute is not stored
+		float2,           //!< 2 x 32-bit float, 8 bytes
+		float3,           //!< 3 x 32-bit float, 12 bytes
+		float4,           //!< 4 x 32-bit float, 16 bytes
+		half2,            //!< 2 x 16-bit float, 4 bytes
+		snorm_10_10_10_2  //!< 3 x 10-bit + 1 x 2-bit signed normalised, 4 bytes
+	};
+
+	//! \brief Describes how the attributes of a vertex are interleaved in
+	//!        a single OpenGL buffer.
+	//!
+	//! Only positions, normals, texture coordinates and tangents are
+	//! stored: binormals are reconstructed in the vertex shaders as
+	//! `cross(normal, tangent.xyz) * tangent.w`, where the sign stored in
+	//! `tangent.w` accounts for mirrored texture mappings.
+	struct vertex_layout {
+		//! Format of each attribute, indexed by `shader_bindings`
+		//! (vertices, normals, texcoords and tangents)
+		std::array<attribute_format, 4> formats;
+		//! Offset of each attribute within a vertex, in bytes
+		std::array<GLuint, 4> offsets;
+		//! Size of a whole vertex, in bytes
+		GLsizei stride;
+	};
+
+	//! \brief A mesh packed and ready to be uploaded, kept on the CPU.
+	struct packed_mesh {
+		vertex_layout layout;                  //!< layout of `vertex_data`
+		size_t vertices_nb;                    //!< number of vertices
+		std::vector<std::uint8_t> vertex_data; //!< interleaved vertices
+		GLenum indices_type;                   //!< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		size_t indices_nb;                     //!< number of indices
+		std::vector<std::uint8_t> index_data;  //!< triangle indices
+	};
+
+	//! \brief Create a layout, computing attribute offsets and stride.
+	//!
+	//! @param [in] vertices format used for positions; cannot be `none`
+	//! @param [in] normals format used for normals
+	//! @param [in] texcoords format used for texture coordinates
+	//! @param [in] tangents format used for tangents and binormal sign;
+	//!             it needs four components to store that sign
+	//! @return the corresponding interleaved layout
+	vertex_layout createVertexLayout(attribute_format vertices, attribute_format normals,
+	                                 attribute_format texcoords, attribute_format tangents);
+
+	//! \brief Layout using 24 bytes per vertex: float positions, 10-bit
+	//!        normals and tangents, and half-float texture coordinates.
+	vertex_layout const& getCompactVertexLayout();
+
+	//! \brief Layout using 48 bytes per vertex, with all attributes stored
+	//!        as 32-bit floats.
+	vertex_layout const& getFullVertexLayout();
+
+	//! \brief Get the layout used by the mesh generators and loaders.
+	//!
+	//! @return the compact layout, unless changed by
+	//!         `setDefaultVertexLayout()`
+	vertex_layout const& getDefaultVertexLayout();
+
+	//! \brief Change the layout used by the mesh generators and loaders.
+	//!
+	//! @param [in] layout the layout meshes created afterwards will use
+	void setDefaultVertexLayout(vertex_layout const& layout);
+
+	//! \brief Interleave and pack vertex attributes following a layout.
+	//!
+	//! Any attribute array can be null, in which case zeros are written;
+	//! the binormals are only used to compute the sign stored alongside
+	//! the tangents.
+	//!
+	//! @param [in] order if not null, the i-th packed vertex is taken from
+	//!             the `order[i]`-th input vertex
+	//! @return `vertices_nb * layout.stride` bytes of packed vertex data
+	std::vector<std::uint8_t> packVertices(vertex_layout const& layout, size_t vertices_nb,
+	                                       glm::vec3 const* vertices, glm::vec3 const* normals,
+	                                       glm::vec3 const* texcoords, glm::vec3 const* tangents,
+	                                       glm::vec3 const* binormals, GLuint const* order = nullptr);
+
+	//! \brief Enable and describe the attributes of a layout on the
+	//!        currently bound Vertex Array Object, sourcing them from the
+	//!        buffer currently bound to GL_ARRAY_BUFFER.
+	//!
+	//! @param [in] layout the layout of the bound buffer
+	void setupVertexAttributes(vertex_layout const& layout);
+
+	//! \brief Reorder and pack vertex attributes and indices, without
+	//!        uploading them.
+	//!
+	//! Triangles and vertices are first reordered according to
+	//! `eda221::getMeshOptimizationOptions()`; the Average Cache Miss Ratio
+	//! before and after is logged. Indices are stored on 16 bits when
+	//! there are at most 65536 vertices, and on 32 bits otherwise.
+	//!
+	//! Parameters are the same as for `createMeshData()`; this does not
+	//! use OpenGL.
+	packed_mesh packMesh(vertex_layout const& layout, size_t vertices_nb,
+	                     glm::vec3 const* vertices, glm::vec3 const* normals,
+	                     glm::vec3 const* texcoords, glm::vec3 const* tangents,
+	                     glm::vec3 const* binormals,
+	                     GLuint const* indices, size_t indices_nb);
+
+	//! \brief Upload already packed vertices and indices into a new Vertex
+	//!        Array Object.
+	//!
+	//! The data is passed as is to OpenGL, so it can come straight from a
+	//! memory-mapped file.
+	//!
+	//! @param [in] layout the layout of `vertex_data`
+	//! @param [in] vertex_data interleaved vertices
+	//! @param [in] vertex_data_size size of `vertex_data`, in bytes
+	//! @param [in] indices_type GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	//! @param [in] index_data triangle indices
+	//! @param [in] indices_nb the number of indices
+	//! @return wrapper around the created OpenGL objects
+	mesh_data uploadMeshData(vertex_layout const& layout, void const* vertex_data, size_t vertex_data_size,
+	                         GLenum indices_type, void const* index_data, size_t indices_nb);
+
+	//! \brief Upload a packed mesh into a new Vertex Array Object.
+	mesh_data uploadMeshData(packed_mesh const& mesh);
+
+	//! \brief Pack vertex attributes, and upload them along with indices
+	//!        into a new Vertex Array Object.
+	//!
+	//! This is `packMesh()` followed by `uploadMeshData()`.
+	//!
+	//! @param [in] layout the layout to pack the vertices with
+	//! @param [in] vertices_nb the number of vertices
+	//! @param [in] vertices positions; cannot be null
+	//! @param [in] normals normals, or null
+	//! @param [in] texcoords texture coordinates (only x and y are used),
+	//!             or null
+	//! @param [in] tangents tangents, or null
+	//! @param [in] binormals binormals, or null
+	//! @param [in] indices the triangle indices
+	//! @param [in] indices_nb the number of indices
+	//! @return wrapper around the created OpenGL objects
+	mesh_data createMeshData(vertex_layout const& layout, size_t vertices_nb,
+	                         glm::vec3 const* vertices, glm::vec3 const* normals,
+	                         glm::vec3 const* texcoords, glm::vec3 const* tangents,
+	                         glm::vec3 const* binormals,
+	                         GLuint const* indices, size_t indices_nb);
+}
@@ -0,0 +1,106 @@
+#include "wave_system.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+#include "core/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace
+{
+	// Per-wave terms, laid out as `wave_terms` in water.vert:
+	//   - direction_phase: (frequency * direction, phase, amplitude)
+	//   - shape:           (sharpness - 1, 0.5 * sharpness * amplitude, -, -)
+	// The slope of a wave is then shape.y * s^shape.x * cos(theta) *
+	// direction_phase.xy, with s^shape.x shared with its height.
+	struct wave_terms {
+		glm::vec4 direction_phase;
+		glm::vec4 shape;
+	};
+
+	// std140 layout of `WaveBlock`
+	struct wave_block {
+		std::int32_t waves_nb;
+		std::int32_t padding[3];
+		wave_terms waves[eda221::wave_system::max_waves_nb];
+	};
+	static_assert(offsetof(wave_block, waves) == 16u && sizeof(wave_terms) == 32u,
+	              "wave_block has to match the std140 layout of WaveBlock");
+}
+
+std::vector<eda221::wave>
+eda221::generateWaves(unsigned int waves_nb)
+{
+	auto waves = std::vector<wave>();
+	waves.reserve(waves_nb);
+	waves.push_back({ 0.5f, 0.1f, 0.5f, 2.0f, glm::vec2(-1.0f, 0.0f) });
+	waves.push_back({ 0.25f, 0.2f, 1.3f, 4.0f, glm::normalize(glm::vec2(-0.7f, 0.7f)) });
+
+	// Further waves get shorter and smaller, with a phase following the
+	// dispersion of deep water (phase ~ sqrt(frequency)), and directions
+	// spread over 120 degrees around the first wave by the golden ratio.
+	auto const wind_angle = bonobo::pi;
+	for (auto i = 2u; i < waves_nb; ++i) {
+		auto const rank = static_cast<float>(i - 1u);
+		auto const spread = std::fmod(rank * 0.618034f, 1.0f) - 0.5f;
+		auto const angle = wind_angle + spread * 2.0f * bonobo::pi / 3.0f;
+		wave w;
+		w.frequency = 0.2f * std::pow(1.18f, rank);
+		w.amplitude = 0.25f * std::pow(0.82f, rank);
+		w.phase = 1.3f * std::sqrt(w.frequency / 0.2f);
+		w.sharpness = 2.0f + static_cast<float>(i % 3u);
+		w.direction = glm::vec2(std::cos(angle), std::sin(angle));
+		waves.push_back(w);
+	}
+	waves.resize(waves_nb);
+	return waves;
+}
+
+eda221::wave_system::wave_system() : _ubo(0u), _waves()
+{
+	glGenBuffers(1, &_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(wave_block), nullptr, GL_DYNAMIC_DRAW);
+	std::int32_t const header[4] = { 0, 0, 0, 0 };
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(header), header);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+}
+
+eda221::wave_system::~wave_system()
+{
+	glDeleteBuffers(1, &_ubo);
+	_ubo = 0u;
+}
+
+void
+eda221::wave_system::set_waves(std::vector<wave> const& waves)
+{
+	if (waves.size() > max_waves_nb)
+		LogWarning("Only the first %u of %u waves are used", max_waves_nb, static_cast<unsigned int>(waves.size()));
+	_waves.assign(waves.begin(), waves.begin() + std::min<size_t>(waves.size(), max_waves_nb));
+
+	wave_block block;
+	block.waves_nb = static_cast<std::int32_t>(_waves.size());
+	block.padding[0] = block.padding[1] = block.padding[2] = 0;
+	for (size_t i = 0u; i < _waves.size(); ++i) {
+		auto const& w = _waves[i];
+		auto const sharpness = std::max(w.sharpness, 1.0f);
+		auto const direction = glm::normalize(w.direction);
+		block.waves[i].direction_phase = glm::vec4(w.frequency * direction, w.phase, w.amplitude);
+		block.waves[i].shape = glm::vec4(sharpness - 1.0f, 0.5f * sharpness * w.amplitude, 0.0f, 0.0f);
+	}
+
+	// Only upload the waves in use.
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(offsetof(wave_block, waves) + _waves.size() * sizeof(wave_terms)), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+}
+
+void
+eda221::wave_system::bind() const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(uniform_block_bindings::waves), _ubo);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace eda221
+{
+	//! \brief One wave of a water surface.
+	//!
+	//! A point `p` of the surface is lifted by
+	//!
+	//!     amplitude * (0.5 + 0.5 * sin(frequency * dot(direction, p.xz) + phase * time)) ^ sharpness
+	struct wave {
+		float amplitude; //!< highest displacement, in world units
+		float frequency; //!< spatial frequency, in radians per world unit
+		float phase;     //!< temporal frequency, in radians per second
+		float sharpness; //!< exponent narrowing the crests; at least 1
+		glm::vec2 direction; //!< direction of travel, in the xz-plane
+	};
+
+	//! \brief Generate a deterministic set of waves.
+	//!
+	//! The first two are the historical lava waves; the following ones are
+	//! shorter and smaller, spread around the direction of the first one.
+	//!
+	//! @param [in] waves_nb how many waves to generate
+	//! @return the waves
+	std::vector<wave> generateWaves(unsigned int waves_nb);
+
+	//! \brief Uploads the waves of a water surface to a uniform buffer,
+	//!        along with the terms they share across all vertices.
+	//!
+	//! Shaders access it through the `WaveBlock` uniform block declared in
+	//! `water.vert`, bound to `uniform_block_bindings::waves`; each wave
+	//! only costs one `sin`, one `cos` and one `pow` per vertex there.
+	class wave_system
+	{
+	public:
+		//! \brief Highest number of waves the uniform block can hold.
+		static unsigned int const max_waves_nb = 32u;
+
+		//! \brief Create the uniform buffer, without any wave.
+		wave_system();
+
+		//! \brief Release the uniform buffer.
+		~wave_system();
+
+		wave_system(wave_system const&) = delete;
+		wave_system& operator=(wave_system const&) = delete;
+
+		//! \brief Replace the waves, and upload them.
+		//!
+		//! Waves past `max_waves_nb` are dropped, with a warning.
+		//!
+		//! @param [in] waves the new waves
+		void set_waves(std::vector<wave> const& waves);
+
+		std::vector<wave> const& get_waves() const { return _waves; }
+
+		//! \brief Bind the uniform buffer to its binding point.
+		void bind() const;
+
+	private:
+		GLuint _ubo;
+		std::vector<wave> _waves;
+	};
+}